@@ -7,6 +7,7 @@
 #include "db/filename.h"
 #include "db/dbformat.h"
 #include "db/table_cache.h"
+#include "db/value_log.h"
 #include "db/version_edit.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
@@ -20,26 +21,57 @@ Status BuildTable(const std::string& dbname,
                   TableCache* table_cache,
                   Iterator* iter,
                   FileMetaData* meta,
-                  WritableFile** file_dst) {
+                  WritableFile** file_dst,
+                  TableCompressionStats* cstats,
+                  std::vector<std::string>* value_pointers) {
   Status s;
   meta->file_size = 0;
   iter->SeekToFirst();
 
   std::string fname = TableFileName(dbname, meta->number);
   WritableFile* file=NULL;
+  // Separated values go to the value log first, so that the table can be
+  // built with their pointers in a single pass.
+  std::vector<std::string> pointers;
+  if (iter->Valid() && options.value_separation_threshold > 0) {
+    s = WriteValueLog(iter, options.value_separation_threshold, &pointers);
+    if (!s.ok()) {
+      return s;
+    }
+    iter->SeekToFirst();
+  }
   if (iter->Valid()) {
     s = env->NewWritableFile(fname, &file, 0);
     if (!s.ok()) {
+      ReleaseValueLog(pointers);
       return s;
     }
 
     TableBuilder* builder = new TableBuilder(options, file);
-    meta->smallest.DecodeFrom(iter->key());
+    size_t next_pointer = 0;
+    std::string separated_key;
+    bool first = true;
     for (; iter->Valid(); iter->Next()) {
       Slice key = iter->key();
+      Slice value = iter->value();
+      ParsedInternalKey ikey;
+      if (next_pointer < pointers.size() &&
+          value.size() >= options.value_separation_threshold &&
+          ParseInternalKey(key, &ikey) && ikey.type == kTypeValue) {
+        separated_key.clear();
+        AppendInternalKey(&separated_key, ParsedInternalKey(
+            ikey.user_key, ikey.sequence, kTypeValueIndex));
+        key = separated_key;
+        value = pointers[next_pointer++];
+      }
+      if (first) {
+        meta->smallest.DecodeFrom(key);
+        first = false;
+      }
       meta->largest.DecodeFrom(key);
-      builder->Add(key, iter->value());
+      builder->Add(key, value);
     }
+    assert(next_pointer == pointers.size());
 
     // Finish and check for builder errors
     s = builder->Finish();
@@ -47,6 +79,11 @@ Status BuildTable(const std::string& dbname,
       meta->file_size = builder->FileSize();
       assert(meta->file_size > 0);
     }
+    if (cstats != NULL) {
+      cstats->raw_bytes = builder->RawDataSize();
+      cstats->stored_bytes = builder->StoredDataSize();
+      cstats->micros = builder->CompressionMicros();
+    }
     delete builder;
 
     // Finish and check for file errors
@@ -75,7 +112,12 @@ Status BuildTable(const std::string& dbname,
   if (s.ok() && meta->file_size > 0) {
     // Keep it
     if(file_dst != NULL)  *file_dst=file;
+    if (value_pointers != NULL) {
+      value_pointers->swap(pointers);
+    }
   } else {
+    ReleaseValueLog(pointers);
+    delete file;
     env->DeleteFile(fname);
   }
   return s;
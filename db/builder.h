@@ -5,6 +5,9 @@
 #ifndef STORAGE_LEVELDB_DB_BUILDER_H_
 #define STORAGE_LEVELDB_DB_BUILDER_H_
 
+#include <stdint.h>
+#include <string>
+#include <vector>
 #include "leveldb/status.h"
 
 namespace leveldb {
@@ -18,18 +21,36 @@ class TableCache;
 class VersionEdit;
 class WritableFile;
 
+// Data block bytes of a table before and after compression, and the
+// time spent compressing them.
+struct TableCompressionStats {
+  uint64_t raw_bytes;
+  uint64_t stored_bytes;
+  uint64_t micros;
+
+  TableCompressionStats() : raw_bytes(0), stored_bytes(0), micros(0) { }
+};
+
 // Build a Table file from the contents of *iter.  The generated file
 // will be named according to meta->number.  On success, the rest of
 // *meta will be filled with metadata about the generated table.
 // If no data is present in *iter, meta->file_size will be set to
-// zero, and no Table file will be produced.
+// zero, and no Table file will be produced.  If "cstats" is non-NULL
+// it is filled with the compression statistics of the table.
+//
+// Values moved to the value log are released again if the table cannot
+// be built.  A caller that takes the file through "file_dst" and then
+// fails to sync it must release them itself; "value_pointers", if
+// non-NULL, receives them for that purpose.
 extern Status BuildTable(const std::string& dbname,
                          Env* env,
                          const Options& options,
                          TableCache* table_cache,
                          Iterator* iter,
                          FileMetaData* meta,
-                         WritableFile** file_dst = NULL);
+                         WritableFile** file_dst = NULL,
+                         TableCompressionStats* cstats = NULL,
+                         std::vector<std::string>* value_pointers = NULL);
 
 }  // namespace leveldb
 
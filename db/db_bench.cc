@@ -3,13 +3,17 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include <sys/types.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
 #include "db/db_impl.h"
 #include "db/version_set.h"
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/perf_context.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -19,6 +23,7 @@
 #include "util/testutil.h"
 
 #include "../hm/get_manager.h"
+#include "../hm/tracer.h"
 
 #define SLEEP_WAIT_FILL 0  //means waiting for compaction after fillrandom to balance the data of each level; 
                           //0 means not waiting
@@ -36,8 +41,24 @@
 //      readreverse   -- read N times in reverse order
 //      readrandom    -- read N times in random order
 //      readmissing   -- read N missing keys in random order
+//      multireadrandom -- read N times in random order, --multiget_batch
+//                       keys per DB::MultiGet call
 //      readhot       -- read N times in random order from 1% section of DB
 //      seekrandom    -- N random seeks
+//      seekprefix    -- N random seeks, each scanning the --prefix_len
+//                       prefix of its target with prefix_same_as_start
+//      ycsba         -- YCSB workload A: 50% reads, 50% updates
+//      ycsbb         -- YCSB workload B: 95% reads, 5% updates
+//      ycsbc         -- YCSB workload C: reads only
+//      ycsbd         -- YCSB workload D: 95% reads of the latest keys, 5% inserts
+//      ycsbe         -- YCSB workload E: 95% short scans, 5% inserts
+//      ycsbf         -- YCSB workload F: 50% reads, 50% read-modify-writes
+//      ycsb          -- the operation mix given by --ycsb_mix
+//                       The ycsb* benchmarks run on a DB loaded with
+//                       fillseq or fillrandom and the same --num.
+//      steadystate   -- load until live data fills --fill_percent of the
+//                       drive, then overwrite random keys for --duration
+//                       seconds; reports every --report_interval (10s)
 //      open          -- cost of opening a DB
 //      crc32c        -- repeated crc32c of 4K of data
 //      acquireload   -- load N*1000 times
@@ -90,6 +111,9 @@ static int FLAGS_num = 100000;
 static int FLAGS_reads = 100000;
 static int FLAGS_reads_seq = 100000;
 
+// Number of keys looked up per DB::MultiGet call in multireadrandom.
+static int FLAGS_multiget_batch = 100;
+
 // Number of concurrent threads to run.
 static int FLAGS_threads = 1;
 
@@ -103,6 +127,10 @@ static double FLAGS_compression_ratio = 0.5;
 // Print histogram of operation timings
 static bool FLAGS_histogram = false;
 
+// Count the tables, filter and block cache lookups, device reads and zones
+// each read touched, and print them per op.
+static bool FLAGS_perf_context = false;
+
 // Number of bytes to buffer in memtable before compacting
 // (initialized to default value by "main")
 static int FLAGS_write_buffer_size = 0;
@@ -115,6 +143,9 @@ static int FLAGS_max_file_size = 0;
 // (initialized to default value by "main")
 static int FLAGS_block_size = 0;
 
+// If true, data blocks carry a hash index for point lookups.
+static bool FLAGS_data_block_hash_index = false;
+
 // Number of bytes to use as a cache of uncompressed data.
 // Negative means use default settings.
 static int FLAGS_cache_size = -1;
@@ -126,6 +157,23 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// If true, the filters are blocked bloom filters, which keep all the bits
+// of a key in one cache line.
+static bool FLAGS_blocked_bloom = false;
+
+// Comma-separated bloom filter bits per key for levels 0, 1, ..., the
+// last entry also covering the deeper levels.  Requires --bloom_bits,
+// whose filter is used for reads.  NULL means --bloom_bits everywhere.
+static const char* FLAGS_bloom_bits_per_level = NULL;
+
+// If positive, the first --prefix_len bytes of a key are its prefix, and
+// the filters hold the prefixes too.
+static int FLAGS_prefix_len = 0;
+
+// If positive, flushes move the values of at least this many bytes to the
+// value log zones and keep pointers to them in the tables.
+static int FLAGS_value_separation_threshold = 0;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
@@ -134,9 +182,147 @@ static bool FLAGS_use_existing_db = false;
 // If true, reuse existing log/MANIFEST files when re-opening a database.
 static bool FLAGS_reuse_logs = false;
 
+// Block codec: "none", "snappy", "lz4" or "zstd".  NULL means use the
+// default settings.
+static const char* FLAGS_compression = NULL;
+
+// Comma-separated codec of each level, e.g. "none,lz4,lz4,zstd"; the last
+// one also applies to the deeper levels.  NULL means use --compression
+// for all levels.
+static const char* FLAGS_compression_per_level = NULL;
+
+// Size of the Zstandard dictionary trained by each compaction (0 for none).
+static int FLAGS_zstd_max_dict_bytes = 0;
+
+// Worker threads compressing the data blocks of each table being built
+// (0 compresses inline).
+static int FLAGS_compression_threads = 0;
+
+// If true, compactions verify the checksums of every block they read.
+static bool FLAGS_paranoid_checks = false;
+
+static bool ParseCompressionType(const leveldb::Slice& name,
+                                 leveldb::CompressionType* type) {
+  if (name == leveldb::Slice("none")) {
+    *type = leveldb::kNoCompression;
+  } else if (name == leveldb::Slice("snappy")) {
+    *type = leveldb::kSnappyCompression;
+  } else if (name == leveldb::Slice("lz4")) {
+    *type = leveldb::kLZ4Compression;
+  } else if (name == leveldb::Slice("zstd")) {
+    *type = leveldb::kZstdCompression;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool ParseCompressionPerLevel(
+    const char* list, std::vector<leveldb::CompressionType>* types) {
+  types->clear();
+  while (true) {
+    const char* sep = strchr(list, ',');
+    size_t len = (sep == NULL) ? strlen(list) : sep - list;
+    leveldb::CompressionType type;
+    if (!ParseCompressionType(leveldb::Slice(list, len), &type)) {
+      return false;
+    }
+    types->push_back(type);
+    if (sep == NULL) {
+      return true;
+    }
+    list = sep + 1;
+  }
+}
+
+static bool ParseBloomBitsPerLevel(const char* list, std::vector<int>* bits) {
+  bits->clear();
+  while (true) {
+    char* end;
+    long n = strtol(list, &end, 10);
+    if (end == list || n < 0 || (*end != ',' && *end != '\0')) {
+      return false;
+    }
+    bits->push_back(static_cast<int>(n));
+    if (*end == '\0') {
+      return true;
+    }
+    list = end + 1;
+  }
+}
+
+static const leveldb::FilterPolicy* NewBenchFilterPolicy(int bits_per_key) {
+  if (FLAGS_blocked_bloom) {
+    return leveldb::NewBlockedBloomFilterPolicy(bits_per_key);
+  }
+  return leveldb::NewBloomFilterPolicy(bits_per_key);
+}
+
+// Bandwidth allowed to compaction and relocation zone I/O in MB/s.
+// Negative means keep the zone manager's default (BG_RATE_LIMIT),
+// 0 means unlimited.
+static int FLAGS_bg_rate_limit_mb = -1;
+
+// If 1, every zone command is charged the service time of a host-managed
+// SMR drive and each benchmark reports the predicted device time; if 0 the
+// model is off.  Negative means keep the zone manager's default (SMR_MODEL).
+static int FLAGS_smr_model = -1;
+
+// If 1, the background rate limit follows the write pressure; if 0 it is
+// fixed.  Negative means keep the zone manager's default.
+static int FLAGS_bg_rate_auto_tune = -1;
+
+// Key distribution of the ycsb* benchmarks: "uniform", "zipfian" or
+// "latest" (zipfian over the most recently inserted keys).  ycsbd always
+// uses "latest".
+static const char* FLAGS_key_dist = "zipfian";
+
+// Skew of the zipfian and latest key distributions, in (0, 1).
+static double FLAGS_zipf_theta = 0.99;
+
+// Value sizes written by the ycsb* benchmarks: "fixed" uses --value_size,
+// "uniform" and "zipfian" draw from [--value_size_min, --value_size],
+// zipfian favouring the small sizes.
+static const char* FLAGS_value_size_dist = "fixed";
+static int FLAGS_value_size_min = 100;
+
+// Longest scan of the ycsb* benchmarks; each scan reads 1 to this many
+// entries, uniformly.
+static int FLAGS_scan_length = 100;
+
+// Operation mix of the "ycsb" benchmark in percent, in the order
+// read,update,insert,scan,readmodifywrite.
+static const char* FLAGS_ycsb_mix = "50,50,0,0,0";
+
+// If positive, the ycsb* benchmarks run for this many seconds instead of
+// --reads operations per thread.
+static int FLAGS_duration = 0;
+
+// If positive, the ycsb* benchmarks are paced to this many operations per
+// second, shared evenly by the threads.
+static int FLAGS_target_qps = 0;
+
+// If positive, print the throughput and latency of every interval of this
+// many seconds while a benchmark runs.
+static int FLAGS_report_interval = 0;
+
+// Write the interval rows to this file instead of stdout.
+static const char* FLAGS_report_file = NULL;
+
+// If true, the interval rows are JSON objects, one per line, instead of CSV.
+static bool FLAGS_report_json = false;
+
+// Percent of the drive's sequential zones the steadystate benchmark fills
+// with live data before it starts overwriting.
+static int FLAGS_fill_percent = 80;
+
 // Use the db with the following name.
 static const char* FLAGS_db = NULL;
 
+// If set, record zone and compaction events to this binary trace file.
+// Decode it with trace_dump.
+static const char* FLAGS_trace_file = NULL;
+
 namespace leveldb {
 
 namespace {
@@ -196,6 +382,189 @@ static void AppendWithSpace(std::string* str, Slice msg) {
   str->append(msg.data(), msg.size());
 }
 
+// Draws integers in [0, n) with P(i) proportional to 1/(i+1)^theta, using
+// the constant-time method of Gray et al., "Quickly Generating
+// Billion-Record Synthetic Databases", as YCSB does.  The generator is
+// read-only after construction and may be shared by threads.
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(uint64_t n, double theta)
+      : n_(n), theta_(theta), alpha_(1.0 / (1.0 - theta)) {
+    zetan_ = Zeta(n, theta);
+    const double zeta2 = Zeta(2, theta);
+    eta_ = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan_);
+  }
+
+  uint64_t Next(Random* rnd) const {
+    const double u = rnd->Next() / 2147483647.0;
+    const double uz = u * zetan_;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + pow(0.5, theta_)) return 1;
+    uint64_t v = static_cast<uint64_t>(n_ * pow(eta_ * u - eta_ + 1, alpha_));
+    return v < n_ ? v : n_ - 1;
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1.0 / pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  const uint64_t n_;
+  const double theta_;
+  const double alpha_;
+  double zetan_;
+  double eta_;
+};
+
+// Spreads the popular zipfian ranks over the whole key space so the hot
+// keys do not all sit in one table.
+static uint64_t ScrambleRank(uint64_t rank) {
+  uint64_t h = 14695981039346656037ull;  // FNV-1a
+  for (int i = 0; i < 8; i++) {
+    h ^= (rank >> (i * 8)) & 0xff;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+// Prints one row per report interval with the throughput and latency of
+// that interval over all threads of a benchmark, so that a run of many
+// hours can be followed over time and not only by its totals.  Each row
+// also samples the drive: bytes written by the user and by the DB, zones
+// in use per level, and time spent compacting, all counted from the start
+// of the benchmark.
+class IntervalReporter {
+ public:
+  IntervalReporter(const Slice& name, FILE* out, int interval_seconds,
+                   DB* db, HMManager* hm_manager)
+      : name_(name.ToString()),
+        out_(out),
+        interval_micros_(interval_seconds * 1000000ull),
+        db_(db),
+        hm_manager_(hm_manager),
+        start_(g_env->NowMicros()),
+        user_bytes_(0),
+        last_report_(start_),
+        next_report_(start_ + interval_micros_) {
+    HMSpaceStats space;
+    hm_manager_->get_space_stats(&space);
+    start_sectors_ = space.store_sectors;
+    start_compaction_micros_ = CompactionMicros();
+  }
+
+  void FinishedOp(double micros) {
+    hist_.Add(micros);
+    const uint64_t now = g_env->NowMicros();
+    if (now >= next_report_.load(std::memory_order_relaxed)) {
+      MutexLock l(&mu_);
+      if (now >= next_report_.load(std::memory_order_relaxed)) {
+        PrintRow(now);
+        next_report_.store(now + interval_micros_, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void AddUserBytes(int64_t n) {
+    user_bytes_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  // Prints the interval that was cut short by the end of the benchmark.
+  void Finish() {
+    MutexLock l(&mu_);
+    PrintRow(g_env->NowMicros());
+  }
+
+  static void PrintHeader(FILE* out) {
+    if (FLAGS_report_json) return;
+    fprintf(out, "benchmark,elapsed_s,ops,ops_per_s,"
+            "avg_us,p50_us,p99_us,p999_us,max_us,"
+            "user_mb,device_mb,write_amp,live_mb,used_zones,free_zones,"
+            "space_amp,compaction_s");
+    for (int level = 0; level < config::kNumLevels; level++) {
+      fprintf(out, ",zones_l%d", level);
+    }
+    fprintf(out, "\n");
+  }
+
+ private:
+  uint64_t CompactionMicros() {
+    std::string value;
+    if (!db_->GetProperty("leveldb.compaction-micros", &value)) return 0;
+    return strtoull(value.c_str(), NULL, 10);
+  }
+
+  // REQUIRES: mu_ held
+  void PrintRow(uint64_t now) {
+    Histogram interval;
+    interval.Clear();
+    hist_.Merge(&interval);
+    hist_.Clear();
+    const double seconds = (now - last_report_) * 1e-6;
+    last_report_ = now;
+    if (interval.Count() == 0 && seconds <= 0) return;
+    const bool empty = (interval.Count() == 0);
+
+    HMSpaceStats space;
+    hm_manager_->get_space_stats(&space);
+    const double user_mb = user_bytes_.load() / 1048576.0;
+    const double device_mb = (space.store_sectors - start_sectors_) / 2048.0;
+    const double live_mb = space.live_bytes / 1048576.0;
+    const double used_mb = space.used_zones * (space.zone_size / 1048576.0);
+    const double compaction_s =
+        (CompactionMicros() - start_compaction_micros_) * 1e-6;
+
+    char buf[1000];
+    snprintf(buf, sizeof(buf),
+             FLAGS_report_json
+             ? "{\"benchmark\":\"%s\",\"elapsed_s\":%.1f,\"ops\":%.0f,"
+               "\"ops_per_s\":%.1f,\"avg_us\":%.1f,\"p50_us\":%.1f,"
+               "\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f,"
+               "\"user_mb\":%.1f,\"device_mb\":%.1f,\"write_amp\":%.2f,"
+               "\"live_mb\":%.1f,\"used_zones\":%llu,\"free_zones\":%llu,"
+               "\"space_amp\":%.2f,\"compaction_s\":%.1f,\"level_zones\":["
+             : "%s,%.1f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,"
+               "%.1f,%.1f,%.2f,%.1f,%llu,%llu,%.2f,%.1f",
+             name_.c_str(), (now - start_) * 1e-6, interval.Count(),
+             seconds > 0 ? interval.Count() / seconds : 0.0,
+             empty ? 0.0 : interval.Average(),
+             empty ? 0.0 : interval.Median(),
+             empty ? 0.0 : interval.Percentile(99),
+             empty ? 0.0 : interval.Percentile(99.9),
+             empty ? 0.0 : interval.Max(),
+             user_mb, device_mb, user_mb > 0 ? device_mb / user_mb : 0.0,
+             live_mb, (unsigned long long)space.used_zones,
+             (unsigned long long)space.free_zones,
+             live_mb > 0 ? used_mb / live_mb : 0.0, compaction_s);
+    std::string row = buf;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      snprintf(buf, sizeof(buf), FLAGS_report_json && level == 0 ? "%llu" : ",%llu",
+               (unsigned long long)space.level_zones[level]);
+      row += buf;
+    }
+    if (FLAGS_report_json) row += "]}";
+    fprintf(out_, "%s\n", row.c_str());
+    fflush(out_);
+  }
+
+  const std::string name_;
+  FILE* out_;
+  const uint64_t interval_micros_;
+  DB* db_;
+  HMManager* hm_manager_;
+  const uint64_t start_;
+  uint64_t start_sectors_;
+  uint64_t start_compaction_micros_;
+  ConcurrentHistogram hist_;
+  std::atomic<int64_t> user_bytes_;
+  port::Mutex mu_;
+  uint64_t last_report_;             // Guarded by mu_
+  std::atomic<uint64_t> next_report_;
+};
+
 class Stats {
  private:
   double finish_;
@@ -205,22 +574,33 @@ class Stats {
   int64_t bytes_;
   double last_op_finish_;
   Histogram hist_;
+  PerfContext perf_;
   std::string message_;
+  IntervalReporter* reporter_;
 
  public:
  double start_;
-  Stats() { Start(); }
+  Stats() : reporter_(NULL) { Start(); }
+
+  void SetReporter(IntervalReporter* reporter) {
+    reporter_ = reporter;
+  }
 
   void Start() {
     next_report_ = 100;
-    last_op_finish_ = start_;
     hist_.Clear();
     done_ = 0;
     bytes_ = 0;
     seconds_ = 0;
     start_ = g_env->NowMicros();
+    last_op_finish_ = start_;
     finish_ = start_;
     message_.clear();
+    perf_.Reset();
+    if (FLAGS_perf_context) {
+      SetPerfContextEnabled(true);
+      GetPerfContext()->Reset();
+    }
   }
 
   void Merge(const Stats& other) {
@@ -228,6 +608,7 @@ class Stats {
     done_ += other.done_;
     bytes_ += other.bytes_;
     seconds_ += other.seconds_;
+    perf_.Merge(other.perf_);
     if (other.start_ < start_) start_ = other.start_;
     if (other.finish_ > finish_) finish_ = other.finish_;
 
@@ -238,6 +619,9 @@ class Stats {
   void Stop() {
     finish_ = g_env->NowMicros();
     seconds_ = (finish_ - start_) * 1e-6;
+    if (FLAGS_perf_context) {
+      perf_ = *GetPerfContext();
+    }
   }
 
   void AddMessage(Slice msg) {
@@ -245,13 +629,18 @@ class Stats {
   }
 
   void FinishedSingleOp() {
-    if (FLAGS_histogram) {
+    if (FLAGS_histogram || reporter_ != NULL) {
       double now = g_env->NowMicros();
       double micros = now - last_op_finish_;
-      hist_.Add(micros);
-      if (micros > 20000) {
-        fprintf(stderr, "long op: %.1f micros%30s\r", micros, "");
-        fflush(stderr);
+      if (FLAGS_histogram) {
+        hist_.Add(micros);
+        if (micros > 20000) {
+          fprintf(stderr, "long op: %.1f micros%30s\r", micros, "");
+          fflush(stderr);
+        }
+      }
+      if (reporter_ != NULL) {
+        reporter_->FinishedOp(micros);
       }
       last_op_finish_ = now;
     }
@@ -274,6 +663,19 @@ class Stats {
     bytes_ += n;
   }
 
+  // Bytes written by the user, counted as they are written so that
+  // interval reports can compare them with the drive's writes.
+  void AddUserBytes(int64_t n) {
+    if (reporter_ != NULL) {
+      reporter_->AddUserBytes(n);
+    }
+  }
+
+  // Leaves the time since the last op, spent pacing, out of its latency.
+  void SkipIdleTime() {
+    last_op_finish_ = g_env->NowMicros();
+  }
+
   void Report(const Slice& name) {
     // Pretend at least one op was done in case we are running a benchmark
     // that does not call FinishedSingleOp().
@@ -299,6 +701,19 @@ class Stats {
     if (FLAGS_histogram) {
       fprintf(stdout, "Microseconds per op:\n%s\n", hist_.ToString().c_str());
     }
+    if (FLAGS_perf_context) {
+      const double ops = done_;
+      fprintf(stdout,
+              "Per op: %.2f table probes, %.2f filter hits, %.2f filter misses, "
+              "%.2f cache hits, %.2f cache misses\n"
+              "        %.2f device reads, %.1f KB read, %.2f zones, "
+              "%.1f micros io wait\n",
+              perf_.table_probes / ops, perf_.filter_hits / ops,
+              perf_.filter_misses / ops, perf_.block_cache_hits / ops,
+              perf_.block_cache_misses / ops, perf_.device_reads / ops,
+              perf_.device_read_bytes / 1024.0 / ops,
+              perf_.zones_touched / ops, perf_.io_wait_micros / ops);
+    }
     fflush(stdout);
   }
 };
@@ -341,6 +756,8 @@ class Benchmark {
  private:
   Cache* cache_;
   const FilterPolicy* filter_policy_;
+  std::vector<const FilterPolicy*> level_filter_policies_;
+  const SliceTransform* prefix_extractor_;
   DB* db_;
   int num_;
   int value_size_;
@@ -348,6 +765,14 @@ class Benchmark {
   WriteOptions write_options_;
   int reads_;
   int heap_counter_;
+  FILE* report_file_;
+  bool report_header_printed_;
+
+  // State of the ycsb* benchmarks
+  std::atomic<int> ycsb_keys_;       // Keys 0..ycsb_keys_-1 exist
+  port::Mutex ycsb_mu_;
+  ZipfianGenerator* key_zipf_;       // Guarded by ycsb_mu_ until built
+  ZipfianGenerator* value_zipf_;
 
   HMManager *hm_manager_;
 
@@ -429,15 +854,30 @@ class Benchmark {
   Benchmark()
   : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : NULL),
     filter_policy_(FLAGS_bloom_bits >= 0
-                   ? NewBloomFilterPolicy(FLAGS_bloom_bits)
+                   ? NewBenchFilterPolicy(FLAGS_bloom_bits)
                    : NULL),
+    prefix_extractor_(FLAGS_prefix_len > 0
+                      ? NewFixedPrefixTransform(FLAGS_prefix_len)
+                      : NULL),
     db_(NULL),
     num_(FLAGS_num),
     value_size_(FLAGS_value_size),
     entries_per_batch_(1),
     reads_(FLAGS_reads < 0 ? FLAGS_num : FLAGS_reads),
     heap_counter_(0),
+    report_file_(stdout),
+    report_header_printed_(false),
+    ycsb_keys_(FLAGS_num),
+    key_zipf_(NULL),
+    value_zipf_(NULL),
     hm_manager_(Singleton::Gethmmanager()) {
+    if (FLAGS_report_file != NULL) {
+      report_file_ = fopen(FLAGS_report_file, "w");
+      if (report_file_ == NULL) {
+        fprintf(stderr, "cannot open report file %s\n", FLAGS_report_file);
+        exit(1);
+      }
+    }
     std::vector<std::string> files;
     g_env->GetChildren(FLAGS_db, &files);
     for (size_t i = 0; i < files.size(); i++) {
@@ -454,6 +894,15 @@ class Benchmark {
     delete db_;
     delete cache_;
     delete filter_policy_;
+    for (size_t i = 0; i < level_filter_policies_.size(); i++) {
+      delete level_filter_policies_[i];
+    }
+    delete prefix_extractor_;
+    delete key_zipf_;
+    delete value_zipf_;
+    if (report_file_ != stdout) {
+      fclose(report_file_);
+    }
   }
 
   void Run() {
@@ -516,10 +965,14 @@ class Benchmark {
         method = &Benchmark::ReadReverse;
       } else if (name == Slice("readrandom")) {
         method = &Benchmark::ReadRandom;
+      } else if (name == Slice("multireadrandom")) {
+        method = &Benchmark::MultiReadRandom;
       } else if (name == Slice("readmissing")) {
         method = &Benchmark::ReadMissing;
       } else if (name == Slice("seekrandom")) {
         method = &Benchmark::SeekRandom;
+      } else if (name == Slice("seekprefix")) {
+        method = &Benchmark::SeekPrefix;
       } else if (name == Slice("readhot")) {
         method = &Benchmark::ReadHot;
       } else if (name == Slice("readrandomsmall")) {
@@ -529,6 +982,23 @@ class Benchmark {
         method = &Benchmark::DeleteSeq;
       } else if (name == Slice("deleterandom")) {
         method = &Benchmark::DeleteRandom;
+      } else if (name == Slice("ycsba")) {
+        method = &Benchmark::YCSBWorkloadA;
+      } else if (name == Slice("ycsbb")) {
+        method = &Benchmark::YCSBWorkloadB;
+      } else if (name == Slice("ycsbc")) {
+        method = &Benchmark::YCSBWorkloadC;
+      } else if (name == Slice("ycsbd")) {
+        method = &Benchmark::YCSBWorkloadD;
+      } else if (name == Slice("ycsbe")) {
+        method = &Benchmark::YCSBWorkloadE;
+      } else if (name == Slice("ycsbf")) {
+        method = &Benchmark::YCSBWorkloadF;
+      } else if (name == Slice("ycsb")) {
+        method = &Benchmark::YCSBCustom;
+      } else if (name == Slice("steadystate")) {
+        fresh_db = true;
+        method = &Benchmark::SteadyState;
       } else if (name == Slice("readwhilewriting")) {
         num_threads++;  // Add extra thread for writing
         method = &Benchmark::ReadWhileWriting;
@@ -564,6 +1034,7 @@ class Benchmark {
           db_ = NULL;
           DestroyDB(FLAGS_db, Options());
           Open();
+          ycsb_keys_ = FLAGS_num;
         }
       }
 
@@ -609,6 +1080,31 @@ class Benchmark {
     }
   }
 
+  // Predicted time the drive spent on this benchmark's zone commands.
+  // Background compaction still running when it ends is not included.
+  void PrintDeviceTime(const SMRModelStats& before) {
+    SMRModelStats after;
+    hm_manager_->get_smr_model_stats(&after);
+    fprintf(stdout,
+            "Device:      %.3f s predicted (seek %.3f, rotation %.3f, "
+            "transfer %.3f, reset %.3f); %llu seeks, %llu resets, "
+            "%llu write pointer violations\n",
+            (after.device_micros - before.device_micros) * 1e-6,
+            (after.seek_micros - before.seek_micros) * 1e-6,
+            (after.rotation_micros - before.rotation_micros) * 1e-6,
+            (after.transfer_micros - before.transfer_micros) * 1e-6,
+            (after.reset_micros - before.reset_micros) * 1e-6,
+            (unsigned long long)(after.seeks - before.seeks),
+            (unsigned long long)(after.resets - before.resets),
+            (unsigned long long)(after.wp_violations - before.wp_violations));
+    fprintf(stdout, "Device time by class:");
+    for (int i = 0; i < kNumIOClasses; i++) {
+      fprintf(stdout, " %s %.3f s", io_class_name(static_cast<IOClass>(i)),
+              (after.class_micros[i] - before.class_micros[i]) * 1e-6);
+    }
+    fprintf(stdout, "\n");
+  }
+
   void RunBenchmark(int n, Slice name,
                     void (Benchmark::*method)(ThreadState*)) {
     SharedState shared;
@@ -617,6 +1113,23 @@ class Benchmark {
     shared.num_done = 0;
     shared.start = false;
 
+    IntervalReporter* reporter = NULL;
+    int interval = FLAGS_report_interval;
+    if (interval <= 0 && name == Slice("steadystate")) {
+      interval = 10;
+    }
+    if (interval > 0) {
+      if (!report_header_printed_) {
+        IntervalReporter::PrintHeader(report_file_);
+        report_header_printed_ = true;
+      }
+      reporter = new IntervalReporter(name, report_file_, interval, db_,
+                                      hm_manager_);
+    }
+
+    SMRModelStats device_before;
+    hm_manager_->get_smr_model_stats(&device_before);
+
     ThreadArg* arg = new ThreadArg[n];
     for (int i = 0; i < n; i++) {
       arg[i].bm = this;
@@ -624,6 +1137,7 @@ class Benchmark {
       arg[i].shared = &shared;
       arg[i].thread = new ThreadState(i);
       arg[i].thread->shared = &shared;
+      arg[i].thread->stats.SetReporter(reporter);
       g_env->StartThread(ThreadBody, &arg[i]);
     }
 
@@ -639,10 +1153,18 @@ class Benchmark {
     }
     shared.mu.Unlock();
 
+    if (reporter != NULL) {
+      reporter->Finish();
+      delete reporter;
+    }
+
     for (int i = 1; i < n; i++) {
       arg[0].thread->stats.Merge(arg[i].thread->stats);
     }
     arg[0].thread->stats.Report(name);
+    if (hm_manager_->smr_model_enabled()) {
+      PrintDeviceTime(device_before);
+    }
 
     for (int i = 0; i < n; i++) {
       delete arg[i].thread;
@@ -746,9 +1268,41 @@ class Benchmark {
     options.write_buffer_size = FLAGS_write_buffer_size;
     options.max_file_size = FLAGS_max_file_size;
     options.block_size = FLAGS_block_size;
+    options.data_block_hash_index = FLAGS_data_block_hash_index;
     options.max_open_files = FLAGS_open_files;
     options.filter_policy = filter_policy_;
+    if (filter_policy_ != NULL && FLAGS_bloom_bits_per_level != NULL &&
+        level_filter_policies_.empty()) {
+      std::vector<int> bits;
+      ParseBloomBitsPerLevel(FLAGS_bloom_bits_per_level, &bits);
+      for (size_t i = 0; i < bits.size(); i++) {
+        level_filter_policies_.push_back(NewBenchFilterPolicy(bits[i]));
+      }
+    }
+    options.filter_policy_per_level = level_filter_policies_;
+    options.prefix_extractor = prefix_extractor_;
+    options.value_separation_threshold = FLAGS_value_separation_threshold;
     options.reuse_logs = FLAGS_reuse_logs;
+    if (FLAGS_compression != NULL) {
+      ParseCompressionType(FLAGS_compression, &options.compression);
+    }
+    if (FLAGS_compression_per_level != NULL) {
+      ParseCompressionPerLevel(FLAGS_compression_per_level,
+                               &options.compression_per_level);
+    }
+    options.zstd_max_dict_bytes = FLAGS_zstd_max_dict_bytes;
+    options.compression_threads = FLAGS_compression_threads;
+    options.paranoid_checks = FLAGS_paranoid_checks;
+    if (FLAGS_bg_rate_limit_mb >= 0) {
+      hm_manager_->set_bg_rate_limit(
+          static_cast<uint64_t>(FLAGS_bg_rate_limit_mb) * 1048576);
+    }
+    if (FLAGS_bg_rate_auto_tune >= 0) {
+      hm_manager_->set_bg_rate_auto_tune(FLAGS_bg_rate_auto_tune == 1);
+    }
+    if (FLAGS_smr_model >= 0) {
+      hm_manager_->set_smr_model(FLAGS_smr_model == 1);
+    }
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -795,6 +1349,7 @@ class Benchmark {
         snprintf(key, sizeof(key), "%016d", k);
         batch.Put(key, gen.Generate(value_size_));
         bytes += value_size_ + strlen(key);
+        thread->stats.AddUserBytes(value_size_ + strlen(key));
         thread->stats.FinishedSingleOp();
       }
       s = db_->Write(write_options_, &batch);
@@ -871,6 +1426,35 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+  void MultiReadRandom(ThreadState* thread) {
+    ReadOptions options;
+    std::vector<std::string> key_storage(FLAGS_multiget_batch);
+    std::vector<Slice> keys;
+    std::vector<std::string> values;
+    int found = 0;
+    for (int i = 0; i < reads_; i += FLAGS_multiget_batch) {
+      const int batch = std::min(FLAGS_multiget_batch, reads_ - i);
+      keys.clear();
+      for (int j = 0; j < batch; j++) {
+        char key[100];
+        const int k = thread->rand.Next() % FLAGS_num;
+        snprintf(key, sizeof(key), "%016d", k);
+        key_storage[j] = key;
+        keys.push_back(key_storage[j]);
+      }
+      std::vector<Status> statuses = db_->MultiGet(options, keys, &values);
+      for (int j = 0; j < batch; j++) {
+        if (statuses[j].ok()) {
+          found++;
+        }
+        thread->stats.FinishedSingleOp();
+      }
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%d of %d found)", found, reads_);
+    thread->stats.AddMessage(msg);
+  }
+
   void ReadMissing(ThreadState* thread) {
     ReadOptions options;
     std::string value;
@@ -914,6 +1498,31 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+  void SeekPrefix(ThreadState* thread) {
+    if (prefix_extractor_ == NULL) {
+      thread->stats.AddMessage("(needs --prefix_len)");
+      return;
+    }
+    ReadOptions options;
+    options.prefix_same_as_start = true;
+    int64_t entries = 0;
+    for (int i = 0; i < reads_; i++) {
+      Iterator* iter = db_->NewIterator(options);
+      char key[100];
+      const int k = thread->rand.Next() % FLAGS_num;
+      snprintf(key, sizeof(key), "%016d", k);
+      for (iter->Seek(key); iter->Valid(); iter->Next()) {
+        entries++;
+      }
+      delete iter;
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%.1f entries per seek)",
+             reads_ > 0 ? 1.0 * entries / reads_ : 0.0);
+    thread->stats.AddMessage(msg);
+  }
+
   void DoDelete(ThreadState* thread, bool seq) {
     RandomGenerator gen;
     WriteBatch batch;
@@ -973,6 +1582,243 @@ class Benchmark {
     }
   }
 
+  // Percentages of each operation in a ycsb* benchmark.
+  struct YCSBMix {
+    int read;
+    int update;
+    int insert;
+    int scan;
+    int rmw;
+  };
+
+  void YCSBWorkloadA(ThreadState* thread) {
+    YCSBMix mix = { 50, 50, 0, 0, 0 };
+    DoYCSB(thread, mix, false);
+  }
+
+  void YCSBWorkloadB(ThreadState* thread) {
+    YCSBMix mix = { 95, 5, 0, 0, 0 };
+    DoYCSB(thread, mix, false);
+  }
+
+  void YCSBWorkloadC(ThreadState* thread) {
+    YCSBMix mix = { 100, 0, 0, 0, 0 };
+    DoYCSB(thread, mix, false);
+  }
+
+  void YCSBWorkloadD(ThreadState* thread) {
+    YCSBMix mix = { 95, 0, 5, 0, 0 };
+    DoYCSB(thread, mix, true);
+  }
+
+  void YCSBWorkloadE(ThreadState* thread) {
+    YCSBMix mix = { 0, 0, 5, 95, 0 };
+    DoYCSB(thread, mix, false);
+  }
+
+  void YCSBWorkloadF(ThreadState* thread) {
+    YCSBMix mix = { 50, 0, 0, 0, 50 };
+    DoYCSB(thread, mix, false);
+  }
+
+  void YCSBCustom(ThreadState* thread) {
+    YCSBMix mix = { 0, 0, 0, 0, 0 };
+    char junk;
+    if (sscanf(FLAGS_ycsb_mix, "%d,%d,%d,%d,%d%c", &mix.read, &mix.update,
+               &mix.insert, &mix.scan, &mix.rmw, &junk) != 5 ||
+        mix.read + mix.update + mix.insert + mix.scan + mix.rmw != 100) {
+      fprintf(stderr, "bad --ycsb_mix '%s': need five percentages adding "
+              "up to 100\n", FLAGS_ycsb_mix);
+      exit(1);
+    }
+    DoYCSB(thread, mix, false);
+  }
+
+  // Zipfian tables take O(n) to build, so they are built once and shared.
+  void InitYCSBGenerators() {
+    MutexLock l(&ycsb_mu_);
+    if (key_zipf_ == NULL) {
+      key_zipf_ = new ZipfianGenerator(FLAGS_num, FLAGS_zipf_theta);
+    }
+    if (value_zipf_ == NULL && FLAGS_value_size > FLAGS_value_size_min) {
+      value_zipf_ = new ZipfianGenerator(
+          FLAGS_value_size - FLAGS_value_size_min + 1, FLAGS_zipf_theta);
+    }
+  }
+
+  int NextYCSBKey(ThreadState* thread, bool latest) {
+    const int keys = ycsb_keys_.load(std::memory_order_relaxed);
+    if (latest || strcmp(FLAGS_key_dist, "latest") == 0) {
+      const int back = static_cast<int>(key_zipf_->Next(&thread->rand));
+      return back < keys ? keys - 1 - back : 0;
+    } else if (strcmp(FLAGS_key_dist, "zipfian") == 0) {
+      return ScrambleRank(key_zipf_->Next(&thread->rand)) % keys;
+    }
+    return thread->rand.Next() % keys;
+  }
+
+  int NextYCSBValueSize(ThreadState* thread) {
+    if (FLAGS_value_size <= FLAGS_value_size_min ||
+        strcmp(FLAGS_value_size_dist, "fixed") == 0) {
+      return value_size_;
+    } else if (strcmp(FLAGS_value_size_dist, "zipfian") == 0) {
+      return FLAGS_value_size_min +
+             static_cast<int>(value_zipf_->Next(&thread->rand));
+    }
+    return FLAGS_value_size_min +
+           thread->rand.Uniform(FLAGS_value_size - FLAGS_value_size_min + 1);
+  }
+
+  // Returns false when the thread has done "ops" operations or, with
+  // --duration, when the time since "start" is up.  With --target_qps it
+  // first sleeps until operation "i" of this thread is due.
+  bool KeepRunning(ThreadState* thread, int64_t i, int64_t ops,
+                   uint64_t start) {
+    const uint64_t now = g_env->NowMicros();
+    if (FLAGS_duration > 0) {
+      if (now - start >= FLAGS_duration * 1000000ull) return false;
+    } else if (i >= ops) {
+      return false;
+    }
+    if (FLAGS_target_qps > 0) {
+      const double per_thread_qps =
+          static_cast<double>(FLAGS_target_qps) / thread->shared->total;
+      const uint64_t due = start + static_cast<uint64_t>(i * 1e6 / per_thread_qps);
+      if (now < due) {
+        g_env->SleepForMicroseconds(static_cast<int>(due - now));
+        thread->stats.SkipIdleTime();
+      }
+    }
+    return true;
+  }
+
+  void DoYCSB(ThreadState* thread, const YCSBMix& mix, bool latest) {
+    InitYCSBGenerators();
+    ReadOptions options;
+    RandomGenerator gen;
+    std::string value;
+    int64_t bytes = 0;
+    int64_t reads = 0, found = 0, updates = 0, inserts = 0, scans = 0, rmws = 0;
+    char key[100];
+    const uint64_t start = static_cast<uint64_t>(thread->stats.start_);
+    for (int64_t i = 0; KeepRunning(thread, i, reads_, start); i++) {
+      int op = thread->rand.Uniform(100);
+      Status s;
+      if ((op -= mix.read) < 0) {
+        snprintf(key, sizeof(key), "%016d", NextYCSBKey(thread, latest));
+        if (db_->Get(options, key, &value).ok()) {
+          found++;
+          bytes += value.size();
+        }
+        reads++;
+      } else if ((op -= mix.update) < 0) {
+        snprintf(key, sizeof(key), "%016d", NextYCSBKey(thread, latest));
+        const int size = NextYCSBValueSize(thread);
+        s = db_->Put(write_options_, key, gen.Generate(size));
+        thread->stats.AddUserBytes(size + 16);
+        bytes += size;
+        updates++;
+      } else if ((op -= mix.insert) < 0) {
+        snprintf(key, sizeof(key), "%016d", ycsb_keys_.fetch_add(1));
+        const int size = NextYCSBValueSize(thread);
+        s = db_->Put(write_options_, key, gen.Generate(size));
+        thread->stats.AddUserBytes(size + 16);
+        bytes += size;
+        inserts++;
+      } else if ((op -= mix.scan) < 0) {
+        snprintf(key, sizeof(key), "%016d", NextYCSBKey(thread, latest));
+        const int length = 1 + thread->rand.Uniform(FLAGS_scan_length);
+        Iterator* iter = db_->NewIterator(options);
+        iter->Seek(key);
+        for (int j = 0; j < length && iter->Valid(); j++) {
+          bytes += iter->key().size() + iter->value().size();
+          iter->Next();
+        }
+        delete iter;
+        scans++;
+      } else {
+        snprintf(key, sizeof(key), "%016d", NextYCSBKey(thread, latest));
+        db_->Get(options, key, &value);
+        const int size = NextYCSBValueSize(thread);
+        s = db_->Put(write_options_, key, gen.Generate(size));
+        thread->stats.AddUserBytes(size + 16);
+        bytes += size;
+        rmws++;
+      }
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      thread->stats.FinishedSingleOp();
+    }
+    thread->stats.AddBytes(bytes);
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "(%lld reads %lld found, %lld updates, %lld inserts, "
+             "%lld scans, %lld rmw)",
+             (long long)reads, (long long)found, (long long)updates,
+             (long long)inserts, (long long)scans, (long long)rmws);
+    thread->stats.AddMessage(msg);
+  }
+
+  // Each thread loads every n-th key, so together they write them all.
+  void SteadyState(ThreadState* thread) {
+    HMSpaceStats space;
+    hm_manager_->get_space_stats(&space);
+    double entry_bytes = 16 + value_size_;
+    std::string compressed;
+    if (port::Snappy_Compress("yyyyyyyyyyyyyyyyyyyy", 20, &compressed)) {
+      entry_bytes = 16 + value_size_ * FLAGS_compression_ratio;
+    }
+    // Zones below the reserve are kept for relocation, not user data.
+    const uint64_t usable_zones = space.zone_capacity > ZONE_RESERVE_NUM
+                                  ? space.zone_capacity - ZONE_RESERVE_NUM : 0;
+    const int keys = static_cast<int>(
+        FLAGS_fill_percent / 100.0 * usable_zones * space.zone_size /
+        entry_bytes);
+    const int threads = thread->shared->total;
+
+    RandomGenerator gen;
+    WriteBatch batch;
+    Status s;
+    int64_t bytes = 0;
+    for (int k = thread->tid; k < keys; ) {
+      batch.Clear();
+      for (int j = 0; j < 100 && k < keys; j++, k += threads) {
+        char key[100];
+        snprintf(key, sizeof(key), "%016d", k);
+        batch.Put(key, gen.Generate(value_size_));
+        bytes += value_size_ + strlen(key);
+        thread->stats.AddUserBytes(value_size_ + strlen(key));
+        thread->stats.FinishedSingleOp();
+      }
+      s = db_->Write(write_options_, &batch);
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+    }
+
+    const uint64_t start = g_env->NowMicros();
+    for (int64_t i = 0; KeepRunning(thread, i, keys / threads, start); i++) {
+      char key[100];
+      snprintf(key, sizeof(key), "%016d", thread->rand.Next() % keys);
+      s = db_->Put(write_options_, key, gen.Generate(value_size_));
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      bytes += value_size_ + strlen(key);
+      thread->stats.AddUserBytes(value_size_ + strlen(key));
+      thread->stats.FinishedSingleOp();
+    }
+    thread->stats.AddBytes(bytes);
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%d keys, %d%% of %llu zones)", keys,
+             FLAGS_fill_percent, (unsigned long long)usable_zones);
+    thread->stats.AddMessage(msg);
+  }
+
   void Compact(ThreadState* thread) {
     db_->CompactRange(NULL, NULL);
   }
@@ -1029,6 +1875,9 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--histogram=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_histogram = n;
+    } else if (sscanf(argv[i], "--perf_context=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_perf_context = n;
     } else if (sscanf(argv[i], "--use_existing_db=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_use_existing_db = n;
@@ -1041,6 +1890,9 @@ int main(int argc, char** argv) {
       FLAGS_reads = n;
     } else if (sscanf(argv[i], "--reads_seq=%d%c", &n, &junk) == 1) {
       FLAGS_reads_seq = n;
+    } else if (sscanf(argv[i], "--multiget_batch=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_multiget_batch = n;
     } else if (sscanf(argv[i], "--threads=%d%c", &n, &junk) == 1) {
       FLAGS_threads = n;
     } else if (sscanf(argv[i], "--value_size=%d%c", &n, &junk) == 1) {
@@ -1051,20 +1903,119 @@ int main(int argc, char** argv) {
       FLAGS_max_file_size = n;
     } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1) {
       FLAGS_block_size = n;
+    } else if (sscanf(argv[i], "--data_block_hash_index=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_data_block_hash_index = n;
     } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
       FLAGS_cache_size = n;
+    } else if (sscanf(argv[i], "--blocked_bloom=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_blocked_bloom = n;
+    } else if (strncmp(argv[i], "--bloom_bits_per_level=", 23) == 0) {
+      FLAGS_bloom_bits_per_level = argv[i] + 23;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
+    } else if (sscanf(argv[i], "--prefix_len=%d%c", &n, &junk) == 1) {
+      FLAGS_prefix_len = n;
+    } else if (sscanf(argv[i], "--value_separation_threshold=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_value_separation_threshold = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (sscanf(argv[i], "--smr_model=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_smr_model = n;
+    } else if (sscanf(argv[i], "--bg_rate_limit_mb=%d%c", &n, &junk) == 1) {
+      FLAGS_bg_rate_limit_mb = n;
+    } else if (sscanf(argv[i], "--bg_rate_auto_tune=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_bg_rate_auto_tune = n;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
+    } else if (strncmp(argv[i], "--compression=", 14) == 0) {
+      FLAGS_compression = argv[i] + 14;
+    } else if (strncmp(argv[i], "--compression_per_level=", 24) == 0) {
+      FLAGS_compression_per_level = argv[i] + 24;
+    } else if (sscanf(argv[i], "--zstd_max_dict_bytes=%d%c",
+                      &n, &junk) == 1 && n >= 0) {
+      FLAGS_zstd_max_dict_bytes = n;
+    } else if (sscanf(argv[i], "--compression_threads=%d%c",
+                      &n, &junk) == 1 && n >= 0) {
+      FLAGS_compression_threads = n;
+    } else if (sscanf(argv[i], "--paranoid_checks=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_paranoid_checks = n;
+    } else if (strncmp(argv[i], "--key_dist=", 11) == 0) {
+      FLAGS_key_dist = argv[i] + 11;
+    } else if (sscanf(argv[i], "--zipf_theta=%lf%c", &d, &junk) == 1 &&
+               d > 0 && d < 1) {
+      FLAGS_zipf_theta = d;
+    } else if (strncmp(argv[i], "--value_size_dist=", 18) == 0) {
+      FLAGS_value_size_dist = argv[i] + 18;
+    } else if (sscanf(argv[i], "--value_size_min=%d%c", &n, &junk) == 1) {
+      FLAGS_value_size_min = n;
+    } else if (sscanf(argv[i], "--scan_length=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_scan_length = n;
+    } else if (strncmp(argv[i], "--ycsb_mix=", 11) == 0) {
+      FLAGS_ycsb_mix = argv[i] + 11;
+    } else if (sscanf(argv[i], "--duration=%d%c", &n, &junk) == 1) {
+      FLAGS_duration = n;
+    } else if (sscanf(argv[i], "--target_qps=%d%c", &n, &junk) == 1) {
+      FLAGS_target_qps = n;
+    } else if (sscanf(argv[i], "--report_interval=%d%c", &n, &junk) == 1) {
+      FLAGS_report_interval = n;
+    } else if (strncmp(argv[i], "--report_file=", 14) == 0) {
+      FLAGS_report_file = argv[i] + 14;
+    } else if (sscanf(argv[i], "--report_json=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_report_json = n;
+    } else if (sscanf(argv[i], "--fill_percent=%d%c", &n, &junk) == 1 &&
+               n > 0 && n <= 100) {
+      FLAGS_fill_percent = n;
+    } else if (strncmp(argv[i], "--trace_file=", 13) == 0) {
+      FLAGS_trace_file = argv[i] + 13;
     } else {
       fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
       exit(1);
     }
   }
 
+  leveldb::CompressionType type;
+  std::vector<leveldb::CompressionType> types;
+  if (FLAGS_compression != NULL &&
+      !ParseCompressionType(FLAGS_compression, &type)) {
+    fprintf(stderr, "Invalid --compression '%s'\n", FLAGS_compression);
+    exit(1);
+  }
+  if (FLAGS_compression_per_level != NULL &&
+      !ParseCompressionPerLevel(FLAGS_compression_per_level, &types)) {
+    fprintf(stderr, "Invalid --compression_per_level '%s'\n",
+            FLAGS_compression_per_level);
+    exit(1);
+  }
+  std::vector<int> bloom_bits;
+  if (FLAGS_bloom_bits_per_level != NULL &&
+      (FLAGS_bloom_bits < 0 ||
+       !ParseBloomBitsPerLevel(FLAGS_bloom_bits_per_level, &bloom_bits))) {
+    fprintf(stderr,
+            "Invalid --bloom_bits_per_level '%s' (needs --bloom_bits)\n",
+            FLAGS_bloom_bits_per_level);
+    exit(1);
+  }
+  if (strcmp(FLAGS_key_dist, "uniform") != 0 &&
+      strcmp(FLAGS_key_dist, "zipfian") != 0 &&
+      strcmp(FLAGS_key_dist, "latest") != 0) {
+    fprintf(stderr, "Invalid --key_dist '%s'\n", FLAGS_key_dist);
+    exit(1);
+  }
+  if (strcmp(FLAGS_value_size_dist, "fixed") != 0 &&
+      strcmp(FLAGS_value_size_dist, "uniform") != 0 &&
+      strcmp(FLAGS_value_size_dist, "zipfian") != 0) {
+    fprintf(stderr, "Invalid --value_size_dist '%s'\n", FLAGS_value_size_dist);
+    exit(1);
+  }
+
   leveldb::g_env = leveldb::Env::Default();
 
   // Choose a location for the test database if none given with --db=<path>
@@ -1074,7 +2025,18 @@ int main(int argc, char** argv) {
       FLAGS_db = default_db_path.c_str();
   }
 
+  leveldb::Tracer* tracer = leveldb::Tracer::global();
+  if (FLAGS_trace_file != NULL && !tracer->start(FLAGS_trace_file)) {
+    exit(1);
+  }
+
   leveldb::Benchmark benchmark;
   benchmark.Run();
+
+  if (FLAGS_trace_file != NULL) {
+    tracer->stop();
+    fprintf(stdout, "Trace:      %s (%llu events dropped)\n", FLAGS_trace_file,
+            (unsigned long long)tracer->get_dropped());
+  }
   return 0;
 }
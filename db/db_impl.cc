@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <set>
 #include <string>
+#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <vector>
@@ -17,7 +18,9 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/range_del.h"
 #include "db/table_cache.h"
+#include "db/value_log.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
@@ -32,9 +35,11 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/perf_context_imp.h"
 
 #include "../hm/get_manager.h"
 #include "../hm/container.h"
+#include "../hm/tracer.h"
 
 namespace leveldb {
 
@@ -72,7 +77,10 @@ struct DBImpl::CompactionState {
   // State kept for output being generated
   WritableFile* outfile;          
   TableBuilder* builder;          
+  std::string compression_dict;      //Trained from the first output, used by the later ones
   int outputs_one_index;             //Increase the output file each time
+  uint64_t output_limit;             //Size at which the current output is cut
+  std::vector<std::string> dropped_values;   //Value pointers of the dropped kTypeValueIndex entries
 
   uint64_t total_bytes;
   uint64_t c_read_bytes;
@@ -85,6 +93,7 @@ struct DBImpl::CompactionState {
       : compaction(c),
         outfile(NULL),
         builder(NULL),
+        output_limit(0),
         total_bytes(0) {
           outputs_one_index = 0;
           c_read_bytes = 0;
@@ -99,6 +108,18 @@ static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
   if (static_cast<V>(*ptr) > maxvalue) *ptr = maxvalue;
   if (static_cast<V>(*ptr) < minvalue) *ptr = minvalue;
 }
+// Codec of the tables written to "level".
+static CompressionType CompressionForLevel(const Options& options, int level) {
+  const std::vector<CompressionType>& per_level = options.compression_per_level;
+  if (per_level.empty()) {
+    return options.compression;
+  }
+  if (level >= static_cast<int>(per_level.size())) {
+    return per_level.back();
+  }
+  return per_level[level];
+}
+
 Options SanitizeOptions(const std::string& dbname,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
@@ -106,6 +127,7 @@ Options SanitizeOptions(const std::string& dbname,
   Options result = src;
   result.comparator = icmp;
   result.filter_policy = (src.filter_policy != NULL) ? ipolicy : NULL;
+  result.filter_policy_per_level.clear();  // DBImpl wraps them itself
   ClipToRange(&result.max_open_files,    64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64<<10,                      1<<30);
   ClipToRange(&result.max_file_size,     1<<20,                       1<<30);
@@ -129,7 +151,8 @@ Options SanitizeOptions(const std::string& dbname,
 DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
     : env_(raw_options.env),
       internal_comparator_(raw_options.comparator),
-      internal_filter_policy_(raw_options.filter_policy),
+      internal_filter_policy_(raw_options.filter_policy,
+                              raw_options.prefix_extractor),
       options_(SanitizeOptions(dbname, &internal_comparator_,
                                &internal_filter_policy_, raw_options)),
       owns_info_log_(options_.info_log != raw_options.info_log),
@@ -147,8 +170,11 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       tmp_batch_(new WriteBatch),
       bg_compaction_scheduled_(false),
       manual_compaction_(NULL),
+      bg_no_space_(false),
+      no_space_free_zones_(0),
       hm_manager_(Singleton::Gethmmanager()) {
   has_imm_.Release_Store(NULL);
+  hm_manager_->set_log_dbname(dbname_);
 //////
   log_write_time_ = 0;
   compaction_num_ = 0;
@@ -160,6 +186,18 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
 
   versions_ = new VersionSet(dbname_, &options_, table_cache_,
                              &internal_comparator_);
+
+  if (options_.filter_policy != NULL) {
+    const std::vector<const FilterPolicy*>& per_level =
+        raw_options.filter_policy_per_level;
+    for (size_t i = 0; i < per_level.size(); i++) {
+      level_filter_policies_.push_back(
+          per_level[i] != NULL
+              ? new InternalFilterPolicy(per_level[i],
+                                         raw_options.prefix_extractor)
+              : NULL);
+    }
+  }
 }
 
 DBImpl::~DBImpl() {
@@ -174,6 +212,7 @@ DBImpl::~DBImpl() {
   if (db_lock_ != NULL) {
     env_->UnlockFile(db_lock_);
   }
+  hm_manager_->clear_log_dbname(dbname_);
 
   delete versions_;
   if (mem_ != NULL) mem_->Unref();
@@ -182,6 +221,9 @@ DBImpl::~DBImpl() {
   delete log_;
   delete logfile_;
   delete table_cache_;
+  for (size_t i = 0; i < level_filter_policies_.size(); i++) {
+    delete level_filter_policies_[i];
+  }
 
   if (owns_info_log_) {
     delete options_.info_log;
@@ -260,6 +302,17 @@ void DBImpl::MaybeIgnoreError(Status* s) const {
   }
 }
 
+void DBImpl::DeferValueRelease(const std::vector<uint64_t>& files,
+                               std::vector<std::string>* pointers) {
+  mutex_.AssertHeld();
+  if (pointers->empty()) {
+    return;
+  }
+  pending_value_releases_.push_back(ValueRelease());
+  pending_value_releases_.back().files = files;
+  pending_value_releases_.back().pointers.swap(*pointers);
+}
+
 void DBImpl::DeleteObsoleteFiles() {
   if (!bg_error_.ok()) {
     // After a background error, we don't know whether a new version may
@@ -271,6 +324,27 @@ void DBImpl::DeleteObsoleteFiles() {
   std::set<uint64_t> live = pending_outputs_;
   versions_->AddLiveFiles(&live);
 
+  // Value log entries can be overwritten once no version that iterators,
+  // snapshots or reads in flight may pin holds a table pointing to them
+  for (size_t i = 0; i < pending_value_releases_.size(); ) {
+    ValueRelease& r = pending_value_releases_[i];
+    bool referenced = false;
+    for (size_t j = 0; j < r.files.size() && !referenced; j++) {
+      referenced = (live.count(r.files[j]) != 0);
+    }
+    if (referenced) {
+      i++;
+      continue;
+    }
+    for (size_t j = 0; j < r.pointers.size(); j++) {
+      ReleaseValueLog(r.pointers[j]);
+    }
+    pending_value_releases_[i].files.swap(pending_value_releases_.back().files);
+    pending_value_releases_[i].pointers.swap(
+        pending_value_releases_.back().pointers);
+    pending_value_releases_.pop_back();
+  }
+
   std::vector<std::string> filenames;
   env_->GetChildren(dbname_, &filenames); // Ignoring errors on purpose
   std::map<uint64_t, struct Ldbfile*> *table;
@@ -374,6 +448,12 @@ Status DBImpl::Recover(VersionEdit* edit, bool *save_manifest) {
   if (!s.ok()) {
     return s;
   }
+  std::map<uint64_t, struct Ldbfile*> *table;
+  hm_manager_->get_table(&table);
+  for (std::map<uint64_t, struct Ldbfile*>::iterator it = table->begin();
+       it != table->end(); ++it) {
+    filenames.push_back(TableFileName("", it->first).substr(1));
+  }
   std::set<uint64_t> expected;
   versions_->AddLiveFiles(&expected);
   uint64_t number;
@@ -539,21 +619,29 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
 }
 
 Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+                                Version* base,
+                                std::vector<std::string>* value_pointers) {
   mutex_.AssertHeld();
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
   meta.number = versions_->NewFileNumber();
   pending_outputs_.insert(meta.number);
+  trace_event(kTraceFlushBegin, 0, meta.number);
   Iterator* iter = mem->NewIterator();
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long) meta.number);
 
   Status s;
   WritableFile* file;
+  TableCompressionStats cstats;
+  std::vector<std::string> pointers;
   {
     mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta,&file);
+    Options flush_options = options_;
+    flush_options.compression = CompressionForLevel(options_, 0);
+    flush_options.filter_policy = FilterPolicyForLevel(0);
+    s = BuildTable(dbname_, env_, flush_options, table_cache_, iter, &meta,
+                   &file, &cstats, &pointers);
     mutex_.Lock();
   }
 
@@ -567,16 +655,45 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
       level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
     }
     file->Setlevel(level);
-    file->Sync();
+    s = file->Sync();
 #if Verify_Table
-    const char* buf_file=file->Getbuf();
-    Iterator* it = table_cache_->NewIterator(ReadOptions(),meta.number,meta.file_size,NULL,0,buf_file);
-    s = it->status();
-    delete it;
+    if (s.ok()) {
+      const char* buf_file=file->Getbuf();
+      Iterator* it = table_cache_->NewIterator(ReadOptions(),meta.number,meta.file_size,NULL,0,buf_file);
+      s = it->status();
+      delete it;
+    }
 #endif
     delete file;
-    edit->AddFile(level, meta.number, meta.file_size,
-                  meta.smallest, meta.largest);
+    if (s.ok()) {
+      edit->AddFile(level, meta.number, meta.file_size,
+                    meta.smallest, meta.largest);
+      if (value_pointers != NULL) {
+        value_pointers->swap(pointers);
+      }
+    } else {
+      // No version will point at the values the table was to hold
+      ReleaseValueLog(pointers);
+    }
+  }
+
+  // Range deletions move from the memtable to the version, even when the
+  // memtable held nothing else.  Tables numbered below meta.number hold
+  // only entries older than them.
+  if (s.ok()) {
+    Iterator* range_iter = mem->NewRangeDelIterator();
+    for (range_iter->SeekToFirst(); range_iter->Valid(); range_iter->Next()) {
+      ParsedInternalKey ikey;
+      if (ParseInternalKey(range_iter->key(), &ikey)) {
+        RangeTombstone t;
+        t.begin = ikey.user_key.ToString();
+        t.end = range_iter->value().ToString();
+        t.seq = ikey.sequence;
+        t.file_mark = meta.number;
+        edit->AddRangeDeletion(t);
+      }
+    }
+    delete range_iter;
   }
 
   Log(options_.info_log, "Level-%d table #%llu: %lld bytes %s",
@@ -590,19 +707,23 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros;
   stats.bytes_written = meta.file_size;
+  stats.AddCompression(cstats);
   stats_[level].Add(stats);
+  trace_event(kTraceFlushEnd, level, meta.number, meta.file_size, stats.micros);
   return s;
 }
 
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
   assert(imm_ != NULL);
+  const uint64_t start_micros = env_->NowMicros();
 
   // Save the contents of the memtable as a new Table
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  std::vector<std::string> value_pointers;
+  Status s = WriteLevel0Table(imm_, &edit, base, &value_pointers);
   base->Unref();
 
   if (s.ok() && shutting_down_.Acquire_Load()) {
@@ -622,7 +743,10 @@ void DBImpl::CompactMemTable() {
     imm_ = NULL;
     has_imm_.Release_Store(NULL);
     DeleteObsoleteFiles();
+    hm_manager_->add_latency(kLatencyFlush, env_->NowMicros() - start_micros);
   } else {
+    // The flush is retried from the memtable, which writes its values again
+    ReleaseValueLog(value_pointers);
     RecordBackgroundError(s);
   }
 }
@@ -667,7 +791,8 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
   }
 
   MutexLock l(&mutex_);
-  while (!manual.done && !shutting_down_.Acquire_Load() && bg_error_.ok()) {
+  while (!manual.done && !shutting_down_.Acquire_Load() && bg_error_.ok() &&
+         !bg_no_space_) {
     if (manual_compaction_ == NULL) {  // Idle
       manual_compaction_ = &manual;
       MaybeScheduleCompaction();
@@ -687,11 +812,12 @@ Status DBImpl::TEST_CompactMemTable() {
   if (s.ok()) {
     // Wait until the compaction completes
     MutexLock l(&mutex_);
-    while (imm_ != NULL && bg_error_.ok()) {
+    while (imm_ != NULL && bg_error_.ok() && !bg_no_space_) {
       bg_cv_.Wait();
     }
     if (imm_ != NULL) {
-      s = bg_error_;
+      s = bg_error_.ok() ? Status::NoSpace("memtable dump out of zones")
+                         : bg_error_;
     }
   }
   return s;
@@ -699,12 +825,32 @@ Status DBImpl::TEST_CompactMemTable() {
 
 void DBImpl::RecordBackgroundError(const Status& s) {
   mutex_.AssertHeld();
-  if (bg_error_.ok()) {
+  if (s.IsNoSpace()) {
+    // Not fatal: writers are turned away until zones are freed
+    no_space_free_zones_ = hm_manager_->get_free_zone_num();
+    if (!bg_no_space_) {
+      bg_no_space_ = true;
+      Log(options_.info_log, "Background work out of zones (%llu free): %s\n",
+          static_cast<unsigned long long>(no_space_free_zones_),
+          s.ToString().c_str());
+    }
+    bg_cv_.SignalAll();
+  } else if (bg_error_.ok()) {
     bg_error_ = s;
     bg_cv_.SignalAll();
   }
 }
 
+bool DBImpl::WaitingForZones() {
+  mutex_.AssertHeld();
+  if (bg_no_space_ &&
+      hm_manager_->get_free_zone_num() > no_space_free_zones_) {
+    bg_no_space_ = false;
+    Log(options_.info_log, "Free zones recovered, resuming background work\n");
+  }
+  return bg_no_space_;
+}
+
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
   if (bg_compaction_scheduled_) {
@@ -713,9 +859,12 @@ void DBImpl::MaybeScheduleCompaction() {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
+  } else if (WaitingForZones() && !hm_manager_->need_zone_clean()) {
+    // Nothing can make progress until zones are freed
   } else if (imm_ == NULL &&
              manual_compaction_ == NULL &&
-             !versions_->NeedsCompaction()) {
+             !versions_->NeedsCompaction() &&
+             !hm_manager_->need_zone_clean()) {
     // No work to be done
   } else {
     bg_compaction_scheduled_ = true;
@@ -736,6 +885,14 @@ void DBImpl::BackgroundCall() {
     // No more background work after a background error.
   } else {
     BackgroundCompaction();
+    if (bg_no_space_) {
+      // Zones freed by cleaning up after the failure don't make a retry
+      // any more likely to succeed
+      no_space_free_zones_ = hm_manager_->get_free_zone_num();
+    }
+    if (bg_error_.ok() && !shutting_down_.Acquire_Load()) {
+      ApplyRangeDeletions();
+    }
   }
 
   bg_compaction_scheduled_ = false;
@@ -746,14 +903,140 @@ void DBImpl::BackgroundCall() {
   bg_cv_.SignalAll();
 }
 
+void DBImpl::ApplyRangeDeletions() {
+  mutex_.AssertHeld();
+  Version* current = versions_->current();
+  const std::vector<RangeTombstone>& tombstones = current->range_dels();
+  if (tombstones.empty()) {
+    range_del_clean_marks_.clear();
+    return;
+  }
+
+  const SequenceNumber smallest_snapshot =
+      snapshots_.empty() ? versions_->LastSequence()
+                         : snapshots_.oldest()->number_;
+  const Comparator* ucmp = user_comparator();
+  VersionEdit edit;
+  std::set<uint64_t> dropped;
+  std::vector<FileMetaData*> dropped_files;
+  std::map<SequenceNumber, uint64_t> clean_marks;
+  int retired = 0;
+  for (size_t i = 0; i < tombstones.size(); i++) {
+    const RangeTombstone& t = tombstones[i];
+    if (t.seq > smallest_snapshot) {
+      // Some snapshot still sees the deleted entries
+      continue;
+    }
+    // Every table written from now on lacks the entries the range hides,
+    // so once no older table overlaps the range it can be forgotten.
+    std::map<SequenceNumber, uint64_t>::const_iterator mark =
+        range_del_clean_marks_.find(t.seq);
+    const uint64_t clean_mark = (mark != range_del_clean_marks_.end())
+        ? mark->second : versions_->NewFileNumber();
+
+    InternalKey begin(t.begin, kMaxSequenceNumber, kValueTypeForSeek);
+    InternalKey end(t.end, 0, static_cast<ValueType>(0));
+    bool stale = false;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      std::vector<FileMetaData*> inputs;
+      current->GetOverlappingInputs(level, &begin, &end, &inputs);
+      for (size_t j = 0; j < inputs.size(); j++) {
+        FileMetaData* f = inputs[j];
+        if (dropped.count(f->number) != 0) {
+          continue;
+        }
+        const Slice smallest = f->smallest.user_key();
+        const Slice largest = f->largest.user_key();
+        if (f->number < t.file_mark &&
+            ucmp->Compare(smallest, t.begin) >= 0 &&
+            ucmp->Compare(largest, t.end) < 0) {
+          // Every entry of the table is hidden: drop it unread
+          edit.DeleteFile(level, f->number);
+          dropped.insert(f->number);
+          dropped_files.push_back(f);
+        } else if (f->number < clean_mark &&
+                   ucmp->Compare(largest, t.begin) >= 0 &&
+                   ucmp->Compare(smallest, t.end) < 0) {
+          stale = true;
+        }
+      }
+    }
+    if (stale) {
+      clean_marks[t.seq] = clean_mark;
+    } else {
+      edit.DeleteRangeDeletion(t.seq);
+      retired++;
+    }
+  }
+  range_del_clean_marks_.swap(clean_marks);
+  if (dropped.empty() && retired == 0) {
+    return;
+  }
+
+  // The value log entries of the dropped tables die with them
+  std::vector<std::string> dropped_values;
+  Status s;
+  current->Ref();
+  if (options_.value_separation_threshold > 0) {
+    mutex_.Unlock();
+    for (size_t i = 0; s.ok() && i < dropped_files.size(); i++) {
+      Iterator* iter = table_cache_->NewIterator(
+          ReadOptions(), dropped_files[i]->number, dropped_files[i]->file_size);
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        ParsedInternalKey ikey;
+        if (ParseInternalKey(iter->key(), &ikey) &&
+            ikey.type == kTypeValueIndex) {
+          dropped_values.push_back(iter->value().ToString());
+        }
+      }
+      s = iter->status();
+      delete iter;
+    }
+    mutex_.Lock();
+  }
+  if (s.ok()) {
+    s = versions_->LogAndApply(&edit, &mutex_);
+  }
+  current->Unref();
+  if (s.ok()) {
+    std::vector<uint64_t> files(dropped.begin(), dropped.end());
+    DeferValueRelease(files, &dropped_values);
+    Log(options_.info_log, "Range deletions: dropped %d tables, retired %d",
+        static_cast<int>(dropped.size()), retired);
+    DeleteObsoleteFiles();
+  } else {
+    RecordBackgroundError(s);
+  }
+}
+
+void DBImpl::UpdateBackgroundPressure() {
+  mutex_.AssertHeld();
+  hm_manager_->update_bg_pressure(versions_->NumLevelFiles(0),
+                                  versions_->EstimatedPendingCompactionBytes());
+}
+
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
+  UpdateBackgroundPressure();
 
-  if (imm_ != NULL) {
+  if (imm_ != NULL && !WaitingForZones()) {
     CompactMemTable();
     return;
   }
 
+  if (hm_manager_->need_zone_clean()) {
+    // Last resort when compaction alone doesn't free zones fast enough:
+    // relocate the live tables of the least valid zones so they can be reset.
+    mutex_.Unlock();
+    int cleaned = hm_manager_->clean_zones(ZONE_CLEAN_MAX);
+    mutex_.Lock();
+    Log(options_.info_log, "Cleaned %d zones, %llu free\n", cleaned,
+        static_cast<unsigned long long>(hm_manager_->get_free_zone_num()));
+  }
+  if (WaitingForZones()) {
+    return;
+  }
+
   Compaction* c;
   bool is_manual = (manual_compaction_ != NULL);
   InternalKey manual_end;
@@ -805,9 +1088,20 @@ void DBImpl::BackgroundCompaction() {
           versions_->LevelSummary(&tmp));
 
     }
-    else {
-      hm_manager_->move_file(f->number,c->level() + 1);
-    
+    else if (hm_manager_->move_file(f->number,c->level() + 1) < 0) {
+      // The table stays in its old zone, so the version keeps it at its
+      // old level too
+      if (errno == ENOSPC) {
+        status = Status::NoSpace("trivial move", "no free zone");
+      } else {
+        status = Status::IOError("trivial move", "table not relocated");
+      }
+      RecordBackgroundError(status);
+      Log(options_.info_log, "Move #%lld to level-%d failed: %s\n",
+          static_cast<unsigned long long>(f->number),
+          c->level() + 1,
+          status.ToString().c_str());
+    } else {
       c->edit()->DeleteFile(c->level(), f->number);
       c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
                         f->smallest, f->largest);
@@ -908,11 +1202,49 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   std::string fname = TableFileName(dbname_, file_number);
   Status s = env_->NewWritableFile(fname, &(compact->outfile), compact->compaction->current_level + compact->compaction->dump_grandparents);
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    Options table_options = options_;
+    table_options.compression =
+        CompressionForLevel(options_, compact->current_output()->level);
+    table_options.filter_policy =
+        FilterPolicyForLevel(compact->current_output()->level);
+    compact->builder = new TableBuilder(table_options, compact->outfile);
+    if (!compact->compression_dict.empty()) {
+      compact->builder->SetCompressionDictionary(compact->compression_dict);
+    }
+    compact->output_limit = CompactionOutputLimit(compact->current_output()->level,
+                                                  compact->compaction->MaxOutputFileSize());
   }
   return s;
 }
 
+// The zone a level is writing only takes an SSTable that fits entirely, so
+// an output of the usual size that overflows it leaves the rest of the zone
+// empty.  Cut the output to the zone's remaining space instead: a tail that
+// is a little larger than the usual size is taken whole, and a smaller one is
+// filled with a short output.
+// Filter policy of the tables written to "level".
+const FilterPolicy* DBImpl::FilterPolicyForLevel(int level) const {
+  if (level_filter_policies_.empty()) {
+    return options_.filter_policy;
+  }
+  const FilterPolicy* policy =
+      (level >= static_cast<int>(level_filter_policies_.size()))
+          ? level_filter_policies_.back()
+          : level_filter_policies_[level];
+  return (policy != NULL) ? policy : options_.filter_policy;
+}
+
+uint64_t DBImpl::CompactionOutputLimit(int level, uint64_t max_size) {
+#if ZONE_FIT_OUTPUT
+  uint64_t remain = hm_manager_->get_level_zone_remaining(level);
+  if (remain >= ZONE_FIT_MIN_TAIL + ZONE_FIT_SLACK &&
+      remain < max_size + ZONE_FIT_MIN_TAIL) {
+    return remain - ZONE_FIT_SLACK;
+  }
+#endif
+  return max_size;
+}
+
 Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
                                           Iterator* input) {
   assert(compact != NULL);
@@ -933,6 +1265,16 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   const uint64_t current_bytes = compact->builder->FileSize();
   compact->current_output()->file_size = current_bytes;
   compact->total_bytes += current_bytes;
+  if (s.ok() && compact->compression_dict.empty()) {
+    compact->builder->TrainCompressionDictionary(&compact->compression_dict);
+  }
+  TableCompressionStats cstats;
+  cstats.raw_bytes = compact->builder->RawDataSize();
+  cstats.stored_bytes = compact->builder->StoredDataSize();
+  cstats.micros = compact->builder->CompressionMicros();
+  mutex_.Lock();
+  stats_[compact->current_output()->level].AddCompression(cstats);
+  mutex_.Unlock();
   delete compact->builder;
   compact->builder = NULL;
 
@@ -987,7 +1329,18 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
     compact->compaction->edit()->AddFile(
         out.level,out.number, out.file_size, out.smallest, out.largest);
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  Status s = versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  if (s.ok()) {
+    // No table of the new version points to these values any more
+    std::vector<uint64_t> files;
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+        files.push_back(compact->compaction->input(which, i)->number);
+      }
+    }
+    DeferValueRelease(files, &compact->dropped_values);
+  }
+  return s;
 }
 
 //////
@@ -1013,6 +1366,9 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
     MyLog("%ld ",compact->compaction->input(1,i)->number);
   }
   MyLog("\n");
+  trace_event(kTraceCompactionBegin, compact->compaction->level(),
+              compact->compaction->num_input_files(0),
+              compact->compaction->num_input_files(1));
 
   assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
   assert(compact->builder == NULL);
@@ -1034,6 +1390,7 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+  const RangeDelMap* range_dels = compact->compaction->range_dels();
   int range_key_index=0;
   bool no_range_key = false;
   bool find_error = false;
@@ -1065,8 +1422,8 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
       last_sequence_for_key = kMaxSequenceNumber;
     } else {
       if (!has_current_user_key ||
-          user_comparator()->Compare(ikey.user_key,
-                                     Slice(current_user_key)) != 0) {
+          internal_comparator_.CompareUserKey(ikey.user_key,
+                                              Slice(current_user_key)) != 0) {
         // First occurrence of this user key
         current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
         has_current_user_key = true;
@@ -1087,9 +1444,17 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
         //     few iterations of this loop (by rule (A) above).
         // Therefore this deletion marker is obsolete and can be dropped.
         drop = true;
+      } else if (range_dels != NULL &&
+                 ikey.sequence < range_dels->MaxCoveringSeq(
+                     ikey.user_key, compact->smallest_snapshot)) {
+        // Hidden by a range deletion that every snapshot sees
+        drop = true;
       }
 
       last_sequence_for_key = ikey.sequence;
+      if (drop && ikey.type == kTypeValueIndex) {
+        compact->dropped_values.push_back(input->value().ToString());
+      }
     }
 #if 0
     Log(options_.info_log,
@@ -1104,7 +1469,7 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
       // Open output file if necessary
       this_key.DecodeFrom(key);
       while(1){
-        if(no_range_key || user_comparator()->Compare(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->smallest.user_key())<0){  //key < The minimum key of the range
+        if(no_range_key || internal_comparator_.CompareUserKey(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->smallest.user_key())<0){  //key < The minimum key of the range
           if (compact->builder == NULL) {
               status = OpenCompactionOutputFile(compact);
               if (!status.ok()) {
@@ -1118,9 +1483,8 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
           compact->current_output()->largest.DecodeFrom(key);
           compact->builder->Add(key, input->value());
 
-          // Close output file if it is big enough
-          if (compact->builder->FileSize() >=
-              compact->compaction->MaxOutputFileSize()) {
+          // Close output file if it is big enough or fills the zone
+          if (compact->builder->FileSize() >= compact->output_limit) {
             status = FinishCompactionOutputFile(compact, input);
             if (!status.ok()) {
               find_error=true;
@@ -1129,7 +1493,7 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
           }
           break;
         }
-        else if(user_comparator()->Compare(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->largest.user_key())>0){  //key > The maximum key of the range
+        else if(internal_comparator_.CompareUserKey(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->largest.user_key())>0){  //key > The maximum key of the range
             
             if(range_key_index==compact->compaction->list_range_key.size()-1){   //no range_key
               no_range_key=true;
@@ -1177,6 +1541,7 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
     compact->c_read_bytes += stats.bytes_read;
     compact->c_write_bytes += stats.bytes_written;
     compact->c_micros += stats.micros;
+    hm_manager_->add_latency(kLatencyGearMerge, stats.micros);
 
     mutex_.Lock();
     stats_[compact->compaction->current_level].Add(stats);
@@ -1219,8 +1584,15 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
 
   mutex_.Lock();
   MyLog4("%ld,%ld,%ld,%.2f\n",++compaction_num_,compact->c_read_bytes/1048576,compact->c_write_bytes/1048576,compact->c_micros*1e-6);
+  trace_event(kTraceCompactionEnd, compact->compaction->level(),
+              compact->c_read_bytes, compact->c_write_bytes, compact->c_micros);
   if (status.ok()) {
+    const uint64_t install_start = env_->NowMicros();
     status = InstallCompactionResults(compact);
+    const uint64_t install_micros = env_->NowMicros() - install_start;
+    hm_manager_->add_latency(kLatencyGearInstall, install_micros);
+    trace_event(kTraceInstall, compact->compaction->level(),
+                compact->outputs.size(), install_micros);
   }
   if (!status.ok()) {
     RecordBackgroundError(status);
@@ -1232,6 +1604,7 @@ Status DBImpl::DoMyCompactionWork(CompactionState* compact){
 }
 
 Status DBImpl::MergeCompactionWork(CompactionState* compact){
+  const uint64_t window_start = env_->NowMicros();
   uint64_t start_micros = env_->NowMicros();
   int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
 
@@ -1241,6 +1614,8 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
   MyLog("Merge Compacting %ld@%d input + %ld@%d list_range_key\n",
       compact->compaction->input_range_key.size(),compact->compaction->current_level,compact->compaction->list_range_key.size(),
       compact->compaction->current_level + 1 + compact->compaction->dump_grandparents);
+  trace_event(kTraceMergeBegin, compact->compaction->current_level,
+              compact->compaction->input_range_key.size());
   if (snapshots_.empty()) {
     compact->smallest_snapshot = versions_->LastSequence();
   } else {
@@ -1260,6 +1635,7 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+  const RangeDelMap* range_dels = compact->compaction->range_dels();
   int range_key_index=0;
   bool no_range_key = false;
   bool find_error = false;
@@ -1301,8 +1677,8 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
         last_sequence_for_key = kMaxSequenceNumber;
       } else {
         if (!has_current_user_key ||
-            user_comparator()->Compare(ikey.user_key,
-                                      Slice(current_user_key)) != 0) {
+            internal_comparator_.CompareUserKey(ikey.user_key,
+                                                Slice(current_user_key)) != 0) {
           // First occurrence of this user key
           current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
           has_current_user_key = true;
@@ -1323,9 +1699,17 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
           //     few iterations of this loop (by rule (A) above).
           // Therefore this deletion marker is obsolete and can be dropped.
           drop = true;
+        } else if (range_dels != NULL &&
+                   ikey.sequence < range_dels->MaxCoveringSeq(
+                       ikey.user_key, compact->smallest_snapshot)) {
+          // Hidden by a range deletion that every snapshot sees
+          drop = true;
         }
 
         last_sequence_for_key = ikey.sequence;
+        if (drop && ikey.type == kTypeValueIndex) {
+          compact->dropped_values.push_back(input->value().ToString());
+        }
       }
 #if 0
     Log(options_.info_log,
@@ -1340,7 +1724,7 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
         // Open output file if necessary
         this_key.DecodeFrom(key);
         while(1){
-          if(no_range_key || user_comparator()->Compare(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->smallest.user_key())<0){  //key < The minimum key of the range
+          if(no_range_key || internal_comparator_.CompareUserKey(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->smallest.user_key())<0){  //key < The minimum key of the range
             if (compact->builder == NULL) {
                 status = OpenCompactionOutputFile(compact);
                 if (!status.ok()) {
@@ -1354,9 +1738,8 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
             compact->current_output()->largest.DecodeFrom(key);
             compact->builder->Add(key, input->value());
 
-            // Close output file if it is big enough
-            if (compact->builder->FileSize() >=
-                compact->compaction->MaxOutputFileSize()) {
+            // Close output file if it is big enough or fills the zone
+            if (compact->builder->FileSize() >= compact->output_limit) {
               status = FinishCompactionOutputFile(compact, input);
               if (!status.ok()) {
                 find_error=true;
@@ -1365,7 +1748,7 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
             }
             break;
           }
-          else if(user_comparator()->Compare(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->largest.user_key())>0){  //key > The maximum key of the range
+          else if(internal_comparator_.CompareUserKey(this_key.user_key(),compact->compaction->list_range_key[range_key_index]->largest.user_key())>0){  //key > The maximum key of the range
               
               if(range_key_index==compact->compaction->list_range_key.size()-1){   //no range_key
                 no_range_key=true;
@@ -1427,6 +1810,13 @@ Status DBImpl::MergeCompactionWork(CompactionState* compact){
     }
     
   }
+  const uint64_t window_micros = env_->NowMicros() - window_start;
+  hm_manager_->add_latency(
+      static_cast<LatencyType>(kLatencyGearWindow +
+                               compact->compaction->current_level),
+      window_micros);
+  trace_event(kTraceMergeEnd, compact->compaction->current_level,
+              window_micros);
 
   if (status.ok() && shutting_down_.Acquire_Load()) {
     MyLog("shutting_down_\n");
@@ -1458,6 +1848,9 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     MyLog("%ld ",compact->compaction->input(1,i)->number);
   }
   MyLog("\n");
+  trace_event(kTraceCompactionBegin, compact->compaction->level(),
+              compact->compaction->num_input_files(0),
+              compact->compaction->num_input_files(1));
 
   assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
   assert(compact->builder == NULL);
@@ -1478,6 +1871,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+  const RangeDelMap* range_dels = compact->compaction->range_dels();
   for (; input->Valid() && !shutting_down_.Acquire_Load(); ) {
     // Prioritize immutable compaction work
     if (has_imm_.NoBarrier_Load() != NULL) {
@@ -1511,8 +1905,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       last_sequence_for_key = kMaxSequenceNumber;
     } else {
       if (!has_current_user_key ||
-          user_comparator()->Compare(ikey.user_key,
-                                     Slice(current_user_key)) != 0) {
+          internal_comparator_.CompareUserKey(ikey.user_key,
+                                              Slice(current_user_key)) != 0) {
         // First occurrence of this user key
         current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
         has_current_user_key = true;
@@ -1533,9 +1927,17 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         //     few iterations of this loop (by rule (A) above).
         // Therefore this deletion marker is obsolete and can be dropped.
         drop = true;
+      } else if (range_dels != NULL &&
+                 ikey.sequence < range_dels->MaxCoveringSeq(
+                     ikey.user_key, compact->smallest_snapshot)) {
+        // Hidden by a range deletion that every snapshot sees
+        drop = true;
       }
 
       last_sequence_for_key = ikey.sequence;
+      if (drop && ikey.type == kTypeValueIndex) {
+        compact->dropped_values.push_back(input->value().ToString());
+      }
     }
 #if 0
     Log(options_.info_log,
@@ -1561,9 +1963,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       compact->current_output()->largest.DecodeFrom(key);
       compact->builder->Add(key, input->value());
 
-      // Close output file if it is big enough
-      if (compact->builder->FileSize() >=
-          compact->compaction->MaxOutputFileSize()) {
+      // Close output file if it is big enough or fills the zone
+      if (compact->builder->FileSize() >= compact->output_limit) {
         status = FinishCompactionOutputFile(compact, input);
         if (!status.ok()) {
           break;
@@ -1601,8 +2002,13 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   mutex_.Lock();
   stats_[compact->compaction->level() + 1].Add(stats);
   MyLog4("%ld,%ld,%ld,%.2f\n",++compaction_num_,stats.bytes_read/1048576,stats.bytes_written/1048576,stats.micros*1e-6);
+  trace_event(kTraceCompactionEnd, compact->compaction->level(),
+              stats.bytes_read, stats.bytes_written, stats.micros);
   if (status.ok()) {
+    const uint64_t install_start = env_->NowMicros();
     status = InstallCompactionResults(compact);
+    trace_event(kTraceInstall, compact->compaction->level(),
+                compact->outputs.size(), env_->NowMicros() - install_start);
   }
   if (!status.ok()) {
     RecordBackgroundError(status);
@@ -1619,6 +2025,8 @@ struct IterState {
   Version* version;
   MemTable* mem;
   MemTable* imm;
+  PrefixSeekState* prefix_state;
+  RangeDelMap* range_dels;
 };
 
 static void CleanupIteratorState(void* arg1, void* arg2) {
@@ -1628,14 +2036,31 @@ static void CleanupIteratorState(void* arg1, void* arg2) {
   if (state->imm != NULL) state->imm->Unref();
   state->version->Unref();
   state->mu->Unlock();
+  delete state->prefix_state;
+  delete state->range_dels;
   delete state;
 }
 }  // namespace
 
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
                                       SequenceNumber* latest_snapshot,
-                                      uint32_t* seed) {
+                                      uint32_t* seed,
+                                      PrefixSeekState** prefix_state,
+                                      RangeDelMap** range_dels) {
   IterState* cleanup = new IterState;
+  cleanup->prefix_state = NULL;
+  cleanup->range_dels = NULL;
+  if (prefix_state != NULL) {
+    // Without filters no table can be skipped, the DBIter still bounds
+    // the scan to the prefix
+    if (options.prefix_same_as_start && options_.prefix_extractor != NULL &&
+        options_.filter_policy != NULL) {
+      cleanup->prefix_state = new PrefixSeekState;
+      cleanup->prefix_state->prefix_extractor = options_.prefix_extractor;
+      cleanup->prefix_state->enabled = false;
+    }
+    *prefix_state = cleanup->prefix_state;
+  }
   mutex_.Lock();
   *latest_snapshot = versions_->LastSequence();
 
@@ -1647,7 +2072,31 @@ Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
     list.push_back(imm_->NewIterator());
     imm_->Ref();
   }
-  versions_->current()->AddIterators(options, &list);
+  versions_->current()->AddIterators(options, &list, cleanup->prefix_state);
+  if (range_dels != NULL) {
+    RangeDelMap* map = new RangeDelMap(user_comparator());
+    const std::vector<RangeTombstone>& tombstones =
+        versions_->current()->range_dels();
+    for (size_t i = 0; i < tombstones.size(); i++) {
+      map->Add(tombstones[i].begin, tombstones[i].end, tombstones[i].seq);
+    }
+    Iterator* range_iter = mem_->NewRangeDelIterator();
+    map->AddFrom(range_iter);
+    delete range_iter;
+    if (imm_ != NULL) {
+      range_iter = imm_->NewRangeDelIterator();
+      map->AddFrom(range_iter);
+      delete range_iter;
+    }
+    if (map->empty()) {
+      delete map;
+      map = NULL;
+    } else {
+      map->Finish();
+    }
+    cleanup->range_dels = map;
+    *range_dels = map;
+  }
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_, &list[0], list.size());
   versions_->current()->Ref();
@@ -1678,6 +2127,7 @@ Status DBImpl::Get(const ReadOptions& options,
                    const Slice& key,
                    std::string* value) {
   Status s;
+  perf::BeginOperation();
   MutexLock l(&mutex_);
   SequenceNumber snapshot;
   if (options.snapshot != NULL) {
@@ -1721,16 +2171,87 @@ Status DBImpl::Get(const ReadOptions& options,
   return s;
 }
 
+std::vector<Status> DBImpl::MultiGet(const ReadOptions& options,
+                                     const std::vector<Slice>& keys,
+                                     std::vector<std::string>* values) {
+  const size_t n = keys.size();
+  std::vector<Status> statuses(n);
+  values->resize(n);
+
+  perf::BeginOperation();
+  MutexLock l(&mutex_);
+  SequenceNumber snapshot;
+  if (options.snapshot != NULL) {
+    snapshot = reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_;
+  } else {
+    snapshot = versions_->LastSequence();
+  }
+
+  MemTable* mem = mem_;
+  MemTable* imm = imm_;
+  Version* current = versions_->current();
+  mem->Ref();
+  if (imm != NULL) imm->Ref();
+  current->Ref();
+
+  bool have_stat_update = false;
+  Version::GetStats stats;
+
+  // Unlock while reading from files and memtables
+  {
+    mutex_.Unlock();
+    // Resolve what we can from the memtables; the rest of the batch is
+    // handed to the current version in one go so that its table probes
+    // can be ordered by location on the drive.
+    std::vector<LookupKey*> lkeys(n);
+    std::vector<bool> pending(n, false);
+    bool need_files = false;
+    for (size_t i = 0; i < n; i++) {
+      lkeys[i] = new LookupKey(keys[i], snapshot);
+      if (mem->Get(*lkeys[i], &(*values)[i], &statuses[i])) {
+        // Done
+      } else if (imm != NULL && imm->Get(*lkeys[i], &(*values)[i],
+                                         &statuses[i])) {
+        // Done
+      } else {
+        pending[i] = true;
+        need_files = true;
+      }
+    }
+    if (need_files) {
+      current->MultiGet(options, lkeys, &pending, values, &statuses, &stats);
+      have_stat_update = true;
+    }
+    for (size_t i = 0; i < n; i++) {
+      delete lkeys[i];
+    }
+    mutex_.Lock();
+  }
+
+  if (have_stat_update && current->UpdateStats(stats)) {
+    MaybeScheduleCompaction();
+  }
+  mem->Unref();
+  if (imm != NULL) imm->Unref();
+  current->Unref();
+  return statuses;
+}
+
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
-  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed);
+  PrefixSeekState* prefix_state;
+  RangeDelMap* range_dels;
+  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed,
+                                       &prefix_state, &range_dels);
   return NewDBIterator(
       this, user_comparator(), iter,
       (options.snapshot != NULL
        ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
        : latest_snapshot),
-      seed);
+      seed, options,
+      (options.prefix_same_as_start ? options_.prefix_extractor : NULL),
+      prefix_state, range_dels);
 }
 
 void DBImpl::RecordReadSample(Slice key) {
@@ -1759,6 +2280,14 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
   return DB::Delete(options, key);
 }
 
+Status DBImpl::DeleteRange(const WriteOptions& options,
+                           const Slice& begin, const Slice& end) {
+  if (user_comparator()->Compare(begin, end) >= 0) {
+    return Status::InvalidArgument("empty range deletion");
+  }
+  return DB::DeleteRange(options, begin, end);
+}
+
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   Writer w(&mutex_);
   w.batch = my_batch;
@@ -1909,6 +2438,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       // individual write by 1ms to reduce latency variance.  Also,
       // this delay hands over some CPU to the compaction thread in
       // case it is sharing the same core as the writer.
+      UpdateBackgroundPressure();
       mutex_.Unlock();
       env_->SleepForMicroseconds(1000);
       allow_delay = false;  // Do not delay a single write more than once
@@ -1917,6 +2447,12 @@ Status DBImpl::MakeRoomForWrite(bool force) {
                (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
       // There is room in current memtable
       break;
+    } else if (WaitingForZones()) {
+      // Background work ran out of zones, so neither the previous memtable
+      // nor level-0 drains until some are freed.
+      MaybeScheduleCompaction();
+      s = Status::NoSpace("background work out of zones");
+      break;
     } else if (imm_ != NULL) {
       // We have filled up the current memtable, but the previous
       // one is still being compacted, so we wait.
@@ -1925,7 +2461,16 @@ Status DBImpl::MakeRoomForWrite(bool force) {
     } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
       // There are too many level-0 files.
       Log(options_.info_log, "Too many L0 files; waiting...\n");
+      UpdateBackgroundPressure();
       bg_cv_.Wait();
+    } else if (hm_manager_->is_out_of_space()) {
+      // The free zones are down to the reserve that compaction needs to
+      // make progress, so don't start another memtable dump.  Writers get
+      // a clean error and may retry once compaction or the zone cleaner
+      // has freed zones.
+      MaybeScheduleCompaction();
+      s = Status::NoSpace("free zones below reserve");
+      break;
     } else {
       // Attempt to switch to a new memtable and trigger compaction of old
       assert(versions_->PrevLogNumber() == 0);
@@ -1976,11 +2521,11 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
       return true;
     }
   } else if (in == "stats") {
-    char buf[200];
+    char buf[300];
     snprintf(buf, sizeof(buf),
-             "                               Compactions\n"
-             "Level  Files Size(MB) Time(sec) Read(MB) Write(MB)\n"
-             "--------------------------------------------------\n"
+             "                               Compactions          Compression\n"
+             "Level  Files Size(MB) Time(sec) Read(MB) Write(MB) Ratio Time(sec)\n"
+             "--------------------------------------------------------------------\n"
              );
     value->append(buf);
     int myfiles=0;
@@ -1988,18 +2533,22 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
     double mytime=0;
     double myread=0;
     double mywrite=0;
+    CompactionStats total;
     for (int level = 0; level < config::kNumLevels; level++) {
       int files = versions_->NumLevelFiles(level);
       if (stats_[level].micros > 0 || files > 0) {
         snprintf(
             buf, sizeof(buf),
-            "%3d %8d %8.0f %9.0f %8.0f %9.0f\n",
+            "%3d %8d %8.0f %9.0f %8.0f %9.0f %5.2f %9.1f\n",
             level,
             files,
             versions_->NumLevelBytes(level) / 1048576.0,
             stats_[level].micros / 1e6,
             stats_[level].bytes_read / 1048576.0,
-            stats_[level].bytes_written / 1048576.0);
+            stats_[level].bytes_written / 1048576.0,
+            stats_[level].CompressionRatio(),
+            stats_[level].compress_micros / 1e6);
+        total.Add(stats_[level]);
         value->append(buf);
         myfiles += files;
         mydbsize += versions_->NumLevelBytes(level) / 1048576.0;
@@ -2010,14 +2559,53 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
     }
     snprintf(
         buf, sizeof(buf),
-        "all %8d %8.0f %9.0f %8.0f %9.0f",
+        "all %8d %8.0f %9.0f %8.0f %9.0f %5.2f %9.1f",
         myfiles,
         mydbsize,
         mytime,
         myread,
-        mywrite);
+        mywrite,
+        total.CompressionRatio(),
+        total.compress_micros / 1e6);
     value->append(buf);
     return true;
+  } else if (in == "compaction-micros") {
+    uint64_t micros = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      micros += stats_[level].micros;
+    }
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(micros));
+    *value = buf;
+    return true;
+  } else if (in == "zone-fill") {
+    char buf[100];
+    for (int level = 0; level < config::kNumLevels; level++) {
+      snprintf(buf, sizeof(buf), "%d %.2f %llu\n", level,
+               hm_manager_->get_level_fill_percent(level),
+               static_cast<unsigned long long>(
+                   hm_manager_->get_level_zone_remaining(level)));
+      value->append(buf);
+    }
+    return true;
+  } else if (in == "zone-stats") {
+    hm_manager_->get_zone_stats(value);
+    return true;
+  } else if (in == "zone-valid-histogram") {
+    hm_manager_->get_zone_valid_histogram(value);
+    return true;
+  } else if (in == "window-stats") {
+    hm_manager_->get_window_stats(value);
+    return true;
+  } else if (in == "zone-stats-json") {
+    hm_manager_->get_stats_json(value);
+    return true;
+  } else if (in == "latency") {
+    hm_manager_->get_latency_stats(value);
+    return true;
+  } else if (in == "latency-json") {
+    hm_manager_->get_latency_json(value);
+    return true;
   } else if (in == "sstables") {
     *value = versions_->current()->DebugString();
     return true;
@@ -2039,6 +2627,10 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   return false;
 }
 
+void DBImpl::ResetStats() {
+  hm_manager_->reset_stats();
+}
+
 void DBImpl::GetApproximateSizes(
     const Range* range, int n,
     uint64_t* sizes) {
@@ -2079,6 +2671,13 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+Status DB::DeleteRange(const WriteOptions& opt,
+                       const Slice& begin, const Slice& end) {
+  WriteBatch batch;
+  batch.DeleteRange(begin, end);
+  return Write(opt, &batch);
+}
+
 DB::~DB() { }
 
 Status DB::Open(const Options& options, const std::string& dbname,
@@ -6,7 +6,10 @@
 #define STORAGE_LEVELDB_DB_DB_IMPL_H_
 
 #include <deque>
+#include <map>
 #include <set>
+#include <vector>
+#include "db/builder.h"
 #include "db/dbformat.h"
 #include "db/log_writer.h"
 #include "db/snapshot.h"
@@ -20,6 +23,7 @@
 namespace leveldb {
 
 class MemTable;
+class RangeDelMap;
 class TableCache;
 class Version;
 class VersionEdit;
@@ -40,14 +44,20 @@ class DBImpl : public DB {
   // Implementations of the DB interface
   virtual Status Put(const WriteOptions&, const Slice& key, const Slice& value);
   virtual Status Delete(const WriteOptions&, const Slice& key);
+  virtual Status DeleteRange(const WriteOptions&,
+                             const Slice& begin, const Slice& end);
   virtual Status Write(const WriteOptions& options, WriteBatch* updates);
   virtual Status Get(const ReadOptions& options,
                      const Slice& key,
                      std::string* value);
+  virtual std::vector<Status> MultiGet(const ReadOptions& options,
+                                       const std::vector<Slice>& keys,
+                                       std::vector<std::string>* values);
   virtual Iterator* NewIterator(const ReadOptions&);
   virtual const Snapshot* GetSnapshot();
   virtual void ReleaseSnapshot(const Snapshot* snapshot);
   virtual bool GetProperty(const Slice& property, std::string* value);
+  virtual void ResetStats();
   virtual void GetApproximateSizes(const Range* range, int n, uint64_t* sizes);
   virtual void CompactRange(const Slice* begin, const Slice* end);
 
@@ -78,9 +88,16 @@ class DBImpl : public DB {
   struct CompactionState;
   struct Writer;
 
+  // If "prefix_state" is non-NULL, set it to the state that enables prefix
+  // filtering in the table iterators, or to NULL when the options do not
+  // allow it.  If "range_dels" is non-NULL, set it to the range deletions
+  // of the iterated state, or to NULL when there are none.  Both are owned
+  // by the returned iterator.
   Iterator* NewInternalIterator(const ReadOptions&,
                                 SequenceNumber* latest_snapshot,
-                                uint32_t* seed);
+                                uint32_t* seed,
+                                PrefixSeekState** prefix_state = NULL,
+                                RangeDelMap** range_dels = NULL);
 
   Status NewDB();
 
@@ -95,6 +112,12 @@ class DBImpl : public DB {
   // Delete any unneeded files and stale in-memory entries.
   void DeleteObsoleteFiles();
 
+  // Release the value log entries "*pointers" once none of "files", the
+  // tables they were read from, is live any more.  Clears *pointers.
+  void DeferValueRelease(const std::vector<uint64_t>& files,
+                         std::vector<std::string>* pointers)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Compact the in-memory write buffer to disk.  Switches to a new
   // log-file/memtable and writes a new descriptor iff successful.
   // Errors are recorded in bg_error_.
@@ -104,25 +127,47 @@ class DBImpl : public DB {
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // On success the value log entries the new table points to are stored
+  // in *value_pointers, if non-NULL, for the caller to release should the
+  // edit not be installed.
+  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base,
+                          std::vector<std::string>* value_pointers = NULL)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Report the level-0 file count and pending compaction bytes to the
+  // zone manager so that an auto-tuned background rate limit can follow
+  // the write pressure.
+  void UpdateBackgroundPressure() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   WriteBatch* BuildBatchGroup(Writer** last_writer);
 
+  // A NoSpace status is not latched into bg_error_: the failed work is
+  // retried once zones have been freed.
   void RecordBackgroundError(const Status& s);
 
+  // True while background work that ran out of zones can't be retried
+  // because no zone has been freed since.
+  bool WaitingForZones() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
   void BackgroundCall();
   void  BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Drop the tables that a range deletion seen by every snapshot covers
+  // entirely, and forget the range deletions that hide nothing any more.
+  void ApplyRangeDeletions() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status OpenCompactionOutputFile(CompactionState* compact);
+  uint64_t CompactionOutputLimit(int level, uint64_t max_size);
+  const FilterPolicy* FilterPolicyForLevel(int level) const;
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
@@ -140,6 +185,8 @@ class DBImpl : public DB {
   const InternalKeyComparator internal_comparator_;
   const InternalFilterPolicy internal_filter_policy_;
   const Options options_;  // options_.comparator == &internal_comparator_
+  // Wrappers of Options::filter_policy_per_level (NULL where it is NULL)
+  std::vector<InternalFilterPolicy*> level_filter_policies_;
   bool owns_info_log_;
   bool owns_cache_;
   const std::string dbname_;
@@ -168,6 +215,10 @@ class DBImpl : public DB {
 
   SnapshotList snapshots_;
 
+  // Range deletion sequence number => file number from which on no table
+  // holds the entries it hides.  Rebuilt after a restart.
+  std::map<SequenceNumber, uint64_t> range_del_clean_marks_;
+
   // Set of table files to protect from deletion because they are
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_;
@@ -190,6 +241,18 @@ class DBImpl : public DB {
   // Have we encountered a background error in paranoid mode?
   Status bg_error_;
 
+  // Value log pointers dropped from the tables "files", waiting for the
+  // last version holding one of them to go.
+  struct ValueRelease {
+    std::vector<uint64_t> files;
+    std::vector<std::string> pointers;
+  };
+  std::vector<ValueRelease> pending_value_releases_;
+
+  // Did background work run out of zones, and how many were free then?
+  bool bg_no_space_;
+  uint64_t no_space_free_zones_;
+
   //////added by lzw
     HMManager *hm_manager_;
 
@@ -204,13 +267,34 @@ class DBImpl : public DB {
     int64_t micros;
     int64_t bytes_read;
     int64_t bytes_written;
+    // Data blocks of the tables written to the level, before and after
+    // compression, and the time spent compressing them
+    int64_t raw_data_bytes;
+    int64_t stored_data_bytes;
+    int64_t compress_micros;
 
-    CompactionStats() : micros(0), bytes_read(0), bytes_written(0) { }
+    CompactionStats()
+        : micros(0), bytes_read(0), bytes_written(0), raw_data_bytes(0),
+          stored_data_bytes(0), compress_micros(0) { }
 
     void Add(const CompactionStats& c) {
       this->micros += c.micros;
       this->bytes_read += c.bytes_read;
       this->bytes_written += c.bytes_written;
+      this->raw_data_bytes += c.raw_data_bytes;
+      this->stored_data_bytes += c.stored_data_bytes;
+      this->compress_micros += c.compress_micros;
+    }
+
+    void AddCompression(const TableCompressionStats& c) {
+      this->raw_data_bytes += c.raw_bytes;
+      this->stored_data_bytes += c.stored_bytes;
+      this->compress_micros += c.micros;
+    }
+
+    double CompressionRatio() const {
+      return stored_data_bytes > 0 ? 1.0 * raw_data_bytes / stored_data_bytes
+                                   : 1.0;
     }
   };
   CompactionStats stats_[config::kNumLevels];
@@ -7,11 +7,14 @@
 #include "db/filename.h"
 #include "db/db_impl.h"
 #include "db/dbformat.h"
+#include "db/range_del.h"
+#include "db/value_log.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "port/port.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/perf_context_imp.h"
 #include "util/random.h"
 
 namespace leveldb {
@@ -49,15 +52,28 @@ class DBIter: public Iterator {
   };
 
   DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
-         uint32_t seed)
+         uint32_t seed, const ReadOptions& options,
+         const SliceTransform* prefix_extractor, PrefixSeekState* prefix_state,
+         const RangeDelMap* range_dels)
       : db_(db),
         user_comparator_(cmp),
         iter_(iter),
         sequence_(s),
+        has_upper_bound_(options.iterate_upper_bound != NULL),
+        prefix_extractor_(prefix_extractor),
+        prefix_state_(prefix_state),
+        prefix_mode_(false),
+        range_dels_(range_dels),
         direction_(kForward),
         valid_(false),
+        value_type_(kTypeValue),
+        resolved_(false),
         rnd_(seed),
         bytes_counter_(RandomPeriod()) {
+    if (has_upper_bound_) {
+      upper_bound_.assign(options.iterate_upper_bound->data(),
+                          options.iterate_upper_bound->size());
+    }
   }
   virtual ~DBIter() {
     delete iter_;
@@ -69,13 +85,29 @@ class DBIter: public Iterator {
   }
   virtual Slice value() const {
     assert(valid_);
-    return (direction_ == kForward) ? iter_->value() : saved_value_;
+    Slice raw = (direction_ == kForward) ? iter_->value() : saved_value_;
+    if (value_type_ != kTypeValueIndex) {
+      return raw;
+    }
+    if (!resolved_) {
+      // Separated value: fetched from the value log on first access
+      resolved_value_.assign(raw.data(), raw.size());
+      Status s = ReadValueLog(&resolved_value_);
+      if (!s.ok()) {
+        value_status_ = s;
+        resolved_value_.clear();
+      }
+      resolved_ = true;
+    }
+    return resolved_value_;
   }
   virtual Status status() const {
-    if (status_.ok()) {
-      return iter_->status();
-    } else {
+    if (!status_.ok()) {
       return status_;
+    } else if (!value_status_.ok()) {
+      return value_status_;
+    } else {
+      return iter_->status();
     }
   }
 
@@ -89,6 +121,26 @@ class DBIter: public Iterator {
   void FindNextUserEntry(bool skipping, std::string* skip);
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
+  void SetPrefixMode(const Slice* target);
+
+  // True if forward iteration must stop at user_key
+  inline bool PastEnd(const Slice& user_key) const {
+    return (has_upper_bound_ &&
+            user_comparator_->Compare(user_key, upper_bound_) >= 0) ||
+           (prefix_mode_ && !user_key.starts_with(prefix_));
+  }
+
+  // True if a range deletion visible at sequence_ hides the entry
+  inline bool RangeDeleted(const ParsedInternalKey& ikey) const {
+    return range_dels_ != NULL &&
+           ikey.sequence < range_dels_->MaxCoveringSeq(ikey.user_key,
+                                                       sequence_);
+  }
+
+  inline void SetValueType(ValueType type) {
+    value_type_ = type;
+    resolved_ = false;
+  }
 
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
@@ -113,11 +165,23 @@ class DBIter: public Iterator {
   Iterator* const iter_;
   SequenceNumber const sequence_;
 
+  const bool has_upper_bound_;
+  std::string upper_bound_;
+  const SliceTransform* const prefix_extractor_;  // NULL: no prefix mode
+  PrefixSeekState* const prefix_state_;           // May be NULL
+  bool prefix_mode_;    // Positioned by a Seek() in the domain of the extractor
+  std::string prefix_;  // Prefix of that Seek() target
+  const RangeDelMap* const range_dels_;           // May be NULL
+
   Status status_;
   std::string saved_key_;     // == current key when direction_==kReverse
   std::string saved_value_;   // == current raw value when direction_==kReverse
   Direction direction_;
   bool valid_;
+  ValueType value_type_;      // Type of the current entry
+  mutable bool resolved_;     // resolved_value_ holds the current separated value
+  mutable std::string resolved_value_;
+  mutable Status value_status_;   // First value log read error
 
   Random rnd_;
   ssize_t bytes_counter_;
@@ -143,6 +207,18 @@ inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
   }
 }
 
+void DBIter::SetPrefixMode(const Slice* target) {
+  prefix_mode_ = target != NULL && prefix_extractor_ != NULL &&
+                 prefix_extractor_->InDomain(*target);
+  if (prefix_mode_) {
+    Slice prefix = prefix_extractor_->Transform(*target);
+    prefix_.assign(prefix.data(), prefix.size());
+  }
+  if (prefix_state_ != NULL) {
+    prefix_state_->enabled = prefix_mode_;
+  }
+}
+
 void DBIter::Next() {
   assert(valid_);
 
@@ -176,7 +252,11 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   assert(direction_ == kForward);
   do {
     ParsedInternalKey ikey;
-    if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+    const bool parsed = ParseKey(&ikey);
+    if (parsed && PastEnd(ikey.user_key)) {
+      break;
+    }
+    if (parsed && ikey.sequence <= sequence_) {
       switch (ikey.type) {
         case kTypeDeletion:
           // Arrange to skip all upcoming entries for this key since
@@ -185,15 +265,24 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
           skipping = true;
           break;
         case kTypeValue:
+        case kTypeValueIndex:
           if (skipping &&
               user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
             // Entry hidden
+          } else if (RangeDeleted(ikey)) {
+            // Hidden, with every older entry of the key
+            SaveKey(ikey.user_key, skip);
+            skipping = true;
           } else {
             valid_ = true;
+            SetValueType(ikey.type);
             saved_key_.clear();
             return;
           }
           break;
+        case kTypeRangeDeletion:
+          // Range deletions are kept apart from the point entries
+          break;
       }
     }
     iter_->Next();
@@ -209,6 +298,11 @@ void DBIter::Prev() {
     // iter_ is pointing at the current entry.  Scan backwards until
     // the key changes so we can use the normal reverse scanning code.
     assert(iter_->Valid());  // Otherwise valid_ would have been false
+    if (prefix_state_ != NULL) {
+      // Switching directions re-seeks the table iterators, which must
+      // then land on their exact neighbours rather than skip a table.
+      prefix_state_->enabled = false;
+    }
     SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
     while (true) {
       iter_->Prev();
@@ -236,13 +330,19 @@ void DBIter::FindPrevUserEntry() {
   if (iter_->Valid()) {
     do {
       ParsedInternalKey ikey;
-      if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+      const bool parsed = ParseKey(&ikey);
+      if (parsed && prefix_mode_ && !ikey.user_key.starts_with(prefix_)) {
+        // The entries before the prefix are out of range
+        break;
+      }
+      if (parsed && ikey.sequence <= sequence_ &&
+          ikey.type != kTypeRangeDeletion) {
         if ((value_type != kTypeDeletion) &&
             user_comparator_->Compare(ikey.user_key, saved_key_) < 0) {
           // We encountered a non-deleted value in entries for previous keys,
           break;
         }
-        value_type = ikey.type;
+        value_type = RangeDeleted(ikey) ? kTypeDeletion : ikey.type;
         if (value_type == kTypeDeletion) {
           saved_key_.clear();
           ClearSavedValue();
@@ -268,13 +368,16 @@ void DBIter::FindPrevUserEntry() {
     direction_ = kForward;
   } else {
     valid_ = true;
+    SetValueType(value_type);
   }
 }
 
 void DBIter::Seek(const Slice& target) {
+  perf::BeginOperation();
   direction_ = kForward;
   ClearSavedValue();
   saved_key_.clear();
+  SetPrefixMode(&target);
   AppendInternalKey(
       &saved_key_, ParsedInternalKey(target, sequence_, kValueTypeForSeek));
   iter_->Seek(saved_key_);
@@ -286,8 +389,10 @@ void DBIter::Seek(const Slice& target) {
 }
 
 void DBIter::SeekToFirst() {
+  perf::BeginOperation();
   direction_ = kForward;
   ClearSavedValue();
+  SetPrefixMode(NULL);
   iter_->SeekToFirst();
   if (iter_->Valid()) {
     FindNextUserEntry(false, &saved_key_ /* temporary storage */);
@@ -297,9 +402,22 @@ void DBIter::SeekToFirst() {
 }
 
 void DBIter::SeekToLast() {
+  perf::BeginOperation();
   direction_ = kReverse;
   ClearSavedValue();
-  iter_->SeekToLast();
+  SetPrefixMode(NULL);
+  if (has_upper_bound_) {
+    // Start from the last entry before the bound
+    InternalKey bound(upper_bound_, kMaxSequenceNumber, kValueTypeForSeek);
+    iter_->Seek(bound.Encode());
+    if (iter_->Valid()) {
+      iter_->Prev();
+    } else {
+      iter_->SeekToLast();
+    }
+  } else {
+    iter_->SeekToLast();
+  }
   FindPrevUserEntry();
 }
 
@@ -310,8 +428,13 @@ Iterator* NewDBIterator(
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
     SequenceNumber sequence,
-    uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+    uint32_t seed,
+    const ReadOptions& options,
+    const SliceTransform* prefix_extractor,
+    PrefixSeekState* prefix_state,
+    const RangeDelMap* range_dels) {
+  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed,
+                    options, prefix_extractor, prefix_state, range_dels);
 }
 
 }  // namespace leveldb
@@ -12,16 +12,25 @@
 namespace leveldb {
 
 class DBImpl;
+class RangeDelMap;
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  The iterator honours
+// options.iterate_upper_bound and, if "prefix_extractor" is non-NULL,
+// stays within the prefix of the last Seek() target, enabling
+// "*prefix_state" (if non-NULL) while it does.  Entries hidden by one of
+// "*range_dels" (if non-NULL) at "sequence" are skipped.
 extern Iterator* NewDBIterator(
     DBImpl* db,
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
     SequenceNumber sequence,
-    uint32_t seed);
+    uint32_t seed,
+    const ReadOptions& options,
+    const SliceTransform* prefix_extractor,
+    PrefixSeekState* prefix_state,
+    const RangeDelMap* range_dels = NULL);
 
 }  // namespace leveldb
 
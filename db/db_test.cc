@@ -1888,6 +1888,10 @@ class ModelDB: public DB {
   virtual Status Delete(const WriteOptions& o, const Slice& key) {
     return DB::Delete(o, key);
   }
+  virtual Status DeleteRange(const WriteOptions& o,
+                             const Slice& begin, const Slice& end) {
+    return DB::DeleteRange(o, begin, end);
+  }
   virtual Status Get(const ReadOptions& options,
                      const Slice& key, std::string* value) {
     assert(false);      // Not implemented
@@ -1923,6 +1927,10 @@ class ModelDB: public DB {
       virtual void Delete(const Slice& key) {
         map_->erase(key.ToString());
       }
+      virtual void DeleteRange(const Slice& begin, const Slice& end) {
+        map_->erase(map_->lower_bound(begin.ToString()),
+                    map_->lower_bound(end.ToString()));
+      }
     };
     Handler handler;
     handler.map_ = &map_;
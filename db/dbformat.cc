@@ -3,6 +3,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include <stdio.h>
+#include <vector>
 #include "db/dbformat.h"
 #include "port/port.h"
 #include "util/coding.h"
@@ -47,24 +48,6 @@ const char* InternalKeyComparator::Name() const {
   return "leveldb.InternalKeyComparator";
 }
 
-int InternalKeyComparator::Compare(const Slice& akey, const Slice& bkey) const {
-  // Order by:
-  //    increasing user key (according to user-supplied comparator)
-  //    decreasing sequence number
-  //    decreasing type (though sequence# should be enough to disambiguate)
-  int r = user_comparator_->Compare(ExtractUserKey(akey), ExtractUserKey(bkey));
-  if (r == 0) {
-    const uint64_t anum = DecodeFixed64(akey.data() + akey.size() - 8);
-    const uint64_t bnum = DecodeFixed64(bkey.data() + bkey.size() - 8);
-    if (anum > bnum) {
-      r = -1;
-    } else if (anum < bnum) {
-      r = +1;
-    }
-  }
-  return r;
-}
-
 void InternalKeyComparator::FindShortestSeparator(
       std::string* start,
       const Slice& limit) const {
@@ -111,7 +94,29 @@ void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
     mkey[i] = ExtractUserKey(keys[i]);
     // TODO(sanjay): Suppress dups?
   }
-  user_policy_->CreateFilter(keys, n, dst);
+  if (prefix_extractor_ == NULL) {
+    user_policy_->CreateFilter(keys, n, dst);
+    return;
+  }
+
+  // The keys are sorted, so the keys sharing a prefix are adjacent and
+  // each prefix is added once.
+  std::vector<Slice> all(keys, keys + n);
+  Slice last_prefix;
+  bool have_prefix = false;
+  for (int i = 0; i < n; i++) {
+    if (!prefix_extractor_->InDomain(keys[i])) {
+      continue;
+    }
+    Slice prefix = prefix_extractor_->Transform(keys[i]);
+    if (!have_prefix || prefix != last_prefix) {
+      all.push_back(prefix);
+      last_prefix = prefix;
+      have_prefix = true;
+    }
+  }
+  user_policy_->CreateFilter(all.empty() ? keys : &all[0],
+                             static_cast<int>(all.size()), dst);
 }
 
 bool InternalFilterPolicy::KeyMayMatch(const Slice& key, const Slice& f) const {
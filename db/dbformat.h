@@ -10,7 +10,9 @@
 #include "leveldb/db.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/slice.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table_builder.h"
+#include "util/bytewise_compare.h"
 #include "util/coding.h"
 #include "util/logging.h"
 
@@ -50,7 +52,9 @@ class InternalKey;
 // data structures.
 enum ValueType {
   kTypeDeletion = 0x0,
-  kTypeValue = 0x1
+  kTypeValue = 0x1,
+  kTypeValueIndex = 0x2,  // value is a ValuePointer into the value log
+  kTypeRangeDeletion = 0x3  // key is the range begin, value the range end
 };
 // kValueTypeForSeek defines the ValueType that should be passed when
 // constructing a ParsedInternalKey object for seeking to a particular
@@ -58,7 +62,7 @@ enum ValueType {
 // and the value type is embedded as the low 8 bits in the sequence
 // number in internal keys, we need to use the highest-numbered
 // ValueType, not the lowest).
-static const ValueType kValueTypeForSeek = kTypeValue;
+static const ValueType kValueTypeForSeek = kTypeRangeDeletion;
 
 typedef uint64_t SequenceNumber;
 
@@ -113,10 +117,20 @@ inline ValueType ExtractValueType(const Slice& internal_key) {
 class InternalKeyComparator : public Comparator {
  private:
   const Comparator* user_comparator_;
+  bool bytewise_;  // user_comparator_ is BytewiseComparator()
  public:
-  explicit InternalKeyComparator(const Comparator* c) : user_comparator_(c) { }
+  explicit InternalKeyComparator(const Comparator* c)
+      : user_comparator_(c),
+        bytewise_(c == BytewiseComparator()) { }
   virtual const char* Name() const;
+
+  // Defined inline below, so that callers holding the comparator by value,
+  // like the memtable skiplist, compare bytewise keys without any
+  // virtual call.
   virtual int Compare(const Slice& a, const Slice& b) const;
+  int CompareUserKey(const Slice& a, const Slice& b) const {
+    return bytewise_ ? BytewiseCompare(a, b) : user_comparator_->Compare(a, b);
+  }
   virtual void FindShortestSeparator(
       std::string* start,
       const Slice& limit) const;
@@ -131,13 +145,27 @@ class InternalKeyComparator : public Comparator {
 class InternalFilterPolicy : public FilterPolicy {
  private:
   const FilterPolicy* const user_policy_;
+  const SliceTransform* const prefix_extractor_;
  public:
-  explicit InternalFilterPolicy(const FilterPolicy* p) : user_policy_(p) { }
+  // If "prefix_extractor" is non-NULL, the filters also hold the prefix of
+  // every key in its domain.
+  explicit InternalFilterPolicy(const FilterPolicy* p,
+                                const SliceTransform* prefix_extractor = NULL)
+      : user_policy_(p), prefix_extractor_(prefix_extractor) { }
   virtual const char* Name() const;
   virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const;
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const;
 };
 
+// Shared by a DBIter and the table iterators below it.  While enabled,
+// a Seek() on a table or level iterator first asks the prefix filter
+// whether any key with the prefix of the target can follow it, and
+// leaves the iterator invalid without reading a data block if not.
+struct PrefixSeekState {
+  const SliceTransform* prefix_extractor;
+  bool enabled;
+};
+
 // Modules in this directory should keep internal keys wrapped inside
 // the following class instead of plain strings so that we do not
 // incorrectly use string comparisons instead of an InternalKeyComparator.
@@ -168,6 +196,25 @@ class InternalKey {
   std::string DebugString() const;
 };
 
+inline int InternalKeyComparator::Compare(const Slice& akey,
+                                         const Slice& bkey) const {
+  // Order by:
+  //    increasing user key (according to user-supplied comparator)
+  //    decreasing sequence number
+  //    decreasing type (though sequence# should be enough to disambiguate)
+  int r = CompareUserKey(ExtractUserKey(akey), ExtractUserKey(bkey));
+  if (r == 0) {
+    const uint64_t anum = DecodeFixed64(akey.data() + akey.size() - 8);
+    const uint64_t bnum = DecodeFixed64(bkey.data() + bkey.size() - 8);
+    if (anum > bnum) {
+      r = -1;
+    } else if (anum < bnum) {
+      r = +1;
+    }
+  }
+  return r;
+}
+
 inline int InternalKeyComparator::Compare(
     const InternalKey& a, const InternalKey& b) const {
   return Compare(a.Encode(), b.Encode());
@@ -182,7 +229,7 @@ inline bool ParseInternalKey(const Slice& internal_key,
   result->sequence = num >> 8;
   result->type = static_cast<ValueType>(c);
   result->user_key = Slice(internal_key.data(), n - 8);
-  return (c <= static_cast<unsigned char>(kTypeValue));
+  return (c <= static_cast<unsigned char>(kTypeRangeDeletion));
 }
 
 // A helper class useful for DBImpl::Get()
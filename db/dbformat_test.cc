@@ -3,7 +3,12 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "db/dbformat.h"
+#include "db/value_log.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice_transform.h"
+#include "util/bytewise_compare.h"
 #include "util/logging.h"
+#include "util/random.h"
 #include "util/testharness.h"
 
 namespace leveldb {
@@ -58,10 +63,29 @@ TEST(FormatTest, InternalKey_EncodeDecode) {
     for (int s = 0; s < sizeof(seq) / sizeof(seq[0]); s++) {
       TestKey(keys[k], seq[s], kTypeValue);
       TestKey("hello", 1, kTypeDeletion);
+      TestKey("hello", 1, kTypeValueIndex);
     }
   }
 }
 
+TEST(FormatTest, ValuePointerEncodeDecode) {
+  ValuePointer ptr;
+  ptr.zone = 4097;
+  ptr.offset = 255ull << 20;
+  ptr.size = 65536;
+  std::string encoded;
+  ptr.EncodeTo(&encoded);
+
+  ValuePointer decoded;
+  ASSERT_TRUE(decoded.DecodeFrom(encoded));
+  ASSERT_EQ(ptr.zone, decoded.zone);
+  ASSERT_EQ(ptr.offset, decoded.offset);
+  ASSERT_EQ(ptr.size, decoded.size);
+
+  ASSERT_TRUE(!decoded.DecodeFrom(Slice(encoded.data(), encoded.size() - 1)));
+  ASSERT_TRUE(!decoded.DecodeFrom(encoded + "x"));
+}
+
 TEST(FormatTest, InternalKeyShortSeparator) {
   // When user keys are same
   ASSERT_EQ(IKey("foo", 100, kTypeValue),
@@ -105,6 +129,73 @@ TEST(FormatTest, InternalKeyShortestSuccessor) {
             ShortSuccessor(IKey("\xff\xff", 100, kTypeValue)));
 }
 
+TEST(FormatTest, BytewiseCompare) {
+  Random rnd(301);
+  for (int i = 0; i < 10000; i++) {
+    // Short alphabets and shared prefixes so that the strings differ
+    // anywhere in or past the first words, or not at all
+    std::string a(rnd.Uniform(80), 'k');
+    std::string b = a.substr(0, rnd.Uniform(a.size() + 1));
+    for (size_t j = 0; j < a.size(); j++) {
+      if (rnd.OneIn(16)) a[j] = static_cast<char>(rnd.Uniform(3) + 0x7f);
+    }
+    b.append(rnd.Uniform(4), static_cast<char>(rnd.Uniform(3) + 0x7f));
+    const int expected = Slice(a).compare(b);
+    const int r = BytewiseCompare(a, b);
+    ASSERT_EQ(expected < 0, r < 0) << EscapeString(a) << " " << EscapeString(b);
+    ASSERT_EQ(expected > 0, r > 0) << EscapeString(a) << " " << EscapeString(b);
+  }
+
+  InternalKeyComparator icmp(BytewiseComparator());
+  ASSERT_LT(icmp.Compare(IKey("\x80", 1, kTypeValue),
+                         IKey("\x80\x01", 2, kTypeValue)), 0);
+  ASSERT_GT(icmp.Compare(IKey("abcdefgh\xff", 1, kTypeValue),
+                         IKey("abcdefgh\x01", 1, kTypeValue)), 0);
+}
+
+TEST(FormatTest, SliceTransforms) {
+  const SliceTransform* fixed = NewFixedPrefixTransform(3);
+  ASSERT_TRUE(fixed->InDomain("abc"));
+  ASSERT_TRUE(!fixed->InDomain("ab"));
+  ASSERT_EQ("abc", fixed->Transform("abcdef").ToString());
+
+  const SliceTransform* delimited = NewDelimitedPrefixTransform('|', 2);
+  ASSERT_TRUE(delimited->InDomain("a|b|"));
+  ASSERT_TRUE(!delimited->InDomain("a|b"));
+  ASSERT_EQ("a|bc|", delimited->Transform("a|bc|d|e").ToString());
+  ASSERT_TRUE(std::string(fixed->Name()) != delimited->Name());
+  delete fixed;
+  delete delimited;
+}
+
+TEST(FormatTest, InternalFilterPolicyPrefixes) {
+  const FilterPolicy* bloom = NewBloomFilterPolicy(10);
+  const SliceTransform* prefix = NewFixedPrefixTransform(4);
+  InternalFilterPolicy policy(bloom, prefix);
+
+  std::string keys[] = {
+    IKey("user1-a", 100, kTypeValue),
+    IKey("user1-b", 99, kTypeValue),
+    IKey("user7-a", 98, kTypeValue),
+    IKey("abc", 97, kTypeValue),  // Outside the domain
+  };
+  Slice slices[4];
+  for (int i = 0; i < 4; i++) {
+    slices[i] = keys[i];
+  }
+  std::string filter;
+  policy.CreateFilter(slices, 4, &filter);
+
+  ASSERT_TRUE(policy.KeyMayMatch(IKey("user1-a", 5, kTypeValue), filter));
+  ASSERT_TRUE(policy.KeyMayMatch(IKey("abc", 5, kTypeValue), filter));
+  ASSERT_TRUE(policy.KeyMayMatch(
+      IKey("user", kMaxSequenceNumber, kValueTypeForSeek), filter));
+  ASSERT_TRUE(!policy.KeyMayMatch(
+      IKey("zzzz", kMaxSequenceNumber, kValueTypeForSeek), filter));
+  delete prefix;
+  delete bloom;
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
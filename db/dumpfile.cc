@@ -185,6 +185,8 @@ Status DumpTable(Env* env, const std::string& fname, WritableFile* dst) {
         r += "del";
       } else if (key.type == kTypeValue) {
         r += "val";
+      } else if (key.type == kTypeValueIndex) {
+        r += "vptr";
       } else {
         AppendNumberTo(&r, key.type);
       }
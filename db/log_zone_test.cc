@@ -0,0 +1,206 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// The WAL and MANIFEST of the open DB live in the drive's conventional
+// zones.  These tests check that they can be found again after a reopen,
+// a recovery and a repair.
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include "db/db_impl.h"
+#include "db/filename.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "util/logging.h"
+#include "util/testharness.h"
+
+#include "../hm/get_manager.h"
+
+namespace leveldb {
+
+class LogZoneTest {
+ public:
+  std::string dbname_;
+  Env* env_;
+  HMManager* hm_manager_;
+  DB* db_;
+
+  LogZoneTest()
+      : env_(Env::Default()),
+        hm_manager_(Singleton::Gethmmanager()),
+        db_(NULL) {
+    dbname_ = test::TmpDir() + "/log_zone_test";
+    DestroyDB(dbname_, Options());
+    Open();
+  }
+
+  ~LogZoneTest() {
+    std::vector<uint64_t> tables = LiveTables();
+    Close();
+    for (size_t i = 0; i < tables.size(); i++) {
+      env_->DeleteFile(TableFileName(dbname_, tables[i]));
+    }
+    DestroyDB(dbname_, Options());
+  }
+
+  bool Enabled() {
+    if (!hm_manager_->log_zone_enabled()) {
+      fprintf(stderr, "skipping: the drive has no conventional zones\n");
+      return false;
+    }
+    return true;
+  }
+
+  void Open() {
+    Options options;
+    options.create_if_missing = true;
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  void Close() {
+    delete db_;
+    db_ = NULL;
+  }
+
+  DBImpl* dbfull() {
+    return reinterpret_cast<DBImpl*>(db_);
+  }
+
+  // Tables live in the zone manager rather than the directory, so
+  // DestroyDB() does not see them; list them so that they can be dropped.
+  std::vector<uint64_t> LiveTables() {
+    std::vector<uint64_t> tables;
+    if (db_ == NULL) {
+      return tables;
+    }
+    std::string sstables;
+    ASSERT_TRUE(db_->GetProperty("leveldb.sstables", &sstables));
+    Slice in(sstables);
+    while (!in.empty()) {
+      uint64_t number;
+      if (in[0] == ' ') {
+        in.remove_prefix(1);
+        ASSERT_TRUE(ConsumeDecimalNumber(&in, &number));
+        tables.push_back(number);
+      }
+      const char* eol = strchr(in.data(), '\n');
+      in.remove_prefix(eol == NULL ? in.size() : eol - in.data() + 1);
+    }
+    return tables;
+  }
+
+  std::string Get(const std::string& k) {
+    std::string result;
+    Status s = db_->Get(ReadOptions(), k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  // True if fname is in the conventional zones and not on the file system
+  bool InLogZones(const std::string& fname) {
+    struct stat sbuf;
+    return hm_manager_->log_exists(fname) && stat(fname.c_str(), &sbuf) != 0;
+  }
+
+  std::string CurrentManifest() {
+    std::string current;
+    ASSERT_OK(ReadFileToString(env_, CurrentFileName(dbname_), &current));
+    ASSERT_TRUE(!current.empty() && current[current.size() - 1] == '\n');
+    return dbname_ + "/" + current.substr(0, current.size() - 1);
+  }
+};
+
+TEST(LogZoneTest, FilesGoToLogZones) {
+  if (!Enabled()) return;
+  ASSERT_OK(db_->Put(WriteOptions(), "foo", "v1"));
+  ASSERT_TRUE(InLogZones(CurrentManifest()));
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(dbname_, &children));
+  int logs = 0;
+  for (size_t i = 0; i < children.size(); i++) {
+    uint64_t number;
+    FileType type;
+    if (ParseFileName(children[i], &number, &type) && type == kLogFile) {
+      ASSERT_TRUE(InLogZones(dbname_ + "/" + children[i]));
+      logs++;
+    }
+  }
+  ASSERT_EQ(1, logs);
+
+  // Another directory keeps its files on the file system
+  ASSERT_TRUE(!hm_manager_->is_log_dbname(dbname_ + "/lost"));
+}
+
+TEST(LogZoneTest, Reopen) {
+  if (!Enabled()) return;
+  ASSERT_OK(db_->Put(WriteOptions(), "foo", "v1"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_OK(db_->Put(WriteOptions(), "bar", "v2"));
+  Close();
+  ASSERT_TRUE(!hm_manager_->is_log_dbname(dbname_));
+
+  // "foo" comes back from a table, "bar" from the WAL
+  Open();
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v2", Get("bar"));
+  ASSERT_OK(db_->Put(WriteOptions(), "baz", "v3"));
+  Close();
+  Open();
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v2", Get("bar"));
+  ASSERT_EQ("v3", Get("baz"));
+}
+
+TEST(LogZoneTest, Repair) {
+  if (!Enabled()) return;
+  ASSERT_OK(db_->Put(WriteOptions(), "foo", "v1"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_OK(db_->Put(WriteOptions(), "bar", "v2"));
+  ASSERT_OK(db_->Delete(WriteOptions(), "foo"));
+  Close();
+
+  ASSERT_OK(RepairDB(dbname_, Options()));
+  ASSERT_TRUE(!hm_manager_->is_log_dbname(dbname_));
+  ASSERT_EQ(dbname_ + "/MANIFEST-000001", CurrentManifest());
+  ASSERT_TRUE(InLogZones(CurrentManifest()));
+
+  Open();
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  ASSERT_EQ("v2", Get("bar"));
+}
+
+TEST(LogZoneTest, RenameAcrossBackends) {
+  if (!Enabled()) return;
+  const std::string tmp = TempFileName(dbname_, 100);
+  const std::string manifest = DescriptorFileName(dbname_, 100);
+  const std::string lost = dbname_ + "/lost";
+  ASSERT_OK(WriteStringToFile(env_, "contents", tmp));
+
+  // File system to conventional zones
+  ASSERT_OK(env_->RenameFile(tmp, manifest));
+  ASSERT_TRUE(!env_->FileExists(tmp));
+  ASSERT_TRUE(InLogZones(manifest));
+  std::string data;
+  ASSERT_OK(ReadFileToString(env_, manifest, &data));
+  ASSERT_EQ("contents", data);
+
+  // And back out again
+  env_->CreateDir(lost);
+  ASSERT_OK(env_->RenameFile(manifest, lost + "/MANIFEST-000100"));
+  ASSERT_TRUE(!hm_manager_->log_exists(manifest));
+  ASSERT_OK(ReadFileToString(env_, lost + "/MANIFEST-000100", &data));
+  ASSERT_EQ("contents", data);
+  env_->DeleteFile(lost + "/MANIFEST-000100");
+  env_->DeleteDir(lost);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
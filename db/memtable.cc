@@ -21,7 +21,8 @@ static Slice GetLengthPrefixedSlice(const char* data) {
 MemTable::MemTable(const InternalKeyComparator& cmp)
     : comparator_(cmp),
       refs_(0),
-      table_(comparator_, &arena_) {
+      table_(comparator_, &arena_),
+      range_del_table_(comparator_, &arena_) {
 }
 
 MemTable::~MemTable() {
@@ -79,6 +80,10 @@ Iterator* MemTable::NewIterator() {
   return new MemTableIterator(&table_);
 }
 
+Iterator* MemTable::NewRangeDelIterator() {
+  return new MemTableIterator(&range_del_table_);
+}
+
 void MemTable::Add(SequenceNumber s, ValueType type,
                    const Slice& key,
                    const Slice& value) {
@@ -102,11 +107,38 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   p = EncodeVarint32(p, val_size);
   memcpy(p, value.data(), val_size);
   assert((p + val_size) - buf == encoded_len);
-  table_.Insert(buf);
+  if (type == kTypeRangeDeletion) {
+    range_del_table_.Insert(buf);
+  } else {
+    table_.Insert(buf);
+  }
+}
+
+SequenceNumber MemTable::MaxCoveringRangeDel(const Slice& user_key,
+                                             SequenceNumber snapshot) {
+  SequenceNumber result = 0;
+  Table::Iterator iter(&range_del_table_);
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+    Slice ikey = GetLengthPrefixedSlice(iter.key());
+    if (comparator_.comparator.CompareUserKey(ExtractUserKey(ikey),
+                                              user_key) > 0) {
+      break;  // Sorted by range begin: the rest start after user_key
+    }
+    const SequenceNumber seq = DecodeFixed64(ikey.data() + ikey.size() - 8) >> 8;
+    if (seq <= snapshot && seq > result &&
+        comparator_.comparator.CompareUserKey(
+            user_key, GetLengthPrefixedSlice(ikey.data() + ikey.size())) < 0) {
+      result = seq;
+    }
+  }
+  return result;
 }
 
 bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
   Slice memkey = key.memtable_key();
+  Slice lookup = key.internal_key();
+  const SequenceNumber covering = MaxCoveringRangeDel(
+      key.user_key(), DecodeFixed64(lookup.data() + lookup.size() - 8) >> 8);
   Table::Iterator iter(&table_);
   iter.Seek(memkey.data());
   if (iter.Valid()) {
@@ -122,11 +154,15 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
     const char* entry = iter.key();
     uint32_t key_length;
     const char* key_ptr = GetVarint32Ptr(entry, entry+5, &key_length);
-    if (comparator_.comparator.user_comparator()->Compare(
+    if (comparator_.comparator.CompareUserKey(
             Slice(key_ptr, key_length - 8),
             key.user_key()) == 0) {
       // Correct user key
       const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+      if ((tag >> 8) < covering) {
+        *s = Status::NotFound(Slice());
+        return true;
+      }
       switch (static_cast<ValueType>(tag & 0xff)) {
         case kTypeValue: {
           Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
@@ -136,9 +172,24 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
         case kTypeDeletion:
           *s = Status::NotFound(Slice());
           return true;
+        case kTypeValueIndex:
+          // Values are only separated when the memtable is dumped
+          assert(false);
+          *s = Status::Corruption("value pointer in memtable");
+          return true;
+        case kTypeRangeDeletion:
+          // Add() keeps range deletions in range_del_table_
+          assert(false);
+          *s = Status::Corruption("range deletion in the point table");
+          return true;
       }
     }
   }
+  if (covering > 0) {
+    // Every older entry, here or in the older memtables and tables
+    *s = Status::NotFound(Slice());
+    return true;
+  }
   return false;
 }
 
@@ -47,16 +47,22 @@ class MemTable {
   // db/format.{h,cc} module.
   Iterator* NewIterator();
 
+  // Return an iterator over the range deletions of the memtable, keyed by
+  // the internal key of the range begin with the range end as value.
+  // The same liveness requirement as NewIterator() applies.
+  Iterator* NewRangeDelIterator();
+
   // Add an entry into memtable that maps key to value at the
   // specified sequence number and with the specified type.
-  // Typically value will be empty if type==kTypeDeletion.
+  // Typically value will be empty if type==kTypeDeletion.  For
+  // kTypeRangeDeletion, key and value are the range [key, value).
   void Add(SequenceNumber seq, ValueType type,
            const Slice& key,
            const Slice& value);
 
   // If memtable contains a value for key, store it in *value and return true.
-  // If memtable contains a deletion for key, store a NotFound() error
-  // in *status and return true.
+  // If memtable contains a deletion for key, or a range deletion newer
+  // than its value, store a NotFound() error in *status and return true.
   // Else, return false.
   bool Get(const LookupKey& key, std::string* value, Status* s);
 
@@ -73,10 +79,16 @@ class MemTable {
 
   typedef SkipList<const char*, KeyComparator> Table;
 
+  // Largest sequence number not above "snapshot" of the range deletions
+  // covering user_key, 0 if none
+  SequenceNumber MaxCoveringRangeDel(const Slice& user_key,
+                                     SequenceNumber snapshot);
+
   KeyComparator comparator_;
   int refs_;
   Arena arena_;
   Table table_;
+  Table range_del_table_;   // Kept apart so that point lookups skip them
 
   // No copying allowed
   MemTable(const MemTable&);
@@ -0,0 +1,306 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// MultiGet resolves a batch of keys in one pass over the memtables and
+// the current version.  These tests check that it agrees with a Get of
+// each key wherever the key lives.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "db/db_impl.h"
+#include "db/filename.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/logging.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+static std::string Key(const char* prefix, int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "%s%03d", prefix, i);
+  return std::string(buf);
+}
+
+// Keeps the Env's background thread busy until Release() is called, so
+// that a full memtable stays immutable.
+class BackgroundBlocker {
+ public:
+  BackgroundBlocker() : cv_(&mu_), released_(false) { }
+
+  void Block(Env* env) {
+    env->Schedule(&BackgroundBlocker::Run, this);
+  }
+
+  void Release() {
+    MutexLock l(&mu_);
+    released_ = true;
+    cv_.SignalAll();
+  }
+
+ private:
+  static void Run(void* arg) {
+    BackgroundBlocker* blocker = reinterpret_cast<BackgroundBlocker*>(arg);
+    MutexLock l(&blocker->mu_);
+    while (!blocker->released_) {
+      blocker->cv_.Wait();
+    }
+  }
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  bool released_;
+};
+
+class MultiGetTest {
+ public:
+  std::string dbname_;
+  Env* env_;
+  DB* db_;
+
+  MultiGetTest() : env_(Env::Default()), db_(NULL) {
+    dbname_ = test::TmpDir() + "/multi_get_test";
+    DestroyDB(dbname_, Options());
+    Options options;
+    options.create_if_missing = true;
+    options.write_buffer_size = 64 << 10;  // The smallest allowed
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  ~MultiGetTest() {
+    // Tables live in the zone manager rather than the directory, so
+    // DestroyDB() does not see them; drop them by number so that the
+    // next test can reuse the file numbers.
+    std::vector<uint64_t> tables;
+    std::string sstables;
+    ASSERT_TRUE(db_->GetProperty("leveldb.sstables", &sstables));
+    Slice in(sstables);
+    while (!in.empty()) {
+      uint64_t number;
+      if (in[0] == ' ') {
+        in.remove_prefix(1);
+        ASSERT_TRUE(ConsumeDecimalNumber(&in, &number));
+        tables.push_back(number);
+      }
+      const char* eol = strchr(in.data(), '\n');
+      in.remove_prefix(eol == NULL ? in.size() : eol - in.data() + 1);
+    }
+    delete db_;
+    for (size_t i = 0; i < tables.size(); i++) {
+      env_->DeleteFile(TableFileName(dbname_, tables[i]));
+    }
+    DestroyDB(dbname_, Options());
+  }
+
+  DBImpl* dbfull() {
+    return reinterpret_cast<DBImpl*>(db_);
+  }
+
+  Status Put(const std::string& k, const std::string& v) {
+    return db_->Put(WriteOptions(), k, v);
+  }
+
+  int NumTableFilesAtLevel(int level) {
+    std::string property;
+    ASSERT_TRUE(db_->GetProperty(
+        "leveldb.num-files-at-level" + NumberToString(level), &property));
+    return atoi(property.c_str());
+  }
+
+  // Push every table down through all the levels, rewriting it
+  void CompactAll() {
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      dbfull()->TEST_CompactRange(level, NULL, NULL);
+    }
+  }
+
+  static std::string Result(const Status& s, const std::string& value) {
+    if (s.IsNotFound()) {
+      return "NOT_FOUND";
+    } else if (!s.ok()) {
+      return s.ToString();
+    }
+    return value;
+  }
+
+  // Look up "keys" with MultiGet and check each result against Get.
+  // Returns the results joined by spaces.
+  std::string Check(const std::vector<std::string>& keys,
+                    const Snapshot* snapshot = NULL) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::vector<Slice> slices(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Status> statuses = db_->MultiGet(options, slices, &values);
+    ASSERT_EQ(keys.size(), statuses.size());
+    ASSERT_EQ(keys.size(), values.size());
+    std::string result;
+    for (size_t i = 0; i < keys.size(); i++) {
+      std::string value;
+      Status s = db_->Get(options, keys[i], &value);
+      ASSERT_EQ(Result(s, value), Result(statuses[i], values[i]));
+      if (i > 0) {
+        result.push_back(' ');
+      }
+      result += Result(statuses[i], values[i]);
+    }
+    return result;
+  }
+};
+
+TEST(MultiGetTest, MemTables) {
+  ASSERT_OK(Put("table", "t1"));
+  ASSERT_OK(Put("table-overwritten", "t1"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+
+  // Fill the memtable past write_buffer_size once while the flush cannot
+  // run: the first values end up in the immutable memtable, the rest in
+  // the new memtable.  Filling the new one too would wait for the flush.
+  const int kNum = 70;
+  BackgroundBlocker blocker;
+  blocker.Block(env_);
+  const std::string big(1000, 'x');
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_OK(Put(Key("mem", i), big + Key("v", i)));
+  }
+  ASSERT_OK(Put("table-overwritten", "m1"));
+  ASSERT_OK(Put(Key("mem", 1), "m1"));
+  ASSERT_OK(db_->Delete(WriteOptions(), Key("mem", 2)));
+
+  std::vector<std::string> keys;
+  keys.push_back(Key("mem", 0));
+  keys.push_back(Key("mem", 1));
+  keys.push_back(Key("mem", 2));
+  keys.push_back(Key("mem", kNum - 1));
+  keys.push_back("table");
+  keys.push_back("table-overwritten");
+  keys.push_back("missing");
+  ASSERT_EQ(big + "v000 m1 NOT_FOUND " + big + "v069 t1 m1 NOT_FOUND",
+            Check(keys));
+  for (int i = 0; i < kNum; i++) {
+    keys.push_back(Key("mem", i));
+  }
+  Check(keys);
+  blocker.Release();
+
+  // The same answers once the memtables are flushed
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  keys.resize(7);
+  ASSERT_EQ(big + "v000 m1 NOT_FOUND " + big + "v069 t1 m1 NOT_FOUND",
+            Check(keys));
+}
+
+TEST(MultiGetTest, OverlappingL0Tables) {
+  // Table t holds the keys divisible by t + 1, so the newest value of key
+  // i comes from the largest such t.  Every table holds keys 0 and 60, so
+  // that each one overlaps the last and the later ones stay in level 0.
+  const int kTables = 5;
+  for (int t = 0; t < kTables; t++) {
+    for (int i = 0; i <= 60; i += t + 1) {
+      ASSERT_OK(Put(Key("key", i), Key("v", t)));
+    }
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  }
+  ASSERT_GE(NumTableFilesAtLevel(0), 2);
+
+  std::vector<std::string> keys;
+  std::string expected;
+  for (int i = 0; i <= 61; i++) {
+    keys.push_back(Key("key", i));
+    int newest = -1;
+    for (int t = 0; t < kTables && i <= 60; t++) {
+      if (i % (t + 1) == 0) newest = t;
+    }
+    if (i > 0) expected.push_back(' ');
+    expected += (newest < 0) ? "NOT_FOUND" : Key("v", newest);
+  }
+  ASSERT_EQ(expected, Check(keys));
+}
+
+TEST(MultiGetTest, DeeperLevelsAtSnapshot) {
+  for (int i = 0; i < 50; i++) {
+    ASSERT_OK(Put(Key("key", i), Key("old", i)));
+  }
+  CompactAll();
+  const Snapshot* snapshot = db_->GetSnapshot();
+  for (int i = 0; i < 50; i += 2) {
+    ASSERT_OK(Put(Key("key", i), Key("new", i)));
+  }
+  ASSERT_OK(Put(Key("key", 50), "added"));
+  CompactAll();
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+
+  std::vector<std::string> keys;
+  keys.push_back(Key("key", 0));
+  keys.push_back(Key("key", 1));
+  keys.push_back(Key("key", 50));
+  keys.push_back(Key("key", 49));
+  ASSERT_EQ("new000 old001 added old049", Check(keys));
+  ASSERT_EQ("old000 old001 NOT_FOUND old049", Check(keys, snapshot));
+  for (int i = 0; i < 50; i++) {
+    keys.push_back(Key("key", i));
+  }
+  Check(keys);
+  Check(keys, snapshot);
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST(MultiGetTest, Deleted) {
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(Put(Key("key", i), Key("v", i)));
+  }
+  CompactAll();
+  const Snapshot* snapshot = db_->GetSnapshot();
+
+  // Deleted in a level 0 table, in the memtable and by a range deletion
+  ASSERT_OK(db_->Delete(WriteOptions(), Key("key", 1)));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_OK(db_->Delete(WriteOptions(), Key("key", 2)));
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key("key", 5), Key("key", 7)));
+  ASSERT_OK(Put(Key("key", 3), "put"));
+  ASSERT_OK(db_->Delete(WriteOptions(), Key("key", 3)));
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < 8; i++) {
+    keys.push_back(Key("key", i));
+  }
+  ASSERT_EQ("v000 NOT_FOUND NOT_FOUND NOT_FOUND v004 NOT_FOUND NOT_FOUND "
+            "v007", Check(keys));
+  ASSERT_EQ("v000 v001 v002 v003 v004 v005 v006 v007",
+            Check(keys, snapshot));
+
+  // And after the deletions are flushed
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ("v000 NOT_FOUND NOT_FOUND NOT_FOUND v004 NOT_FOUND NOT_FOUND "
+            "v007", Check(keys));
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST(MultiGetTest, DuplicateKeys) {
+  ASSERT_OK(Put("a", "table"));
+  ASSERT_OK(Put("b", "table"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_OK(Put("b", "mem"));
+
+  std::vector<std::string> keys;
+  keys.push_back("a");
+  keys.push_back("b");
+  keys.push_back("a");
+  keys.push_back("missing");
+  keys.push_back("b");
+  keys.push_back("missing");
+  keys.push_back("a");
+  ASSERT_EQ("table mem table NOT_FOUND mem NOT_FOUND table", Check(keys));
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
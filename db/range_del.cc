@@ -0,0 +1,101 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/range_del.h"
+
+#include <algorithm>
+#include <functional>
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+
+namespace leveldb {
+
+struct RangeDelMap::BoundLess {
+  const Comparator* ucmp;
+  explicit BoundLess(const Comparator* c) : ucmp(c) { }
+  bool operator()(const std::string& a, const std::string& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+  bool operator()(const Slice& a, const std::string& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+};
+
+RangeDelMap::RangeDelMap(const Comparator* ucmp) : ucmp_(ucmp) { }
+
+void RangeDelMap::Add(const Slice& begin, const Slice& end,
+                      SequenceNumber seq) {
+  if (ucmp_->Compare(begin, end) >= 0) {
+    return;
+  }
+  Tombstone t;
+  t.begin = begin.ToString();
+  t.end = end.ToString();
+  t.seq = seq;
+  tombstones_.push_back(t);
+}
+
+void RangeDelMap::AddFrom(Iterator* iter) {
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (ParseInternalKey(iter->key(), &ikey)) {
+      Add(ikey.user_key, iter->value(), ikey.sequence);
+    }
+  }
+}
+
+void RangeDelMap::Finish() {
+  BoundLess less(ucmp_);
+  std::vector<std::string> all;
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    all.push_back(tombstones_[i].begin);
+    all.push_back(tombstones_[i].end);
+  }
+  std::sort(all.begin(), all.end(), less);
+  bounds_.clear();
+  for (size_t i = 0; i < all.size(); i++) {
+    if (bounds_.empty() || ucmp_->Compare(bounds_.back(), all[i]) != 0) {
+      bounds_.push_back(all[i]);
+    }
+  }
+
+  seqs_.assign(bounds_.empty() ? 0 : bounds_.size() - 1,
+               std::vector<SequenceNumber>());
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    const Tombstone& t = tombstones_[i];
+    size_t first = std::lower_bound(bounds_.begin(), bounds_.end(),
+                                    t.begin, less) - bounds_.begin();
+    size_t limit = std::lower_bound(bounds_.begin(), bounds_.end(),
+                                    t.end, less) - bounds_.begin();
+    for (size_t f = first; f < limit; f++) {
+      seqs_[f].push_back(t.seq);
+    }
+  }
+  for (size_t f = 0; f < seqs_.size(); f++) {
+    std::sort(seqs_[f].begin(), seqs_[f].end(),
+              std::greater<SequenceNumber>());
+  }
+}
+
+SequenceNumber RangeDelMap::MaxCoveringSeq(const Slice& user_key,
+                                           SequenceNumber snapshot) const {
+  if (seqs_.empty()) {
+    return 0;
+  }
+  // The fragment starting at the last bound <= user_key
+  size_t pos = std::upper_bound(bounds_.begin(), bounds_.end(), user_key,
+                                BoundLess(ucmp_)) - bounds_.begin();
+  if (pos == 0 || pos > seqs_.size()) {
+    return 0;
+  }
+  const std::vector<SequenceNumber>& seqs = seqs_[pos - 1];
+  for (size_t i = 0; i < seqs.size(); i++) {
+    if (seqs[i] <= snapshot) {
+      return seqs[i];
+    }
+  }
+  return 0;
+}
+
+}  // namespace leveldb
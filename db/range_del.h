@@ -0,0 +1,72 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Range deletions: DB::DeleteRange(begin, end) records a tombstone that
+// hides every entry of a user key in [begin, end) with a smaller sequence
+// number.  Tombstones live in the memtable until it is flushed and in the
+// Version (and so in the MANIFEST) afterwards, never in the tables.
+
+#ifndef STORAGE_LEVELDB_DB_RANGE_DEL_H_
+#define STORAGE_LEVELDB_DB_RANGE_DEL_H_
+
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+
+namespace leveldb {
+
+class Comparator;
+
+// Answers "which range deletion hides this key" for a set of tombstones,
+// cut into disjoint fragments so that a lookup is a binary search.
+//
+// Not thread-safe while being built; const lookups after Finish() are.
+class RangeDelMap {
+ public:
+  explicit RangeDelMap(const Comparator* ucmp);
+
+  // Adds the deletion of the user keys in [begin, end) at sequence "seq".
+  // An empty or inverted range is ignored.
+  void Add(const Slice& begin, const Slice& end, SequenceNumber seq);
+
+  // Adds every tombstone yielded by *iter, the layout of
+  // MemTable::NewRangeDelIterator().
+  void AddFrom(Iterator* iter);
+
+  // REQUIRES: called once after the last Add() and before any lookup.
+  void Finish();
+
+  bool empty() const { return tombstones_.empty(); }
+
+  // Returns the largest sequence number not above "snapshot" among the
+  // tombstones covering user_key, or 0 if there is none.  An entry of
+  // user_key with a smaller sequence number is deleted at "snapshot".
+  SequenceNumber MaxCoveringSeq(const Slice& user_key,
+                                SequenceNumber snapshot) const;
+
+ private:
+  struct Tombstone {
+    std::string begin;
+    std::string end;
+    SequenceNumber seq;
+  };
+
+  struct BoundLess;
+
+  const Comparator* ucmp_;
+  std::vector<Tombstone> tombstones_;
+
+  // Fragment i is [bounds_[i], bounds_[i+1]); seqs_[i] holds the sequence
+  // numbers of the tombstones covering it, largest first.
+  std::vector<std::string> bounds_;
+  std::vector<std::vector<SequenceNumber> > seqs_;
+
+  // No copying allowed
+  RangeDelMap(const RangeDelMap&);
+  void operator=(const RangeDelMap&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_RANGE_DEL_H_
@@ -0,0 +1,236 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/range_del.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "db/db_impl.h"
+#include "db/filename.h"
+#include "leveldb/comparator.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "util/logging.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class RangeDelMapTest {
+ public:
+  RangeDelMap map_;
+
+  RangeDelMapTest() : map_(BytewiseComparator()) { }
+
+  SequenceNumber Covering(const char* key, SequenceNumber snapshot) {
+    return map_.MaxCoveringSeq(key, snapshot);
+  }
+};
+
+TEST(RangeDelMapTest, Empty) {
+  map_.Finish();
+  ASSERT_TRUE(map_.empty());
+  ASSERT_EQ(0, Covering("a", kMaxSequenceNumber));
+}
+
+TEST(RangeDelMapTest, Single) {
+  map_.Add("b", "d", 5);
+  map_.Finish();
+  ASSERT_TRUE(!map_.empty());
+  ASSERT_EQ(0, Covering("a", kMaxSequenceNumber));
+  ASSERT_EQ(5, Covering("b", kMaxSequenceNumber));
+  ASSERT_EQ(5, Covering("c", kMaxSequenceNumber));
+  ASSERT_EQ(0, Covering("d", kMaxSequenceNumber));  // End is exclusive
+  ASSERT_EQ(0, Covering("b", 4));  // Not visible at an older snapshot
+}
+
+TEST(RangeDelMapTest, Overlapping) {
+  map_.Add("a", "e", 3);
+  map_.Add("c", "g", 7);
+  map_.Add("d", "f", 5);
+  map_.Finish();
+  ASSERT_EQ(3, Covering("b", kMaxSequenceNumber));
+  ASSERT_EQ(7, Covering("c", kMaxSequenceNumber));
+  ASSERT_EQ(7, Covering("d", kMaxSequenceNumber));
+  ASSERT_EQ(5, Covering("d", 6));
+  ASSERT_EQ(3, Covering("d", 4));
+  ASSERT_EQ(0, Covering("d", 2));
+  ASSERT_EQ(0, Covering("f", 6));
+  ASSERT_EQ(7, Covering("f", 7));
+  ASSERT_EQ(0, Covering("g", kMaxSequenceNumber));
+}
+
+TEST(RangeDelMapTest, EmptyAndInvertedRanges) {
+  map_.Add("c", "c", 4);
+  map_.Add("d", "b", 6);
+  map_.Finish();
+  ASSERT_TRUE(map_.empty());
+  ASSERT_EQ(0, Covering("c", kMaxSequenceNumber));
+}
+
+class RangeDelTest {
+ public:
+  std::string dbname_;
+  Env* env_;
+  DB* db_;
+
+  RangeDelTest() : env_(Env::Default()), db_(NULL) {
+    dbname_ = test::TmpDir() + "/range_del_test";
+    DestroyDB(dbname_, Options());
+    Options options;
+    options.create_if_missing = true;
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  ~RangeDelTest() {
+    // Tables live in the zone manager rather than the directory, so
+    // DestroyDB() does not see them; drop them by number so that the
+    // next test can reuse the file numbers.
+    std::vector<uint64_t> tables;
+    std::string sstables;
+    ASSERT_TRUE(db_->GetProperty("leveldb.sstables", &sstables));
+    Slice in(sstables);
+    while (!in.empty()) {
+      uint64_t number;
+      if (in[0] == ' ') {
+        in.remove_prefix(1);
+        ASSERT_TRUE(ConsumeDecimalNumber(&in, &number));
+        tables.push_back(number);
+      }
+      const char* eol = strchr(in.data(), '\n');
+      in.remove_prefix(eol == NULL ? in.size() : eol - in.data() + 1);
+    }
+    delete db_;
+    for (size_t i = 0; i < tables.size(); i++) {
+      env_->DeleteFile(TableFileName(dbname_, tables[i]));
+    }
+    DestroyDB(dbname_, Options());
+  }
+
+  DBImpl* dbfull() {
+    return reinterpret_cast<DBImpl*>(db_);
+  }
+
+  Status Put(const std::string& k, const std::string& v) {
+    return db_->Put(WriteOptions(), k, v);
+  }
+
+  std::string Get(const std::string& k, const Snapshot* snapshot = NULL) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::string result;
+    Status s = db_->Get(options, k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  // Return the visible contents, checking that reverse iteration agrees
+  std::string Contents() {
+    std::vector<std::string> forward;
+    std::string result;
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      std::string s = iter->key().ToString() + "->" + iter->value().ToString();
+      result += "(" + s + ")";
+      forward.push_back(s);
+    }
+    size_t matched = 0;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      ASSERT_LT(matched, forward.size());
+      ASSERT_EQ(iter->key().ToString() + "->" + iter->value().ToString(),
+                forward[forward.size() - matched - 1]);
+      matched++;
+    }
+    ASSERT_EQ(matched, forward.size());
+    delete iter;
+    return result;
+  }
+
+  // Return the number of stored entries of user_key, deleted or not
+  int CountEntries(const Slice& user_key) {
+    Iterator* iter = dbfull()->TEST_NewInternalIterator();
+    InternalKey target(user_key, kMaxSequenceNumber, kValueTypeForSeek);
+    int count = 0;
+    for (iter->Seek(target.Encode()); iter->Valid(); iter->Next()) {
+      ParsedInternalKey ikey;
+      ASSERT_TRUE(ParseInternalKey(iter->key(), &ikey));
+      if (ikey.user_key != user_key) {
+        break;
+      }
+      count++;
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+    return count;
+  }
+
+  int TotalTableFiles() {
+    int result = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      std::string property;
+      ASSERT_TRUE(db_->GetProperty(
+          "leveldb.num-files-at-level" + NumberToString(level), &property));
+      result += atoi(property.c_str());
+    }
+    return result;
+  }
+};
+
+TEST(RangeDelTest, DeleteRange) {
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("b", "vb"));
+  ASSERT_OK(Put("c", "vc"));
+  ASSERT_OK(Put("d", "vd"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "b", "d"));
+  ASSERT_TRUE(db_->DeleteRange(WriteOptions(), "d", "b").IsInvalidArgument());
+  ASSERT_OK(Put("c", "vc2"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("vc2", Get("c"));
+  ASSERT_EQ("vb", Get("b", snapshot));
+  ASSERT_EQ("(a->va)(c->vc2)(d->vd)", Contents());
+
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("vb", Get("b", snapshot));
+  ASSERT_EQ("(a->va)(c->vc2)(d->vd)", Contents());
+
+  // Once no snapshot needs them, compaction drops the covered entries.
+  // Push the table down through every level so that it is rewritten.
+  db_->ReleaseSnapshot(snapshot);
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    dbfull()->TEST_CompactRange(level, NULL, NULL);
+  }
+  ASSERT_EQ(0, CountEntries("b"));
+  ASSERT_EQ(1, CountEntries("c"));
+  ASSERT_EQ("vc2", Get("c"));
+  ASSERT_EQ("(a->va)(c->vc2)(d->vd)", Contents());
+}
+
+TEST(RangeDelTest, DropsCoveredTables) {
+  ASSERT_OK(Put("a", "begin"));
+  ASSERT_OK(Put("z", "end"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK(Put("k" + NumberToString(i), "v"));
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  }
+  const int tables = TotalTableFiles();
+
+  // The tables holding only "k*" keys go without being compacted
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "k", "l"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ(tables - 3, TotalTableFiles());
+  ASSERT_EQ("(a->begin)(z->end)", Contents());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
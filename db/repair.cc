@@ -32,12 +32,15 @@
 #include "db/log_writer.h"
 #include "db/memtable.h"
 #include "db/table_cache.h"
+#include "db/value_log.h"
 #include "db/version_edit.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/comparator.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 
+#include "../hm/get_manager.h"
+
 namespace leveldb {
 
 namespace {
@@ -48,16 +51,19 @@ class Repairer {
       : dbname_(dbname),
         env_(options.env),
         icmp_(options.comparator),
-        ipolicy_(options.filter_policy),
+        ipolicy_(options.filter_policy, options.prefix_extractor),
         options_(SanitizeOptions(dbname, &icmp_, &ipolicy_, options)),
         owns_info_log_(options_.info_log != options.info_log),
         owns_cache_(options_.block_cache != options.block_cache),
         next_file_number_(1) {
+    // The repaired MANIFEST goes where DB::Open() will look for it
+    Singleton::Gethmmanager()->set_log_dbname(dbname_);
     // TableCache can be small since we expect each table to be opened once.
     table_cache_ = new TableCache(dbname_, &options_, 10);
   }
 
   ~Repairer() {
+    Singleton::Gethmmanager()->clear_log_dbname(dbname_);
     delete table_cache_;
     if (owns_info_log_) {
       delete options_.info_log;
@@ -119,6 +125,13 @@ class Repairer {
     if (!status.ok()) {
       return status;
     }
+    // Tables live in the zone manager, not in the directory
+    std::map<uint64_t, struct Ldbfile*> *table;
+    Singleton::Gethmmanager()->get_table(&table);
+    std::map<uint64_t, struct Ldbfile*>::iterator it;
+    for (it = table->begin(); it != table->end(); it++) {
+      filenames.push_back(TableFileName("", it->first).substr(1));
+    }
     if (filenames.empty()) {
       return Status::IOError(dbname_, "repair found no files");
     }
@@ -224,13 +237,23 @@ class Repairer {
     FileMetaData meta;
     meta.number = next_file_number_++;
     Iterator* iter = mem->NewIterator();
-    status = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    WritableFile* file = NULL;
+    std::vector<std::string> value_pointers;
+    status = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta,
+                        &file, NULL, &value_pointers);
     delete iter;
     mem->Unref();
     mem = NULL;
     if (status.ok()) {
       if (meta.file_size > 0) {
-        table_numbers_.push_back(meta.number);
+        // The table reaches the zones only when it is synced
+        status = file->Sync();
+        delete file;
+        if (status.ok()) {
+          table_numbers_.push_back(meta.number);
+        } else {
+          ReleaseValueLog(value_pointers);
+        }
       }
     }
     Log(options_.info_log, "Log #%llu: %d ops saved to Table #%llu %s",
@@ -373,7 +396,9 @@ class Repairer {
   }
 
   Status WriteDescriptor() {
-    std::string tmp = TempFileName(dbname_, 1);
+    // Give the temporary file a descriptor name so that it is stored next
+    // to the final MANIFEST and the rename below does not copy it.
+    std::string tmp = DescriptorFileName(dbname_, next_file_number_++);
     WritableFile* file;
     Status status = env_->NewWritableFile(tmp, &file);
     if (!status.ok()) {
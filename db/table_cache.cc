@@ -8,6 +8,7 @@
 #include "leveldb/env.h"
 #include "leveldb/table.h"
 #include "util/coding.h"
+#include "util/perf_context_imp.h"
 
 namespace leveldb {
 
@@ -113,6 +114,7 @@ Status TableCache::Get(const ReadOptions& options,
   Cache::Handle* handle = NULL;
   Status s = FindTable(file_number, file_size, &handle,1);
   if (s.ok()) {
+    PERF_COUNTER_ADD(table_probes, 1);
     Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
     s = t->InternalGet(options, k, arg, saver);
     cache_->Release(handle);
@@ -120,6 +122,24 @@ Status TableCache::Get(const ReadOptions& options,
   return s;
 }
 
+bool TableCache::PrefixMayMatch(uint64_t file_number,
+                                uint64_t file_size,
+                                const Slice& target,
+                                const Slice& prefix) {
+  // Opened like Get() does, so that a skipped table costs its index and
+  // filter reads only
+  Cache::Handle* handle = NULL;
+  Status s = FindTable(file_number, file_size, &handle, 1);
+  if (!s.ok()) {
+    return true;  // Let the iterator report the error
+  }
+  Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  InternalKey filter_key(prefix, kMaxSequenceNumber, kValueTypeForSeek);
+  bool may_match = t->PrefixMayMatch(target, filter_key.Encode());
+  cache_->Release(handle);
+  return may_match;
+}
+
 void TableCache::Evict(uint64_t file_number) {
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
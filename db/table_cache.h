@@ -46,6 +46,14 @@ class TableCache {
              void* arg,
              void (*handle_result)(void*, const Slice&, const Slice&));
 
+  // Return false if the prefix filter of the specified file shows that
+  // it holds no key with user key prefix "prefix" at or after the
+  // internal key "target".
+  bool PrefixMayMatch(uint64_t file_number,
+                      uint64_t file_size,
+                      const Slice& target,
+                      const Slice& prefix);
+
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
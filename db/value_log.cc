@@ -0,0 +1,131 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/value_log.h"
+
+#include <errno.h>
+#include "db/dbformat.h"
+#include "leveldb/iterator.h"
+#include "util/coding.h"
+#include "../hm/get_manager.h"
+#include "../hm/hm_manager.h"
+
+namespace leveldb {
+
+void ValuePointer::EncodeTo(std::string* dst) const {
+  PutVarint64(dst, zone);
+  PutVarint64(dst, offset);
+  PutVarint64(dst, size);
+}
+
+bool ValuePointer::DecodeFrom(const Slice& input) {
+  Slice in = input;
+  return GetVarint64(&in, &zone) &&
+         GetVarint64(&in, &offset) &&
+         GetVarint64(&in, &size) &&
+         in.empty();
+}
+
+namespace {
+
+// Writes the batched values and turns their batch offsets into pointers.
+Status FlushBatch(HMManager* hm, std::string* batch,
+                  std::vector<ValuePointer>* pending,
+                  std::vector<std::string>* pointers) {
+  if (batch->empty()) {
+    return Status::OK();
+  }
+  uint64_t zone, offset;
+  if (hm->vlog_write(batch->data(), batch->size(), &zone, &offset) < 0) {
+    if (errno == ENOSPC) {
+      return Status::NoSpace("value log", "no free zone");
+    }
+    return Status::IOError("value log write failed");
+  }
+  for (size_t i = 0; i < pending->size(); i++) {
+    ValuePointer& ptr = (*pending)[i];
+    ptr.zone = zone;
+    ptr.offset += offset;
+    std::string encoded;
+    ptr.EncodeTo(&encoded);
+    pointers->push_back(encoded);
+  }
+  batch->clear();
+  pending->clear();
+  return Status::OK();
+}
+
+}  // namespace
+
+Status WriteValueLog(Iterator* iter, size_t threshold,
+                     std::vector<std::string>* pointers) {
+  HMManager* hm = Singleton::Gethmmanager();
+  const size_t old_size = pointers->size();
+  std::string batch;
+  std::vector<ValuePointer> pending;
+  Status s;
+  for (iter->SeekToFirst(); s.ok() && iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(iter->key(), &ikey) || ikey.type != kTypeValue) {
+      continue;
+    }
+    Slice value = iter->value();
+    if (value.size() < threshold) {
+      continue;
+    }
+    ValuePointer ptr;
+    ptr.offset = batch.size();
+    ptr.size = value.size();
+    batch.append(value.data(), value.size());
+    pending.push_back(ptr);
+    if (batch.size() >= VALUE_LOG_BATCH) {
+      s = FlushBatch(hm, &batch, &pending, pointers);
+    }
+  }
+  if (s.ok()) {
+    s = FlushBatch(hm, &batch, &pending, pointers);
+  }
+  if (s.ok()) {
+    s = iter->status();
+  }
+  if (!s.ok()) {
+    // Otherwise the bytes stay live and their zones are never reset
+    for (size_t i = old_size; i < pointers->size(); i++) {
+      ReleaseValueLog((*pointers)[i]);
+    }
+    pointers->resize(old_size);
+  }
+  return s;
+}
+
+Status ReadValueLog(std::string* value) {
+  ValuePointer ptr;
+  if (!ptr.DecodeFrom(*value)) {
+    return Status::Corruption("bad value pointer");
+  }
+  std::string result;
+  result.resize(ptr.size);
+  if (ptr.size > 0 &&
+      Singleton::Gethmmanager()->vlog_read(ptr.zone, ptr.offset,
+                                           &result[0], ptr.size) < 0) {
+    return Status::IOError("value log read failed");
+  }
+  value->swap(result);
+  return Status::OK();
+}
+
+void ReleaseValueLog(const Slice& pointer) {
+  ValuePointer ptr;
+  if (ptr.DecodeFrom(pointer)) {
+    Singleton::Gethmmanager()->vlog_release(ptr.zone, ptr.size);
+  }
+}
+
+void ReleaseValueLog(const std::vector<std::string>& pointers) {
+  for (size_t i = 0; i < pointers.size(); i++) {
+    ReleaseValueLog(pointers[i]);
+  }
+}
+
+}  // namespace leveldb
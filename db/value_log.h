@@ -0,0 +1,54 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Key-value separation: memtable flushes append the large values to
+// sequential zones of their own (the value log, kept by HMManager) and the
+// tables hold kTypeValueIndex entries whose value is a ValuePointer.
+// Compactions move only the pointers; a value log zone is reset once every
+// pointer into it has been dropped.
+
+#ifndef STORAGE_LEVELDB_DB_VALUE_LOG_H_
+#define STORAGE_LEVELDB_DB_VALUE_LOG_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class Iterator;
+
+struct ValuePointer {
+  uint64_t zone;
+  uint64_t offset;   // byte offset of the value in the zone
+  uint64_t size;
+
+  ValuePointer() : zone(0), offset(0), size(0) { }
+
+  void EncodeTo(std::string* dst) const;
+  bool DecodeFrom(const Slice& input);
+};
+
+// Appends every kTypeValue value of *iter of at least "threshold" bytes to
+// the value log, in iteration order, and stores the encoded ValuePointer
+// of each in *pointers.  Leaves *iter unpositioned.  On failure the values
+// already written are released again and *pointers is left as it was.
+extern Status WriteValueLog(Iterator* iter, size_t threshold,
+                            std::vector<std::string>* pointers);
+
+// Replaces the encoded ValuePointer in *value with the value it points to.
+extern Status ReadValueLog(std::string* value);
+
+// Records that the value "pointer" refers to is no longer reachable.
+extern void ReleaseValueLog(const Slice& pointer);
+
+// Releases every pointer of "pointers", e.g. when the table that was to
+// hold them could not be written.
+extern void ReleaseValueLog(const std::vector<std::string>& pointers);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_VALUE_LOG_H_
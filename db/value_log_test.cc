@@ -0,0 +1,214 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/value_log.h"
+
+#include <stdio.h>
+#include <vector>
+#include "db/db_impl.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "util/testharness.h"
+
+#include "../hm/get_manager.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+// A value of "size" bytes that differs per key and generation
+static std::string BigValue(int i, int gen, size_t size) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "%d.%d|", i, gen);
+  std::string result;
+  while (result.size() < size) {
+    result.append(buf);
+  }
+  result.resize(size);
+  return result;
+}
+
+class ValueLogTest {
+ public:
+  std::string dbname_;
+  Env* env_;
+  DB* db_;
+
+  ValueLogTest() : env_(Env::Default()), db_(NULL) {
+    dbname_ = test::TmpDir() + "/value_log_test";
+    DestroyDB(dbname_, Options());
+    Options options;
+    options.create_if_missing = true;
+    options.value_separation_threshold = 100;
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  ~ValueLogTest() {
+    // Tables live in the zone manager rather than the directory, so
+    // DestroyDB() does not see them.  Empty the DB instead, which also
+    // releases the values and lets the next test start on clean zones.
+    ASSERT_OK(db_->DeleteRange(WriteOptions(), "", "\xff"));
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    std::string sstables;
+    ASSERT_TRUE(db_->GetProperty("leveldb.sstables", &sstables));
+    ASSERT_EQ(std::string::npos, sstables.find(':'));
+    delete db_;
+    DestroyDB(dbname_, Options());
+  }
+
+  DBImpl* dbfull() {
+    return reinterpret_cast<DBImpl*>(db_);
+  }
+
+  Status Put(const std::string& k, const std::string& v) {
+    return db_->Put(WriteOptions(), k, v);
+  }
+
+  std::string Get(const std::string& k) {
+    std::string result;
+    Status s = db_->Get(ReadOptions(), k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  // Push every table down through all the levels, rewriting it
+  void CompactAll() {
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      dbfull()->TEST_CompactRange(level, NULL, NULL);
+    }
+  }
+
+  HMSpaceStats SpaceStats() {
+    HMSpaceStats stats;
+    Singleton::Gethmmanager()->get_space_stats(&stats);
+    return stats;
+  }
+};
+
+TEST(ValueLogTest, ReadBack) {
+  const int kNum = 50;
+  const uint64_t live = SpaceStats().vlog_live_bytes;
+  ASSERT_OK(Put("z-inline", "small"));
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_OK(Put(Key(i), BigValue(i, 0, 1000)));
+  }
+  ASSERT_EQ(BigValue(7, 0, 1000), Get(Key(7)));
+
+  // Only the values at or above the threshold move to the value log
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ(live + kNum * 1000, SpaceStats().vlog_live_bytes);
+  ASSERT_EQ("small", Get("z-inline"));
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_EQ(BigValue(i, 0, 1000), Get(Key(i)));
+  }
+
+  const std::string k3 = Key(3);
+  const std::string last = Key(kNum - 1);
+  std::vector<Slice> keys;
+  keys.push_back("z-inline");
+  keys.push_back(k3);
+  keys.push_back("missing");
+  keys.push_back(last);
+  std::vector<std::string> values;
+  std::vector<Status> statuses = db_->MultiGet(ReadOptions(), keys, &values);
+  ASSERT_EQ(4, statuses.size());
+  ASSERT_OK(statuses[0]);
+  ASSERT_EQ("small", values[0]);
+  ASSERT_OK(statuses[1]);
+  ASSERT_EQ(BigValue(3, 0, 1000), values[1]);
+  ASSERT_TRUE(statuses[2].IsNotFound());
+  ASSERT_OK(statuses[3]);
+  ASSERT_EQ(BigValue(kNum - 1, 0, 1000), values[3]);
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid() && i < kNum; iter->Next(), i++) {
+    ASSERT_EQ(Key(i), iter->key().ToString());
+    ASSERT_EQ(BigValue(i, 0, 1000), iter->value().ToString());
+  }
+  ASSERT_EQ(kNum, i);
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("z-inline", iter->key().ToString());
+  ASSERT_EQ("small", iter->value().ToString());
+  iter->Prev();
+  for (i = kNum - 1; iter->Valid(); iter->Prev(), i--) {
+    ASSERT_EQ(Key(i), iter->key().ToString());
+    ASSERT_EQ(BigValue(i, 0, 1000), iter->value().ToString());
+  }
+  ASSERT_EQ(-1, i);
+  ASSERT_OK(iter->status());
+  delete iter;
+}
+
+TEST(ValueLogTest, OverwriteAndCompaction) {
+  const int kNum = 50;
+  const uint64_t live = SpaceStats().vlog_live_bytes;
+  for (int gen = 0; gen < 3; gen++) {
+    for (int i = 0; i < kNum; i++) {
+      ASSERT_OK(Put(Key(i), BigValue(i, gen, 1000)));
+    }
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  }
+  ASSERT_EQ(live + 3 * kNum * 1000, SpaceStats().vlog_live_bytes);
+
+  // Compaction drops the pointers to the overwritten values
+  CompactAll();
+  ASSERT_EQ(live + kNum * 1000, SpaceStats().vlog_live_bytes);
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_EQ(BigValue(i, 2, 1000), Get(Key(i)));
+  }
+}
+
+TEST(ValueLogTest, PinnedVersionKeepsZone) {
+  // Enough values to seal a value log zone before the last overwrite
+  const HMSpaceStats start = SpaceStats();
+  const size_t kValueSize = 4000;
+  const int kNum = static_cast<int>(start.zone_size / kValueSize / 3);
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_OK(Put(Key(i), BigValue(i, 0, kValueSize)));
+  }
+  CompactAll();
+  Iterator* old = db_->NewIterator(ReadOptions());
+
+  for (int gen = 1; gen <= 4; gen++) {
+    for (int i = 0; i < kNum; i++) {
+      ASSERT_OK(Put(Key(i), BigValue(i, gen, kValueSize)));
+    }
+    CompactAll();
+  }
+  const uint64_t pinned_freed = SpaceStats().vlog_freed_zones;
+
+  // The iterator still reads the values its version points to
+  int i = 0;
+  for (old->SeekToFirst(); old->Valid(); old->Next(), i++) {
+    ASSERT_EQ(BigValue(i, 0, kValueSize), old->value().ToString());
+  }
+  ASSERT_EQ(kNum, i);
+  ASSERT_OK(old->status());
+  ASSERT_EQ(pinned_freed, SpaceStats().vlog_freed_zones);
+
+  // Released values are reclaimed by the next flush
+  delete old;
+  ASSERT_OK(Put("trigger", "x"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_GT(SpaceStats().vlog_freed_zones, pinned_freed);
+  for (i = 0; i < kNum; i++) {
+    ASSERT_EQ(BigValue(i, 4, kValueSize), Get(Key(i)));
+  }
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
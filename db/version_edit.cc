@@ -20,7 +20,9 @@ enum Tag {
   kDeletedFile          = 6,
   kNewFile              = 7,
   // 8 was used for large value refs
-  kPrevLogNumber        = 9
+  kPrevLogNumber        = 9,
+  kRangeDeletion        = 10,
+  kDeletedRangeDeletion = 11
 };
 
 void VersionEdit::Clear() {
@@ -36,6 +38,8 @@ void VersionEdit::Clear() {
   has_last_sequence_ = false;
   deleted_files_.clear();
   new_files_.clear();
+  new_range_dels_.clear();
+  deleted_range_dels_.clear();
 }
 
 void VersionEdit::EncodeTo(std::string* dst) const {
@@ -83,6 +87,23 @@ void VersionEdit::EncodeTo(std::string* dst) const {
     PutLengthPrefixedSlice(dst, f.smallest.Encode());
     PutLengthPrefixedSlice(dst, f.largest.Encode());
   }
+
+  for (std::set<SequenceNumber>::const_iterator iter =
+           deleted_range_dels_.begin();
+       iter != deleted_range_dels_.end();
+       ++iter) {
+    PutVarint32(dst, kDeletedRangeDeletion);
+    PutVarint64(dst, *iter);
+  }
+
+  for (size_t i = 0; i < new_range_dels_.size(); i++) {
+    const RangeTombstone& t = new_range_dels_[i];
+    PutVarint32(dst, kRangeDeletion);
+    PutVarint64(dst, t.seq);
+    PutVarint64(dst, t.file_mark);
+    PutLengthPrefixedSlice(dst, t.begin);
+    PutLengthPrefixedSlice(dst, t.end);
+  }
 }
 
 static bool GetInternalKey(Slice* input, InternalKey* dst) {
@@ -116,7 +137,9 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
   int level;
   uint64_t number;
   FileMetaData f;
+  RangeTombstone t;
   Slice str;
+  Slice limit;
   InternalKey key;
 
   while (msg == NULL && GetVarint32(&input, &tag)) {
@@ -192,6 +215,27 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
         }
         break;
 
+      case kRangeDeletion:
+        if (GetVarint64(&input, &t.seq) &&
+            GetVarint64(&input, &t.file_mark) &&
+            GetLengthPrefixedSlice(&input, &str) &&
+            GetLengthPrefixedSlice(&input, &limit)) {
+          t.begin = str.ToString();
+          t.end = limit.ToString();
+          new_range_dels_.push_back(t);
+        } else {
+          msg = "range deletion";
+        }
+        break;
+
+      case kDeletedRangeDeletion:
+        if (GetVarint64(&input, &number)) {
+          deleted_range_dels_.insert(number);
+        } else {
+          msg = "deleted range deletion";
+        }
+        break;
+
       default:
         msg = "unknown tag";
         break;
@@ -259,6 +303,25 @@ std::string VersionEdit::DebugString() const {
     r.append(" .. ");
     r.append(f.largest.DebugString());
   }
+  for (std::set<SequenceNumber>::const_iterator iter =
+           deleted_range_dels_.begin();
+       iter != deleted_range_dels_.end();
+       ++iter) {
+    r.append("\n  DeleteRangeDeletion: ");
+    AppendNumberTo(&r, *iter);
+  }
+  for (size_t i = 0; i < new_range_dels_.size(); i++) {
+    const RangeTombstone& t = new_range_dels_[i];
+    r.append("\n  AddRangeDeletion: ");
+    AppendNumberTo(&r, t.seq);
+    r.append(" ");
+    AppendNumberTo(&r, t.file_mark);
+    r.append(" '");
+    AppendEscapedStringTo(&r, t.begin);
+    r.append("' .. '");
+    AppendEscapedStringTo(&r, t.end);
+    r.append("'");
+  }
   r.append("\n}\n");
   return r;
 }
@@ -25,6 +25,16 @@ struct FileMetaData {
   FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) { }
 };
 
+// A flushed range deletion, see db/range_del.h.
+struct RangeTombstone {
+  std::string begin;          // First user key deleted
+  std::string end;            // User key past the deleted range
+  SequenceNumber seq;         // Unique: also identifies the tombstone
+  uint64_t file_mark;         // Tables numbered below only hold older entries
+
+  RangeTombstone() : seq(0), file_mark(0) { }
+};
+
 class VersionEdit {
  public:
   VersionEdit() { Clear(); }
@@ -76,6 +86,20 @@ class VersionEdit {
     deleted_files_.insert(std::make_pair(level, file));
   }
 
+  // Add a range deletion flushed from a memtable.
+  void AddRangeDeletion(const RangeTombstone& t) {
+    new_range_dels_.push_back(t);
+  }
+
+  // Retire the range deletion of sequence number "seq".
+  void DeleteRangeDeletion(SequenceNumber seq) {
+    deleted_range_dels_.insert(seq);
+  }
+
+  bool HasRangeDeletionChanges() const {
+    return !new_range_dels_.empty() || !deleted_range_dels_.empty();
+  }
+
   void EncodeTo(std::string* dst) const;
   Status DecodeFrom(const Slice& src);
 
@@ -100,6 +124,8 @@ class VersionEdit {
   std::vector< std::pair<int, InternalKey> > compact_pointers_;
   DeletedFileSet deleted_files_;
   std::vector< std::pair<int, FileMetaData> > new_files_;
+  std::vector<RangeTombstone> new_range_dels_;
+  std::set<SequenceNumber> deleted_range_dels_;
 };
 
 }  // namespace leveldb
@@ -30,6 +30,13 @@ TEST(VersionEditTest, EncodeDecode) {
                  InternalKey("zoo", kBig + 600 + i, kTypeDeletion));
     edit.DeleteFile(4, kBig + 700 + i);
     edit.SetCompactPointer(i, InternalKey("x", kBig + 900 + i, kTypeValue));
+    RangeTombstone t;
+    t.begin = "bar";
+    t.end = "baz";
+    t.seq = kBig + 800 + i;
+    t.file_mark = kBig + 850 + i;
+    edit.AddRangeDeletion(t);
+    edit.DeleteRangeDeletion(kBig + 750 + i);
   }
 
   edit.SetComparatorName("foo");
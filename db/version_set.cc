@@ -11,6 +11,7 @@
 #include "db/log_writer.h"
 #include "db/memtable.h"
 #include "db/table_cache.h"
+#include "db/value_log.h"
 #include "leveldb/env.h"
 #include "leveldb/table_builder.h"
 #include "table/merger.h"
@@ -55,6 +56,10 @@ static uint64_t MaxFileSizeForLevel(const Options* options, int level) {
   return TargetFileSize(options);
 }
 
+// Score added to a level whose zones hold no live data at all while the
+// drive is short of free zones; see Finalize().
+static const double kZonePressureBoost = 2.0;
+
 static int64_t TotalFileSize(const std::vector<FileMetaData*>& files) {
   int64_t sum = 0;
   for (size_t i = 0; i < files.size(); i++) {
@@ -81,6 +86,7 @@ Version::~Version() {
       }
     }
   }
+  delete range_del_map_;
 }
 
 int FindFile(const InternalKeyComparator& icmp,
@@ -231,22 +237,123 @@ Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
       &GetFileIterator, vset_->table_cache_, options);
 }
 
+namespace {
+// Wraps the iterator of a level 0 table ("file" non-NULL) or of a sorted
+// level ("files").  While the prefix state is enabled, Seek() first checks
+// the prefix filter of the one table that can hold the keys with the
+// target's prefix at or after it: in a sorted level, a later table that
+// held such a key would make the largest key of the first one share the
+// prefix too.
+class PrefixCheckingIterator : public Iterator {
+ public:
+  PrefixCheckingIterator(Iterator* iter, PrefixSeekState* state,
+                         TableCache* table_cache,
+                         const InternalKeyComparator* icmp,
+                         const FileMetaData* file,
+                         const std::vector<FileMetaData*>* files)
+      : iter_(iter),
+        state_(state),
+        table_cache_(table_cache),
+        icmp_(icmp),
+        file_(file),
+        files_(files),
+        skipped_(false) {
+  }
+  virtual ~PrefixCheckingIterator() {
+    delete iter_;
+  }
+  virtual bool Valid() const { return !skipped_ && iter_->Valid(); }
+  virtual Slice key() const { return iter_->key(); }
+  virtual Slice value() const { return iter_->value(); }
+  virtual Status status() const { return iter_->status(); }
+  virtual void Seek(const Slice& target) {
+    skipped_ = state_->enabled && !PrefixMayMatch(target);
+    if (!skipped_) {
+      iter_->Seek(target);
+    }
+  }
+  virtual void SeekToFirst() {
+    skipped_ = false;
+    iter_->SeekToFirst();
+  }
+  virtual void SeekToLast() {
+    skipped_ = false;
+    iter_->SeekToLast();
+  }
+  virtual void Next() { iter_->Next(); }
+  virtual void Prev() { iter_->Prev(); }
+
+ private:
+  bool PrefixMayMatch(const Slice& target) {
+    const Slice user_key = ExtractUserKey(target);
+    if (!state_->prefix_extractor->InDomain(user_key)) {
+      return true;
+    }
+    const FileMetaData* f = file_;
+    if (f == NULL) {
+      uint32_t index = FindFile(*icmp_, *files_, target);
+      if (index >= files_->size()) {
+        return true;  // Nothing to skip, the seek finds no table
+      }
+      f = (*files_)[index];
+    }
+    return table_cache_->PrefixMayMatch(
+        f->number, f->file_size, target,
+        state_->prefix_extractor->Transform(user_key));
+  }
+
+  Iterator* const iter_;
+  PrefixSeekState* const state_;
+  TableCache* const table_cache_;
+  const InternalKeyComparator* const icmp_;
+  const FileMetaData* const file_;
+  const std::vector<FileMetaData*>* const files_;
+  bool skipped_;  // Seek() found no table that can hold the prefix
+};
+}  // namespace
+
 void Version::AddIterators(const ReadOptions& options,
-                           std::vector<Iterator*>* iters) {
+                           std::vector<Iterator*>* iters,
+                           PrefixSeekState* prefix_state) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  const Slice* upper_bound = options.iterate_upper_bound;
+
   // Merge all level zero files together since they may overlap
   for (size_t i = 0; i < files_[0].size(); i++) {
-    iters->push_back(
-        vset_->table_cache_->NewIterator(
-            options, files_[0][i]->number, files_[0][i]->file_size));
+    FileMetaData* f = files_[0][i];
+    if (upper_bound != NULL &&
+        ucmp->Compare(f->smallest.user_key(), *upper_bound) >= 0) {
+      continue;
+    }
+    Iterator* iter = vset_->table_cache_->NewIterator(
+        options, f->number, f->file_size);
+    if (prefix_state != NULL) {
+      iter = new PrefixCheckingIterator(iter, prefix_state,
+                                        vset_->table_cache_, &vset_->icmp_,
+                                        f, NULL);
+    }
+    iters->push_back(iter);
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
   // walks through the non-overlapping files in the level, opening them
   // lazily.
   for (int level = 1; level < config::kNumLevels; level++) {
-    if (!files_[level].empty()) {
-      iters->push_back(NewConcatenatingIterator(options, level));
+    if (files_[level].empty()) {
+      continue;
+    }
+    if (upper_bound != NULL &&
+        ucmp->Compare(files_[level][0]->smallest.user_key(),
+                      *upper_bound) >= 0) {
+      continue;
     }
+    Iterator* iter = NewConcatenatingIterator(options, level);
+    if (prefix_state != NULL) {
+      iter = new PrefixCheckingIterator(iter, prefix_state,
+                                        vset_->table_cache_, &vset_->icmp_,
+                                        NULL, &files_[level]);
+    }
+    iters->push_back(iter);
   }
 }
 
@@ -263,6 +370,8 @@ struct Saver {
   const Comparator* ucmp;
   Slice user_key;
   std::string* value;
+  bool separated;   // *value is a ValuePointer into the value log
+  SequenceNumber sequence;   // Of the entry found
 };
 }
 static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
@@ -272,14 +381,26 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
     s->state = kCorrupt;
   } else {
     if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
-      s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
+      s->state = (parsed_key.type == kTypeDeletion) ? kDeleted : kFound;
       if (s->state == kFound) {
         s->value->assign(v.data(), v.size());
+        s->separated = (parsed_key.type == kTypeValueIndex);
+        s->sequence = parsed_key.sequence;
       }
     }
   }
 }
 
+bool Version::RangeDeleted(const LookupKey& k, SequenceNumber seq) const {
+  if (range_del_map_ == NULL) {
+    return false;
+  }
+  Slice ikey = k.internal_key();
+  const SequenceNumber snapshot =
+      DecodeFixed64(ikey.data() + ikey.size() - 8) >> 8;
+  return seq < range_del_map_->MaxCoveringSeq(k.user_key(), snapshot);
+}
+
 static bool NewestFirst(FileMetaData* a, FileMetaData* b) {
   return a->number > b->number;
 }
@@ -418,6 +539,8 @@ Status Version::Get(const ReadOptions& options,
       saver.ucmp = ucmp;
       saver.user_key = user_key;
       saver.value = value;
+      saver.separated = false;
+      saver.sequence = 0;
       s = vset_->table_cache_->Get(options, f->number, f->file_size,
                                    ikey, &saver, SaveValue);
       if (!s.ok()) {
@@ -427,6 +550,11 @@ Status Version::Get(const ReadOptions& options,
         case kNotFound:
           break;      // Keep searching in other files
         case kFound:
+          if (RangeDeleted(k, saver.sequence)) {
+            s = Status::NotFound(Slice());
+          } else if (saver.separated) {
+            s = ReadValueLog(value);
+          }
           return s;
         case kDeleted:
           s = Status::NotFound(Slice());  // Use empty error message for speed
@@ -441,6 +569,154 @@ Status Version::Get(const ReadOptions& options,
   return Status::NotFound(Slice());  // Use an empty error message for speed
 }
 
+namespace {
+// One table probe issued by Version::MultiGet.
+struct MultiGetProbe {
+  size_t key_index;     // Index of the key in the batch
+  FileMetaData* file;   // Table that may hold the key
+  uint64_t zone;        // Location of the table on the drive
+  uint64_t offset;
+};
+
+// Orders probes by their position on the drive so that one pass over the
+// sorted list moves the head in a single direction.
+static bool ByDiskLocation(const MultiGetProbe& a, const MultiGetProbe& b) {
+  if (a.zone != b.zone) return a.zone < b.zone;
+  if (a.offset != b.offset) return a.offset < b.offset;
+  return a.key_index < b.key_index;
+}
+}  // namespace
+
+void Version::MultiGet(const ReadOptions& options,
+                       const std::vector<LookupKey*>& keys,
+                       std::vector<bool>* pending,
+                       std::vector<std::string>* values,
+                       std::vector<Status>* statuses,
+                       GetStats* stats) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  HMManager* hm_manager = Singleton::Gethmmanager();
+  const size_t n = keys.size();
+
+  stats->seek_file = NULL;
+  stats->seek_file_level = -1;
+  std::vector<FileMetaData*> last_file_read(n, NULL);
+  std::vector<int> last_file_read_level(n, -1);
+
+  // As in Get(), search level-by-level: a key resolved at a smaller level
+  // is never probed again in the later levels.
+  std::vector<std::vector<FileMetaData*> > candidates(n);
+  std::vector<MultiGetProbe> probes;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    const size_t num_files = files_[level].size();
+    if (num_files == 0) continue;
+
+    // Resolve every unfinished key against the file metadata first.
+    // Level-0 files may overlap each other, so a key can have several
+    // candidates there; they are probed in rounds, newest file first.
+    size_t rounds = 0;
+    for (size_t i = 0; i < n; i++) {
+      candidates[i].clear();
+      if (!(*pending)[i]) continue;
+      Slice user_key = keys[i]->user_key();
+      if (level == 0) {
+        for (size_t j = 0; j < num_files; j++) {
+          FileMetaData* f = files_[0][j];
+          if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
+              ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
+            candidates[i].push_back(f);
+          }
+        }
+        std::sort(candidates[i].begin(), candidates[i].end(), NewestFirst);
+      } else {
+        uint32_t index = FindFile(vset_->icmp_, files_[level],
+                                  keys[i]->internal_key());
+        if (index < num_files &&
+            ucmp->Compare(user_key,
+                          files_[level][index]->smallest.user_key()) >= 0) {
+          candidates[i].push_back(files_[level][index]);
+        }
+      }
+      if (candidates[i].size() > rounds) {
+        rounds = candidates[i].size();
+      }
+    }
+
+    for (size_t round = 0; round < rounds; round++) {
+      probes.clear();
+      for (size_t i = 0; i < n; i++) {
+        if (!(*pending)[i] || round >= candidates[i].size()) continue;
+        MultiGetProbe probe;
+        probe.key_index = i;
+        probe.file = candidates[i][round];
+        if (!hm_manager->get_table_location(probe.file->number,
+                                            &probe.zone, &probe.offset)) {
+          probe.zone = 0;
+          probe.offset = 0;
+        }
+        probes.push_back(probe);
+      }
+      std::sort(probes.begin(), probes.end(), ByDiskLocation);
+
+      for (size_t j = 0; j < probes.size(); j++) {
+        const size_t i = probes[j].key_index;
+        FileMetaData* f = probes[j].file;
+        if (last_file_read[i] != NULL && stats->seek_file == NULL) {
+          // This key needed more than one seek.  Charge its 1st file.
+          stats->seek_file = last_file_read[i];
+          stats->seek_file_level = last_file_read_level[i];
+        }
+        last_file_read[i] = f;
+        last_file_read_level[i] = level;
+
+        Saver saver;
+        saver.state = kNotFound;
+        saver.ucmp = ucmp;
+        saver.user_key = keys[i]->user_key();
+        saver.value = &(*values)[i];
+        saver.separated = false;
+        saver.sequence = 0;
+        Status s = vset_->table_cache_->Get(options, f->number, f->file_size,
+                                            keys[i]->internal_key(),
+                                            &saver, SaveValue);
+        if (!s.ok()) {
+          (*statuses)[i] = s;
+          (*pending)[i] = false;
+          continue;
+        }
+        switch (saver.state) {
+          case kNotFound:
+            break;      // Keep searching in other files
+          case kFound:
+            if (RangeDeleted(*keys[i], saver.sequence)) {
+              (*statuses)[i] = Status::NotFound(Slice());
+            } else {
+              (*statuses)[i] = saver.separated ? ReadValueLog(saver.value)
+                                               : Status::OK();
+            }
+            (*pending)[i] = false;
+            break;
+          case kDeleted:
+            (*statuses)[i] = Status::NotFound(Slice());
+            (*pending)[i] = false;
+            break;
+          case kCorrupt:
+            (*statuses)[i] = Status::Corruption("corrupted key for ",
+                                                saver.user_key);
+            (*pending)[i] = false;
+            break;
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    if ((*pending)[i]) {
+      (*statuses)[i] = Status::NotFound(Slice());
+      (*pending)[i] = false;
+    }
+  }
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != NULL) {
@@ -639,6 +915,8 @@ class VersionSet::Builder {
   VersionSet* vset_;
   Version* base_;
   LevelState levels_[config::kNumLevels];
+  std::set<SequenceNumber> deleted_range_dels_;
+  std::vector<RangeTombstone> added_range_dels_;
 
  public:
   // Initialize a builder with the files from *base and other info from *vset
@@ -718,6 +996,23 @@ class VersionSet::Builder {
       levels_[level].deleted_files.erase(f->number);
       levels_[level].added_files->insert(f);
     }
+
+    // Range deletions, identified by their sequence numbers
+    for (std::set<SequenceNumber>::const_iterator iter =
+             edit->deleted_range_dels_.begin();
+         iter != edit->deleted_range_dels_.end();
+         ++iter) {
+      deleted_range_dels_.insert(*iter);
+      for (size_t i = 0; i < added_range_dels_.size(); i++) {
+        if (added_range_dels_[i].seq == *iter) {
+          added_range_dels_.erase(added_range_dels_.begin() + i);
+          break;
+        }
+      }
+    }
+    for (size_t i = 0; i < edit->new_range_dels_.size(); i++) {
+      added_range_dels_.push_back(edit->new_range_dels_[i]);
+    }
   }
 
   // Save the current state in *v.
@@ -767,6 +1062,22 @@ class VersionSet::Builder {
       }
 #endif
     }
+
+    for (size_t i = 0; i < base_->range_dels_.size(); i++) {
+      if (deleted_range_dels_.count(base_->range_dels_[i].seq) == 0) {
+        v->range_dels_.push_back(base_->range_dels_[i]);
+      }
+    }
+    v->range_dels_.insert(v->range_dels_.end(), added_range_dels_.begin(),
+                          added_range_dels_.end());
+    if (!v->range_dels_.empty()) {
+      v->range_del_map_ = new RangeDelMap(vset_->icmp_.user_comparator());
+      for (size_t i = 0; i < v->range_dels_.size(); i++) {
+        const RangeTombstone& t = v->range_dels_[i];
+        v->range_del_map_->Add(t.begin, t.end, t.seq);
+      }
+      v->range_del_map_->Finish();
+    }
   }
 
   void MaybeAddFile(Version* v, int level, FileMetaData* f) {
@@ -1082,6 +1393,8 @@ void VersionSet::Finalize(Version* v,int flag) {
   // Precomputed best level for next compaction
   int best_level = -1;
   double best_score = -1;
+  HMManager* hm_manager = Singleton::Gethmmanager();
+  const bool capacity_pressure = hm_manager->is_capacity_pressure();
 
   for (int level = 0; level < config::kNumLevels-1; level++) {
     double score;
@@ -1104,6 +1417,12 @@ void VersionSet::Finalize(Version* v,int flag) {
       const uint64_t level_bytes = TotalFileSize(v->files_[level]);
       score =
           static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
+      if (capacity_pressure && level_bytes > 0) {
+        // A zone is reset only when its last table dies.  When free zones
+        // run short, favour the levels whose zones hold the most dead data.
+        score += kZonePressureBoost *
+            (1.0 - hm_manager->get_level_fill_percent(level) / 100.0);
+      }
     }
 
     if (score > best_score) {
@@ -1149,6 +1468,11 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
     }
   }
 
+  // Save range deletions
+  for (size_t i = 0; i < current_->range_dels_.size(); i++) {
+    edit.AddRangeDeletion(current_->range_dels_[i]);
+  }
+
   std::string record;
   edit.EncodeTo(&record);
   return log->AddRecord(record);
@@ -1226,6 +1550,18 @@ int64_t VersionSet::NumLevelBytes(int level) const {
   return TotalFileSize(current_->files_[level]);
 }
 
+uint64_t VersionSet::EstimatedPendingCompactionBytes() const {
+  uint64_t result = 0;
+  for (int level = 1; level < config::kNumLevels - 1; level++) {
+    const double excess = static_cast<double>(NumLevelBytes(level)) -
+                          MaxBytesForLevel(options_, level);
+    if (excess > 0) {
+      result += static_cast<uint64_t>(excess);
+    }
+  }
+  return result;
+}
+
 int64_t VersionSet::MaxNextLevelOverlappingBytes() {
   int64_t result = 0;
   std::vector<FileMetaData*> overlaps;
@@ -1348,8 +1684,18 @@ Compaction* VersionSet::PickCompaction() {
     assert(level+1 < config::kNumLevels);
     c = new Compaction(options_, level);
 
+#if ZONE_RECLAIM_PICK
+    if (level > 0) {
+      FileMetaData* f = PickZoneReclaimFile(level);
+      if (f != NULL) {
+        c->inputs_[0].push_back(f);
+      }
+    }
+#endif
+
     // Pick the first file that comes after compact_pointer_[level]
-    for (size_t i = 0; i < current_->files_[level].size(); i++) {
+    for (size_t i = 0; c->inputs_[0].empty() &&
+                       i < current_->files_[level].size(); i++) {
       FileMetaData* f = current_->files_[level][i];
       if (compact_pointer_[level].empty() ||
           icmp_.Compare(f->largest.Encode(), compact_pointer_[level]) > 0) {
@@ -1388,6 +1734,48 @@ Compaction* VersionSet::PickCompaction() {
   return c;
 }
 
+// A zone is reset once its last table is deleted, so a table's share of
+// its zone's live bytes is the expected part of a zone its deletion frees.
+// Both the table and the next-level tables it overlaps are deleted by the
+// compaction, and all of their bytes are read and rewritten.
+FileMetaData* VersionSet::PickZoneReclaimFile(int level) {
+  HMManager* hm_manager = Singleton::Gethmmanager();
+  std::map<uint64_t, double> share;
+  hm_manager->get_reclaim_share(level, &share);
+  hm_manager->get_reclaim_share(level + 1, &share);
+
+  const Comparator* ucmp = icmp_.user_comparator();
+  const std::vector<FileMetaData*>& files = current_->files_[level];
+  const std::vector<FileMetaData*>& next = current_->files_[level + 1];
+  FileMetaData* best = NULL;
+  double best_score = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    FileMetaData* f = files[i];
+    double zones = 0;
+    uint64_t bytes = f->file_size;
+    std::map<uint64_t, double>::iterator it = share.find(f->number);
+    if (it != share.end()) {
+      zones += it->second;
+    }
+    for (size_t j = FindFile(icmp_, next, f->smallest.Encode());
+         j < next.size() &&
+         ucmp->Compare(next[j]->smallest.user_key(), f->largest.user_key()) <= 0;
+         j++) {
+      it = share.find(next[j]->number);
+      if (it != share.end()) {
+        zones += it->second;
+      }
+      bytes += next[j]->file_size;
+    }
+    double score = zones / (bytes + 1);
+    if (score > best_score) {
+      best = f;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
 void VersionSet::SetupOtherInputs(Compaction* c) {
   const int level = c->level();
   InternalKey smallest, largest;
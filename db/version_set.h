@@ -19,6 +19,7 @@
 #include <set>
 #include <vector>
 #include "db/dbformat.h"
+#include "db/range_del.h"
 #include "db/version_edit.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -67,9 +68,13 @@ class Version {
   FileMetaData* Get_file(uint64_t filenum,int level);
 //////
   // Append to *iters a sequence of iterators that will
-  // yield the contents of this Version when merged together.
+  // yield the contents of this Version when merged together.  Tables
+  // that only hold keys at or past ReadOptions::iterate_upper_bound are
+  // left out.  If "prefix_state" is non-NULL, the table iterators consult
+  // the prefix filters on Seek() while it is enabled; it must outlive them.
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
-  void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
+  void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters,
+                    PrefixSeekState* prefix_state = NULL);
 
   // Lookup the value for key.  If found, store it in *val and
   // return OK.  Else return a non-OK status.  Fills *stats.
@@ -81,6 +86,18 @@ class Version {
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
              GetStats* stats);
 
+  // Batched lookup used by DB::MultiGet.  For every i with
+  // (*statuses)[i] not yet resolved (marked by *pending[i] == true),
+  // look up *keys[i] and store the outcome in (*values)[i] and
+  // (*statuses)[i].  The table probes of one level (or of one round of
+  // overlapping level-0 files) are issued sorted by the zone and offset
+  // of the table on the drive.  Fills *stats like Get().
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, const std::vector<LookupKey*>& keys,
+                std::vector<bool>* pending,
+                std::vector<std::string>* values,
+                std::vector<Status>* statuses, GetStats* stats);
+
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
   // REQUIRES: lock is held
@@ -118,6 +135,12 @@ class Version {
 
   int NumFiles(int level) const { return files_[level].size(); }
 
+  // The flushed range deletions, oldest first.
+  const std::vector<RangeTombstone>& range_dels() const { return range_dels_; }
+
+  // Lookup structure over range_dels(), NULL if there are none.
+  const RangeDelMap* range_del_map() const { return range_del_map_; }
+
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
 
@@ -128,6 +151,10 @@ class Version {
   class LevelFileNumIterator;
   Iterator* NewConcatenatingIterator(const ReadOptions&, int level) const;
 
+  // True if a range deletion visible at the snapshot of "k" hides the
+  // entry of k's user key with sequence number "seq".
+  bool RangeDeleted(const LookupKey& k, SequenceNumber seq) const;
+
   // Call func(arg, level, f) for every file that overlaps user_key in
   // order from newest to oldest.  If an invocation of func returns
   // false, makes no more calls.
@@ -145,6 +172,9 @@ class Version {
   // List of files per level
   std::vector<FileMetaData*> files_[config::kNumLevels];
 
+  std::vector<RangeTombstone> range_dels_;
+  RangeDelMap* range_del_map_;
+
   // Next file to compact based on seek stats.
   FileMetaData* file_to_compact_;
   int file_to_compact_level_;
@@ -157,6 +187,7 @@ class Version {
 
   explicit Version(VersionSet* vset)
       : vset_(vset), next_(this), prev_(this), refs_(0),
+        range_del_map_(NULL),
         file_to_compact_(NULL),
         file_to_compact_level_(-1),
         compaction_score_(-1),
@@ -213,6 +244,11 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
+  // Return the number of bytes by which levels 1 and above exceed their
+  // size targets, i.e. roughly how much data compaction still has to push
+  // down before the tree is back in shape.
+  uint64_t EstimatedPendingCompactionBytes() const;
+
   // Return the last sequence number.
   uint64_t LastSequence() const { return last_sequence_; }
 
@@ -299,6 +335,10 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
+  // Returns the file of "level" whose compaction is expected to free the
+  // most zones per byte of input, or NULL if no file would free any.
+  FileMetaData* PickZoneReclaimFile(int level);
+
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
@@ -352,6 +392,11 @@ class Compaction {
   // Maximum size of files to build during this compaction.
   uint64_t MaxOutputFileSize() const { return max_output_file_size_; }
 
+  // Range deletions of the input version, NULL if there are none.
+  const RangeDelMap* range_dels() const {
+    return input_version_->range_del_map();
+  }
+
   // Is this a trivial compaction that can be implemented by just
   // moving a single input file to the next level (no merging or splitting)
   bool IsTrivialMove() const;
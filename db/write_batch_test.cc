@@ -43,6 +43,20 @@ static std::string PrintContents(WriteBatch* b) {
     state.append(NumberToString(ikey.sequence));
   }
   delete iter;
+  iter = mem->NewRangeDelIterator();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    ASSERT_TRUE(ParseInternalKey(iter->key(), &ikey));
+    ASSERT_EQ(kTypeRangeDeletion, ikey.type);
+    state.append("DeleteRange(");
+    state.append(ikey.user_key.ToString());
+    state.append(", ");
+    state.append(iter->value().ToString());
+    state.append(")@");
+    state.append(NumberToString(ikey.sequence));
+    count++;
+  }
+  delete iter;
   if (!s.ok()) {
     state.append("ParseError()");
   } else if (count != WriteBatchInternal::Count(b)) {
@@ -74,6 +88,39 @@ TEST(WriteBatchTest, Multiple) {
             PrintContents(&batch));
 }
 
+TEST(WriteBatchTest, DeleteRange) {
+  WriteBatch batch;
+  batch.Put(Slice("c"), Slice("old"));
+  batch.DeleteRange(Slice("a"), Slice("d"));
+  batch.Put(Slice("b"), Slice("new"));
+  batch.DeleteRange(Slice("x"), Slice("z"));
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(4, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ("Put(b, new)@102"
+            "Put(c, old)@100"
+            "DeleteRange(a, d)@101"
+            "DeleteRange(x, z)@103",
+            PrintContents(&batch));
+
+  InternalKeyComparator cmp(BytewiseComparator());
+  MemTable* mem = new MemTable(cmp);
+  mem->Ref();
+  ASSERT_OK(WriteBatchInternal::InsertInto(&batch, mem));
+  std::string value;
+  Status s;
+  ASSERT_TRUE(mem->Get(LookupKey("c", 200), &value, &s));
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_TRUE(mem->Get(LookupKey("c", 100), &value, &s));
+  ASSERT_EQ("old", value);
+  ASSERT_TRUE(mem->Get(LookupKey("b", 200), &value, &s));
+  ASSERT_EQ("new", value);
+  s = Status::OK();
+  ASSERT_TRUE(mem->Get(LookupKey("a", 200), &value, &s));  // Older tables
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_TRUE(!mem->Get(LookupKey("d", 200), &value, &s));
+  mem->Unref();
+}
+
 TEST(WriteBatchTest, Corruption) {
   WriteBatch batch;
   batch.Put(Slice("foo"), Slice("bar"));
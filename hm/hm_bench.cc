@@ -0,0 +1,247 @@
+//////
+//Module function: micro-benchmark of the zone manager alone
+//////
+//
+//Drives HMManager directly, without the LSM tree, so that changes to the
+//zone metadata show up on their own. All zones of the device are reset
+//when it starts.
+//
+//Usage: hm_bench [--benchmarks=write,churn,...] [--num=N] ...
+//  write      write --num tables, level i%--levels+1 for the i-th
+//  churn      write a table and delete a random live one, --num times
+//  lookup     look up --num random live tables
+//  move_file  move --num random live tables one level down
+//  move_zone  move the zones of --num random live tables one level down
+//  window     update the compaction window of every level and list its
+//             tables, --num times
+//  delete     delete --num random live tables
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+#include "../hm/get_manager.h"
+#include "../hm/hm_manager.h"
+#include "../util/random.h"
+
+namespace leveldb{
+
+    static const char* FLAGS_benchmarks="write,lookup,window,churn,move_file,move_zone,delete";
+    static int FLAGS_num=2000;
+    static int FLAGS_levels=4;                //levels the write benchmark spreads tables over
+    static int FLAGS_table_size_kb=2048;      //largest table
+    static int FLAGS_table_size_min_kb=2048;  //smallest table; sizes are uniform in between
+    static int FLAGS_bg_rate_limit_mb=0;      //0 means unlimited
+
+    static uint64_t get_now_micros(){
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+    static uint64_t get_cpu_micros(){
+        struct rusage ru;
+        getrusage(RUSAGE_SELF,&ru);
+        return (ru.ru_utime.tv_sec+ru.ru_stime.tv_sec)*1000000+ru.ru_utime.tv_usec+ru.ru_stime.tv_usec;
+    }
+
+    class HMBench {
+    public:
+        HMBench()
+            :hm_manager_(Singleton::Gethmmanager()),rand_(301),next_table_(1),buf_(NULL) {
+            buf_=(char *)malloc(FLAGS_table_size_kb*1024ULL);
+            memset(buf_,'x',FLAGS_table_size_kb*1024ULL);
+            hm_manager_->set_bg_rate_limit(FLAGS_bg_rate_limit_mb*1048576ULL);
+        }
+
+        ~HMBench(){
+            free(buf_);
+        }
+
+        void run(){
+            std::string list=FLAGS_benchmarks;
+            size_t pos=0;
+            printf("%-10s %10s %10s %12s %10s %9s %7s %7s %7s %7s\n","benchmark","ops","secs","ops/s","cpu_us/op",\
+                "MB/s","zones","free","max","freed");
+            while(pos<=list.size()){
+                size_t sep=list.find(',',pos);
+                if(sep==std::string::npos){
+                    sep=list.size();
+                }
+                std::string name=list.substr(pos,sep-pos);
+                pos=sep+1;
+                if(name.empty()){
+                    continue;
+                }
+                run_one(name);
+            }
+        }
+
+    private:
+        HMManager* hm_manager_;
+        Random rand_;
+        uint64_t next_table_;
+        std::vector<uint64_t> live_;   //tables written and not deleted
+        char* buf_;
+
+        uint64_t table_size(){
+            uint64_t min=FLAGS_table_size_min_kb*1024ULL;
+            uint64_t max=FLAGS_table_size_kb*1024ULL;
+            if(max<=min){
+                return max;
+            }
+            return min+rand_.Next()%(max-min+1);
+        }
+
+        //returns the bytes written, 0 on failure
+        uint64_t write_table(int level){
+            uint64_t size=table_size();
+            if(hm_manager_->hm_write(level,next_table_,buf_,size)<0){
+                return 0;
+            }
+            live_.push_back(next_table_++);
+            return size;
+        }
+
+        //removes and returns a random live table
+        uint64_t take_random_table(){
+            size_t i=rand_.Next()%live_.size();
+            uint64_t table=live_[i];
+            live_[i]=live_.back();
+            live_.pop_back();
+            return table;
+        }
+
+        uint64_t pick_random_table(){
+            return live_[rand_.Next()%live_.size()];
+        }
+
+        void run_one(const std::string& name){
+            uint64_t ops=0;
+            uint64_t bytes=0;
+            uint64_t begin=get_now_micros();
+            uint64_t cpu_begin=get_cpu_micros();
+            int i;
+
+            if(name=="write"){
+                for(i=0;i<FLAGS_num;i++,ops++){
+                    uint64_t n=write_table(i%FLAGS_levels+1);
+                    if(n==0){
+                        break;
+                    }
+                    bytes += n;
+                }
+            }
+            else if(name=="churn"){
+                for(i=0;i<FLAGS_num;i++,ops++){
+                    uint64_t n=write_table(rand_.Next()%FLAGS_levels+1);
+                    if(n==0){
+                        break;
+                    }
+                    bytes += n;
+                    hm_manager_->hm_delete(take_random_table());
+                }
+            }
+            else if(name=="lookup"){
+                for(i=0;i<FLAGS_num && !live_.empty();i++,ops++){
+                    if(hm_manager_->get_one_table(pick_random_table())==NULL){
+                        printf("error:lookup lost a table!\n");
+                        break;
+                    }
+                }
+            }
+            else if(name=="move_file"){
+                for(i=0;i<FLAGS_num && !live_.empty();i++,ops++){
+                    uint64_t table=pick_random_table();
+                    struct Ldbfile* ldb=hm_manager_->get_one_table(table);
+                    if(ldb==NULL || ldb->level+1>=config::kNumLevels){
+                        continue;
+                    }
+                    uint64_t size=ldb->size;
+                    if(hm_manager_->move_file(table,ldb->level+1)<0){
+                        break;
+                    }
+                    bytes += size;
+                }
+            }
+            else if(name=="move_zone"){
+                for(i=0;i<FLAGS_num && !live_.empty();i++,ops++){
+                    uint64_t table=pick_random_table();
+                    struct Ldbfile* ldb=hm_manager_->get_one_table(table);
+                    if(ldb==NULL || ldb->level+1>=config::kNumLevels){
+                        continue;
+                    }
+                    hm_manager_->move_zone(table);
+                }
+            }
+            else if(name=="window"){
+                std::vector<struct Ldbfile*> window_table;
+                for(i=0;i<FLAGS_num;i++){
+                    for(int level=1;level<config::kNumLevels;level++,ops++){
+                        hm_manager_->update_com_window(level);
+                        window_table.clear();
+                        hm_manager_->get_com_window_table(level,&window_table);
+                    }
+                }
+            }
+            else if(name=="delete"){
+                for(i=0;i<FLAGS_num && !live_.empty();i++,ops++){
+                    hm_manager_->hm_delete(take_random_table());
+                }
+            }
+            else{
+                printf("unknown benchmark '%s'\n",name.c_str());
+                return;
+            }
+
+            uint64_t micros=get_now_micros()-begin;
+            uint64_t cpu=get_cpu_micros()-cpu_begin;
+            struct HMSpaceStats space;
+            hm_manager_->get_space_stats(&space);
+            printf("%-10s %10ld %10.3f %12.1f %10.2f %9.1f %7ld %7ld %7ld %7ld\n",name.c_str(),ops,micros*1e-6,\
+                micros ? ops*1e6/micros : 0.0,ops ? 1.0*cpu/ops : 0.0,micros ? bytes/1048576.0/(micros*1e-6) : 0.0,\
+                space.used_zones,space.free_zones,space.max_used_zones,space.freed_zones);
+            fflush(stdout);
+        }
+    };
+
+}
+
+int main(int argc,char** argv){
+    for(int i=1;i<argc;i++){
+        int n;
+        char junk;
+        if(strncmp(argv[i],"--benchmarks=",13)==0){
+            leveldb::FLAGS_benchmarks=argv[i]+13;
+        }
+        else if(sscanf(argv[i],"--num=%d%c",&n,&junk)==1 && n>=0){
+            leveldb::FLAGS_num=n;
+        }
+        else if(sscanf(argv[i],"--levels=%d%c",&n,&junk)==1 && n>0 && n<leveldb::config::kNumLevels){
+            leveldb::FLAGS_levels=n;
+        }
+        else if(sscanf(argv[i],"--table_size_kb=%d%c",&n,&junk)==1 && n>0){
+            leveldb::FLAGS_table_size_kb=n;
+        }
+        else if(sscanf(argv[i],"--table_size_min_kb=%d%c",&n,&junk)==1 && n>0){
+            leveldb::FLAGS_table_size_min_kb=n;
+        }
+        else if(sscanf(argv[i],"--bg_rate_limit_mb=%d%c",&n,&junk)==1 && n>=0){
+            leveldb::FLAGS_bg_rate_limit_mb=n;
+        }
+        else{
+            fprintf(stderr,"Invalid flag '%s'\n",argv[i]);
+            return 1;
+        }
+    }
+    if(leveldb::FLAGS_table_size_min_kb>leveldb::FLAGS_table_size_kb){
+        leveldb::FLAGS_table_size_min_kb=leveldb::FLAGS_table_size_kb;
+    }
+    leveldb::HMBench bench;
+    bench.run();
+    return 0;
+}
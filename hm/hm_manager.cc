@@ -1,8 +1,12 @@
 #include <cstdint>
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/time.h>
 
 #include "../hm/hm_manager.h"
+#include "../hm/tracer.h"
+#include "../util/mutexlock.h"
+#include "../util/perf_context_imp.h"
 
 
 namespace leveldb{
@@ -17,7 +21,7 @@ namespace leveldb{
     }
 
     HMManager::HMManager(const Comparator *icmp)
-        :icmp_(icmp) {
+        :icmp_(icmp),vlog_open_(NULL),clean_blocked_(false),rate_limiter_(BG_RATE_LIMIT) {
         ssize_t ret;
 
         //ret = zbc_open(smr_filename, O_RDWR, &dev_);  //Open device without O_DIRECT
@@ -36,21 +40,31 @@ namespace leveldb{
         }
 
         bitmap_ = new BitMap(zonenum_);
+        smr_model_.init(zone_,zonenum_);
         first_zonenum_ = set_first_zonenum();
 
         init_log_file();
         MyLog("\n  !!geardb!!  \n");
         MyLog("COM_WINDOW_SEQ:%d Verify_Table:%d Read_Whole_Table:%d Find_Table_Old:%d\n",COM_WINDOW_SEQ,Verify_Table,Read_Whole_Table,Find_Table_Old);
+        rate_limiter_.set_auto_tune(BG_RATE_AUTO_TUNE);
         MyLog("the first_zonenum_:%d zone_num:%ld\n",first_zonenum_,zonenum_);
         //////statistics
+        zone_num_=0;
         delete_zone_num=0;
         all_table_size=0;
         kv_store_sector=0;
         kv_read_sector=0;
         max_zone_num=0;
         move_file_size=0;
+        log_store_sector=0;
+        clean_zone_num=0;
+        clean_file_size=0;
         read_time=0;
         write_time=0;
+        vlog_zone_num_=0;
+        vlog_live_size=0;
+        vlog_store_sector=0;
+        vlog_free_zone_num=0;
         //////end
     }
 
@@ -63,6 +77,16 @@ namespace leveldb{
             it=table_map_.erase(it);
         }
         table_map_.clear();
+        std::map<std::string, struct Logfile*>::iterator il=log_map_.begin();
+        while(il!=log_map_.end()){
+            delete il->second;
+            il=log_map_.erase(il);
+        }
+        std::map<uint64_t, struct Valuezone*>::iterator iv=vlog_map_.begin();
+        while(iv!=vlog_map_.end()){
+            delete iv->second;
+            iv=vlog_map_.erase(iv);
+        }
         int i;
         for(i=0;i<config::kNumLevels;i++){
             std::vector<struct Zonefile*>::iterator iz=zone_info_[i].begin();
@@ -95,6 +119,7 @@ namespace leveldb{
     }
 
     ssize_t HMManager::hm_alloc_zone(){
+        uint64_t alloc_begin=get_now_micros();
         ssize_t i;
         for(i=first_zonenum_;i<zonenum_;i++){  //Traverse from the first sequential write zone
             if(bitmap_->get(i)==0){
@@ -105,12 +130,14 @@ namespace leveldb{
                 if(zone->zbz_write_pointer != zone_[i].zbz_start){
                     MyLog("alloc error: zone:%ld wp:%ld\n",i,zone->zbz_write_pointer);
                     zbc_reset_zone(dev_,zone_[i].zbz_start,0);
+                    smr_model_.reset_zone(zone_[i].zbz_start);
                     if(zone) free(zone);
                     continue;
                 }
                 if(zone) free(zone);
                 bitmap_->set(i);
                 zone_[i].zbz_write_pointer=zone_[i].zbz_start;
+                latency_stats_.add(kLatencyZoneAlloc,get_now_micros()-alloc_begin);
                 return i;
             }
         }
@@ -120,21 +147,101 @@ namespace leveldb{
     
     void HMManager::hm_free_zone(uint64_t zone){
         ssize_t ret;
+        uint64_t reset_begin=get_now_micros();
         ret =zbc_reset_zone(dev_,zone_[zone].zbz_start,0);
+        smr_model_.reset_zone(zone_[zone].zbz_start);
+        latency_stats_.add(kLatencyZoneReset,get_now_micros()-reset_begin);
         if(ret!=0){
             MyLog("reset zone:%ld faild! error:%ld\n",zone,ret);
         }
         bitmap_->clr(zone);
         zone_[zone].zbz_write_pointer=zone_[zone].zbz_start;
+        clean_blocked_=false;
+    }
+
+    void HMManager::hm_release_zone(int level,std::vector<struct Zonefile*>::iterator iz){
+        struct Zonefile* zf=(*iz);
+        uint64_t zone_id=zf->zone;
+        zone_info_[level].erase(iz);
+        if(is_com_window(level,zone_id)){
+            std::vector<struct Zonefile*>::iterator ic=com_window_[level].begin();
+            for(;ic!=com_window_[level].end();ic++){
+                if((*ic)->zone==zone_id){
+                    com_window_[level].erase(ic);
+                    break;
+                }
+            }
+        }
+        delete zf;
+        zone_num_--;
+        hm_free_zone(zone_id);
+        trace_event(kTraceZoneFree,level,zone_id);
+        MyLog("delete zone:%ld from level-%d\n",zone_id,level);
+        delete_zone_num++;
+    }
+
+    ssize_t HMManager::zone_pread(IOClass io_class,void *buf,uint64_t sector_count,uint64_t sector_ofst){
+        io_scheduler_.count_op(io_class);
+        if(io_class<=kIOLog){   //foreground reads are small and never wait for each other
+            io_scheduler_.begin_io(io_class);
+            ssize_t ret=zbc_pread(dev_, buf, sector_count, sector_ofst);
+            smr_model_.read(io_class,sector_ofst,sector_count);
+            io_scheduler_.end_io(io_class);
+            return ret;
+        }
+        uint64_t slice=IO_SLICE_SIZE/512;
+        uint64_t done=0;
+        while(done<sector_count){
+            uint64_t n=(sector_count-done < slice) ? sector_count-done : slice;
+            if(io_class>=kIOCompaction){
+                rate_limiter_.request(n*512);
+            }
+            io_scheduler_.begin_io(io_class);
+            ssize_t ret=zbc_pread(dev_, ((char *)buf)+done*512, n, sector_ofst+done);
+            smr_model_.read(io_class,sector_ofst+done,n);
+            io_scheduler_.end_io(io_class);
+            if(ret<=0){
+                return ret;
+            }
+            done += ret;
+        }
+        return done;
+    }
+
+    ssize_t HMManager::zone_pwrite(IOClass io_class,const void *buf,uint64_t sector_count,uint64_t sector_ofst){
+        io_scheduler_.count_op(io_class);
+        uint64_t slice=IO_SLICE_SIZE/512;
+        uint64_t done=0;
+        while(done<sector_count){     //slices go to the write pointer in order, so the zone stays sequential
+            uint64_t n=(sector_count-done < slice) ? sector_count-done : slice;
+            if(io_class>=kIOCompaction){
+                rate_limiter_.request(n*512);
+            }
+            io_scheduler_.begin_io(io_class);
+            ssize_t ret=zbc_pwrite(dev_, ((const char *)buf)+done*512, n, sector_ofst+done);
+            smr_model_.write(io_class,sector_ofst+done,n);
+            io_scheduler_.end_io(io_class);
+            if(ret<=0){
+                return ret;
+            }
+            done += ret;
+        }
+        return done;
     }
 
     ssize_t HMManager::hm_alloc(int level,uint64_t size){
         uint64_t need_size=(size%PHYSICAL_BLOCK_SIZE)? (size/PHYSICAL_BLOCK_SIZE+1)*(PHYSICAL_BLOCK_SIZE/512) :size/512;
         uint64_t write_zone=0;
+        MutexLock l(&meta_mutex_);
         if(zone_info_[level].empty()){
             write_zone=hm_alloc_zone();
+            if(write_zone==(uint64_t)-1){
+                return -1;
+            }
             struct Zonefile* zf=new Zonefile(write_zone);
             zone_info_[level].push_back(zf);
+            zone_num_++;
+            trace_event(kTraceZoneAlloc,level,write_zone);
 
             if(get_zone_num()>max_zone_num){
                 max_zone_num=get_zone_num();
@@ -145,8 +252,13 @@ namespace leveldb{
         write_zone=zone_info_[level][zone_info_[level].size()-1]->zone;
         if((zone_[write_zone].zbz_length-(zone_[write_zone].zbz_write_pointer-zone_[write_zone].zbz_start))<need_size) {//The current written zone can't write
             write_zone=hm_alloc_zone();
+            if(write_zone==(uint64_t)-1){   //keep writing nothing rather than a zone that doesn't exist
+                return -1;
+            }
             struct Zonefile* zf=new Zonefile(write_zone);
             zone_info_[level].push_back(zf);
+            zone_num_++;
+            trace_event(kTraceZoneAlloc,level,write_zone);
             if(get_zone_num()>max_zone_num){
                 max_zone_num=get_zone_num();
             }
@@ -154,9 +266,13 @@ namespace leveldb{
         return 1;
     }
 
-    ssize_t HMManager::hm_write(int level,uint64_t filenum,const void *buf,uint64_t count){
+    ssize_t HMManager::hm_write(int level,uint64_t filenum,const void *buf,uint64_t count,IOClass io_class){
         
-        hm_alloc(level,count);
+        if(hm_alloc(level,count)<0){
+            printf("error:no free zone for table:%ld\n",filenum);
+            errno=ENOSPC;
+            return -1;
+        }
         void *w_buf=NULL;
         uint64_t write_zone=zone_info_[level][zone_info_[level].size()-1]->zone;
         uint64_t sector_count;
@@ -166,7 +282,7 @@ namespace leveldb{
         uint64_t write_time_begin=get_now_micros();
         if(count%PHYSICAL_BLOCK_SIZE==0){
             sector_count=count/512;
-            ret=zbc_pwrite(dev_, buf, sector_count, sector_ofst);
+            ret=zone_pwrite(io_class, buf, sector_count, sector_ofst);
         }
         else{
             sector_count=(count/PHYSICAL_BLOCK_SIZE+1)*(PHYSICAL_BLOCK_SIZE/512);  //Align with physical block
@@ -178,29 +294,35 @@ namespace leveldb{
             }
             memset(w_buf,0,sector_count*512);
             memcpy(w_buf,buf,count);
-            ret=zbc_pwrite(dev_, w_buf, sector_count, sector_ofst);
+            ret=zone_pwrite(io_class, w_buf, sector_count, sector_ofst);
             free(w_buf);
         }
         if(ret<=0){
             printf("error:%ld hm_write falid! table:%ld\n",ret,filenum);
+            errno=EIO;
             return -1;
         }
         uint64_t write_time_end=get_now_micros();
         write_time += (write_time_end-write_time_begin);
+        latency_stats_.add(kLatencyHmWrite,write_time_end-write_time_begin);
 
         zone_[write_zone].zbz_write_pointer +=sector_count;
         struct Ldbfile *ldb= new Ldbfile(filenum,write_zone,sector_ofst,count,level);
-        table_map_.insert(std::pair<uint64_t, struct Ldbfile*>(filenum,ldb));
-        zone_info_[level][zone_info_[level].size()-1]->add_table(ldb);
+        {
+            MutexLock l(&meta_mutex_);
+            table_map_.insert(std::pair<uint64_t, struct Ldbfile*>(filenum,ldb));
+            zone_info_[level][zone_info_[level].size()-1]->add_table(ldb);
+        }
         all_table_size += ldb->size;
         kv_store_sector += sector_count;
+        trace_event(kTraceTableWrite,level,filenum,write_zone,sector_ofst,count);
 
         MyLog("write table:%ld to level-%d zone:%ld of size:%ld bytes ofst:%ld sect:%ld next:%ld\n",filenum,level,write_zone,count,sector_ofst,sector_count,sector_ofst+sector_count);
         
         return ret*512;
     }
 
-    ssize_t HMManager::hm_read(uint64_t filenum,void *buf,uint64_t count, uint64_t offset){
+    ssize_t HMManager::hm_read(uint64_t filenum,void *buf,uint64_t count, uint64_t offset,IOClass io_class){
         void *r_buf=NULL;
         uint64_t sector_count;
         uint64_t sector_ofst;
@@ -227,7 +349,7 @@ namespace leveldb{
             return -1;
         }
         memset(r_buf,0,sector_count*512);
-        ret=zbc_pread(dev_, r_buf, sector_count,sector_ofst);
+        ret=zone_pread(io_class, r_buf, sector_count,sector_ofst);
         memcpy(buf,((char *)r_buf)+de_ofst,count);
         free(r_buf);
         if(ret<=0){
@@ -237,12 +359,18 @@ namespace leveldb{
         
         uint64_t read_time_end=get_now_micros();
         read_time +=(read_time_end-read_time_begin);
+        latency_stats_.add(kLatencyHmRead,read_time_end-read_time_begin);
         kv_read_sector += sector_count;
+        PERF_COUNTER_ADD(device_reads,1);
+        PERF_COUNTER_ADD(device_read_bytes,sector_count*512);
+        PERF_COUNTER_ADD(io_wait_micros,read_time_end-read_time_begin);
+        perf::RecordZone(it->second->zone);
         //MyLog("read table:%ld of size:%ld bytes file:%ld bytes\n",filenum,count,it->second->size);
         return count;
     }
 
     ssize_t HMManager::hm_delete(uint64_t filenum){
+        MutexLock l(&meta_mutex_);
         std::map<uint64_t, struct Ldbfile*>::iterator it;
         it=table_map_.find(filenum);
         if(it!=table_map_.end()){
@@ -255,27 +383,13 @@ namespace leveldb{
                 if(zone_id==(*iz)->zone){
                     (*iz)->delete_table(ldb);
                     if((*iz)->ldb.empty() && (zone_[zone_id].zbz_write_pointer-zone_[zone_id].zbz_start) > 128*2048){
-                        struct Zonefile* zf=(*iz);
-                        zone_info_[level].erase(iz);
-                        if(is_com_window(level,zone_id)){
-                            std::vector<struct Zonefile*>::iterator ic=com_window_[level].begin();
-                            for(;ic!=com_window_[level].end();ic++){
-                                if((*ic)->zone==zone_id){
-                                    com_window_[level].erase(ic);
-                                    break;
-                                }
-                            }
-                        }
-                        delete zf;
-                        hm_free_zone(zone_id);
-                        MyLog("delete zone:%ld from level-%d\n",zone_id,level);
-                        delete_zone_num++;
-                        
+                        hm_release_zone(level,iz);
                     }
                     break;
                 }
             }
             MyLog("delete table:%ld from level-%d zone:%ld of size:%ld MB\n",filenum,level,zone_id,ldb->size/1048576);
+            trace_event(kTraceTableDelete,level,filenum,zone_id,0,ldb->size);
             all_table_size -= ldb->size;
             delete ldb;
         }
@@ -305,25 +419,34 @@ namespace leveldb{
             return -1;
         }
         memset(r_buf,0,sector_count*512);
-        ret=zbc_pread(dev_, r_buf, sector_count,sector_ofst);
+        ret=zone_pread(kIORelocation, r_buf, sector_count,sector_ofst);
         if(ret<=0){
             printf("error:%ld z_read falid!\n",ret);
+            free(r_buf);
+            errno=EIO;
             return -1;
         }
         uint64_t read_time_end=get_now_micros();
         read_time +=(read_time_end-read_time_begin);
 
+        if(hm_alloc(to_level,file_size)<0){   //the table stays where it is
+            printf("error:move file failed! no free zone for file:%ld\n",filenum);
+            free(r_buf);
+            errno=ENOSPC;
+            return -1;
+        }
         hm_delete(filenum);
         kv_read_sector += sector_count;
 
         uint64_t write_time_begin=get_now_micros();
 
-        hm_alloc(to_level,file_size);
         uint64_t write_zone=zone_info_[to_level][zone_info_[to_level].size()-1]->zone;
         sector_ofst=zone_[write_zone].zbz_write_pointer;
-        ret=zbc_pwrite(dev_, r_buf, sector_count, sector_ofst);
+        ret=zone_pwrite(kIORelocation, r_buf, sector_count, sector_ofst);
         if(ret<=0){
             printf("error:%ld zbc_pwrite falid!\n",ret);
+            free(r_buf);
+            errno=EIO;
             return -1;
         }
         uint64_t write_time_end=get_now_micros();
@@ -331,18 +454,444 @@ namespace leveldb{
 
         zone_[write_zone].zbz_write_pointer +=sector_count;
         ldb= new Ldbfile(filenum,write_zone,sector_ofst,file_size,to_level);
-        table_map_.insert(std::pair<uint64_t, struct Ldbfile*>(filenum,ldb));
-        zone_info_[to_level][zone_info_[to_level].size()-1]->add_table(ldb);
+        {
+            MutexLock l(&meta_mutex_);
+            table_map_.insert(std::pair<uint64_t, struct Ldbfile*>(filenum,ldb));
+            zone_info_[to_level][zone_info_[to_level].size()-1]->add_table(ldb);
+        }
         
         free(r_buf);
         kv_store_sector += sector_count;
         move_file_size += file_size;
+        trace_event(kTraceTableMove,to_level,filenum,write_zone,old_level,file_size);
         all_table_size += file_size;
 
         MyLog("move table:%ld from level-%d to level-%d zone:%ld of size:%ld MB\n",filenum,old_level,to_level,write_zone,file_size/1048576);
         return 1;
     }
 
+    //////capacity relation
+    uint64_t HMManager::get_free_zone_num(){
+        uint64_t used=get_zone_num()+vlog_zone_num_;
+        uint64_t all=zonenum_-first_zonenum_;
+        return (all>used) ? all-used : 0;
+    }
+
+    struct Zonefile* HMManager::pick_clean_zone(int *level){
+        struct Zonefile* best=NULL;
+        double best_percent=ZONE_CLEAN_VALID;
+        int i;
+        for(i=0;i<config::kNumLevels;i++){
+            if(zone_info_[i].size()<2){
+                continue;
+            }
+            std::vector<struct Zonefile*>::iterator it;
+            for(it=zone_info_[i].begin();it!=zone_info_[i].end()-1;it++){  //the last zone is still being written
+                uint64_t zone_id=(*it)->zone;
+                if(is_com_window(i,zone_id)){   //compaction reclaims these anyway
+                    continue;
+                }
+                double percent=100.0*(*it)->get_all_file_size()/(zone_[zone_id].zbz_length*512.0);
+                if(percent<best_percent){
+                    best_percent=percent;
+                    best=(*it);
+                    *level=i;
+                }
+            }
+        }
+        return best;
+    }
+
+    bool HMManager::need_zone_clean(){
+        if(!is_out_of_space() || clean_blocked_){
+            return false;
+        }
+        MutexLock l(&meta_mutex_);   //writer threads ask too, while the background thread changes zone_info_
+        int level;
+        return pick_clean_zone(&level)!=NULL;
+    }
+
+    int HMManager::clean_zones(int max_zones){
+        int cleaned=0;
+        int level;
+        struct Zonefile* zf;
+        while(cleaned<max_zones && (zf=pick_clean_zone(&level))!=NULL){
+            uint64_t zone_id=zf->zone;
+            uint64_t valid_size=zf->get_all_file_size();
+            std::vector<uint64_t> tables;
+            std::vector<struct Ldbfile*>::iterator it;
+            for(it=zf->ldb.begin();it!=zf->ldb.end();it++){
+                tables.push_back((*it)->table);
+            }
+            size_t i;
+            for(i=0;i<tables.size();i++){
+                if(move_file(tables[i],level)<0){   //appended to the level's last zone
+                    clean_blocked_=true;
+                    MyLog("clean zone:%ld of level-%d stopped at table:%ld\n",zone_id,level,tables[i]);
+                    return cleaned;
+                }
+            }
+            //hm_delete leaves zones written less than 64MB alone; this one is known to be finished
+            MutexLock l(&meta_mutex_);
+            std::vector<struct Zonefile*>::iterator iz;
+            for(iz=zone_info_[level].begin();iz!=zone_info_[level].end();iz++){
+                if((*iz)->zone==zone_id){
+                    if((*iz)->ldb.empty()){
+                        hm_release_zone(level,iz);
+                    }
+                    break;
+                }
+            }
+            MyLog("clean zone:%ld of level-%d moved:%ld tables %ld MB free_zone:%ld\n",zone_id,level,tables.size(),valid_size/1048576,get_free_zone_num());
+            clean_zone_num++;
+            clean_file_size += valid_size;
+            cleaned++;
+        }
+        return cleaned;
+    }
+
+    //////log file relation
+    ssize_t HMManager::log_alloc_zone(){
+        MutexLock l(&meta_mutex_);   //the bitmap is shared with hm_alloc_zone
+        ssize_t i;
+        for(i=0;i<first_zonenum_;i++){  //Conventional zones come before the first sequential write zone
+            if(bitmap_->get(i)==0){
+                bitmap_->set(i);
+                return i;
+            }
+        }
+        printf("log_alloc_zone failed!\n");
+        return -1;
+    }
+
+    void HMManager::log_free_zones(struct Logfile* lf,size_t keep){
+        MutexLock l(&meta_mutex_);
+        while(lf->zones.size()>keep){  //Conventional zones are overwritten in place, no reset needed
+            bitmap_->clr(lf->zones.back());
+            lf->zones.pop_back();
+        }
+    }
+
+    void HMManager::set_log_dbname(const std::string& dbname){
+        MutexLock l(&log_mutex_);
+        log_dbname_=dbname;
+    }
+
+    void HMManager::clear_log_dbname(const std::string& dbname){
+        MutexLock l(&log_mutex_);
+        if(log_dbname_==dbname){
+            log_dbname_.clear();
+        }
+    }
+
+    bool HMManager::is_log_dbname(const std::string& dir){
+        MutexLock l(&log_mutex_);
+        return !log_dbname_.empty() && dir==log_dbname_;
+    }
+
+    ssize_t HMManager::log_create(const std::string& fname){
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        it=log_map_.find(fname);
+        if(it!=log_map_.end()){
+            log_free_zones(it->second,0);
+            it->second->size=0;
+            return 1;
+        }
+        log_map_.insert(std::pair<std::string, struct Logfile*>(fname,new Logfile(fname)));
+        MyLog("create log file:%s\n",fname.c_str());
+        return 1;
+    }
+
+    ssize_t HMManager::log_write(const std::string& fname,uint64_t offset,const void *buf,uint64_t count,uint64_t file_size){
+        //offset and count are multiples of PHYSICAL_BLOCK_SIZE and buf is aligned for direct I/O
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        it=log_map_.find(fname);
+        if(it==log_map_.end()){
+            printf("error:no find log file:%s\n",fname.c_str());
+            errno=ENOENT;
+            return -1;
+        }
+        struct Logfile *lf=it->second;
+        uint64_t zone_bytes=zone_[0].zbz_length*512;
+        uint64_t done=0;
+        while(done<count){
+            uint64_t pos=offset+done;
+            size_t index=pos/zone_bytes;
+            while(lf->zones.size()<=index){
+                ssize_t zone=log_alloc_zone();
+                if(zone<0){
+                    errno=ENOSPC;
+                    return -1;
+                }
+                lf->zones.push_back(zone);
+            }
+            uint64_t in_zone=pos-index*zone_bytes;
+            uint64_t n=(count-done < zone_bytes-in_zone) ? count-done : zone_bytes-in_zone;
+            ssize_t ret=zone_pwrite(kIOLog,((const char *)buf)+done,n/512,zone_[lf->zones[index]].zbz_start+in_zone/512);
+            if(ret<=0){
+                printf("error:%ld log_write falid! file:%s\n",ret,fname.c_str());
+                errno=EIO;
+                return -1;
+            }
+            done += n;
+        }
+        if(file_size>lf->size){
+            lf->size=file_size;
+        }
+        log_store_sector += count/512;
+        return count;
+    }
+
+    ssize_t HMManager::log_read(const std::string& fname,uint64_t offset,void *buf,uint64_t count){
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        it=log_map_.find(fname);
+        if(it==log_map_.end()){
+            errno=ENOENT;
+            return -1;
+        }
+        struct Logfile *lf=it->second;
+        if(offset>=lf->size){
+            return 0;
+        }
+        if(count>lf->size-offset){
+            count=lf->size-offset;
+        }
+        uint64_t zone_bytes=zone_[0].zbz_length*512;
+        uint64_t done=0;
+        while(done<count){
+            uint64_t pos=offset+done;
+            size_t index=pos/zone_bytes;
+            uint64_t in_zone=pos-index*zone_bytes;
+            uint64_t n=(count-done < zone_bytes-in_zone) ? count-done : zone_bytes-in_zone;
+            uint64_t begin=(in_zone/LOGICAL_BLOCK_SIZE)*LOGICAL_BLOCK_SIZE;  //Align with logical block
+            uint64_t end=((in_zone+n+LOGICAL_BLOCK_SIZE-1)/LOGICAL_BLOCK_SIZE)*LOGICAL_BLOCK_SIZE;
+            void *r_buf=NULL;
+            ssize_t ret=posix_memalign(&r_buf,MEMALIGN_SIZE,end-begin);
+            if(ret!=0){
+                printf("error:%ld posix_memalign falid!\n",ret);
+                errno=ENOMEM;
+                return -1;
+            }
+            ret=zone_pread(kIOLog,r_buf,(end-begin)/512,zone_[lf->zones[index]].zbz_start+begin/512);
+            if(ret<=0){
+                printf("error:%ld log_read falid! file:%s\n",ret,fname.c_str());
+                free(r_buf);
+                errno=EIO;
+                return -1;
+            }
+            memcpy(((char *)buf)+done,((char *)r_buf)+(in_zone-begin),n);
+            free(r_buf);
+            done += n;
+        }
+        return count;
+    }
+
+    ssize_t HMManager::log_delete(const std::string& fname){
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        it=log_map_.find(fname);
+        if(it==log_map_.end()){
+            errno=ENOENT;
+            return -1;
+        }
+        log_free_zones(it->second,0);
+        delete it->second;
+        log_map_.erase(it);
+        MyLog("delete log file:%s\n",fname.c_str());
+        return 1;
+    }
+
+    ssize_t HMManager::log_rename(const std::string& src,const std::string& target){
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        it=log_map_.find(src);
+        if(it==log_map_.end()){
+            errno=ENOENT;
+            return -1;
+        }
+        struct Logfile *lf=it->second;
+        log_map_.erase(it);
+        it=log_map_.find(target);
+        if(it!=log_map_.end()){
+            log_free_zones(it->second,0);
+            delete it->second;
+            log_map_.erase(it);
+        }
+        lf->name=target;
+        log_map_.insert(std::pair<std::string, struct Logfile*>(target,lf));
+        return 1;
+    }
+
+    bool HMManager::log_exists(const std::string& fname){
+        MutexLock l(&log_mutex_);
+        return log_map_.find(fname)!=log_map_.end();
+    }
+
+    ssize_t HMManager::log_size(const std::string& fname,uint64_t *size){
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        it=log_map_.find(fname);
+        if(it==log_map_.end()){
+            *size=0;
+            errno=ENOENT;
+            return -1;
+        }
+        *size=it->second->size;
+        return 1;
+    }
+
+    void HMManager::log_children(const std::string& dir,std::vector<std::string> *names){
+        MutexLock l(&log_mutex_);
+        std::map<std::string, struct Logfile*>::iterator it;
+        for(it=log_map_.begin();it!=log_map_.end();it++){
+            size_t pos=it->first.find_last_of('/');
+            if(pos!=std::string::npos && it->first.compare(0,pos,dir)==0 && pos==dir.size()){
+                names->push_back(it->first.substr(pos+1));
+            }
+        }
+    }
+    //////
+
+    //////value log relation
+    void HMManager::vlog_free_zone(std::map<uint64_t, struct Valuezone*>::iterator iv){
+        uint64_t zone_id=iv->first;
+        delete iv->second;
+        vlog_map_.erase(iv);
+        {
+            MutexLock l(&meta_mutex_);
+            hm_free_zone(zone_id);
+        }
+        vlog_zone_num_--;
+        vlog_free_zone_num++;
+        MyLog("delete value log zone:%ld\n",zone_id);
+    }
+
+    ssize_t HMManager::vlog_write(const void *buf,uint64_t count,uint64_t *zone,uint64_t *offset,IOClass io_class){
+        uint64_t sector_count=(count%PHYSICAL_BLOCK_SIZE)? (count/PHYSICAL_BLOCK_SIZE+1)*(PHYSICAL_BLOCK_SIZE/512) :count/512;
+        MutexLock l(&vlog_mutex_);
+        if(vlog_open_==NULL || (zone_[vlog_open_->zone].zbz_length-(zone_[vlog_open_->zone].zbz_write_pointer-zone_[vlog_open_->zone].zbz_start))<sector_count){
+            if(sector_count>zone_[first_zonenum_].zbz_length){
+                printf("error:%ld bytes of values exceed a zone\n",count);
+                errno=EINVAL;
+                return -1;
+            }
+            ssize_t new_zone;
+            {
+                MutexLock ml(&meta_mutex_);
+                new_zone=hm_alloc_zone();
+            }
+            if(new_zone<0){
+                printf("error:no free zone for the value log\n");
+                errno=ENOSPC;
+                return -1;
+            }
+            struct Valuezone* old=vlog_open_;
+            vlog_open_=new Valuezone(new_zone);
+            vlog_map_.insert(std::pair<uint64_t, struct Valuezone*>(new_zone,vlog_open_));
+            vlog_zone_num_++;
+            if(old!=NULL && old->live==0){   //every value of the sealed zone died while it was open
+                vlog_free_zone(vlog_map_.find(old->zone));
+            }
+            MyLog("value log zone:%ld\n",new_zone);
+        }
+
+        uint64_t write_zone=vlog_open_->zone;
+        uint64_t sector_ofst=zone_[write_zone].zbz_write_pointer;
+        ssize_t ret;
+        uint64_t write_time_begin=get_now_micros();
+        if(count%PHYSICAL_BLOCK_SIZE==0){
+            ret=zone_pwrite(io_class, buf, sector_count, sector_ofst);
+        }
+        else{
+            void *w_buf=NULL;
+            ret=posix_memalign(&w_buf,MEMALIGN_SIZE,sector_count*512);
+            if(ret!=0){
+                printf("error:%ld posix_memalign falid!\n",ret);
+                return -1;
+            }
+            memset(w_buf,0,sector_count*512);
+            memcpy(w_buf,buf,count);
+            ret=zone_pwrite(io_class, w_buf, sector_count, sector_ofst);
+            free(w_buf);
+        }
+        if(ret<=0){
+            printf("error:%ld vlog_write falid! zone:%ld\n",ret,write_zone);
+            errno=EIO;
+            return -1;
+        }
+        uint64_t write_time_end=get_now_micros();
+        write_time += (write_time_end-write_time_begin);
+        latency_stats_.add(kLatencyHmWrite,write_time_end-write_time_begin);
+
+        zone_[write_zone].zbz_write_pointer +=sector_count;
+        vlog_open_->written += count;
+        vlog_open_->live += count;
+        vlog_live_size += count;
+        vlog_store_sector += sector_count;
+        *zone=write_zone;
+        *offset=(sector_ofst-zone_[write_zone].zbz_start)*512;
+        return count;
+    }
+
+    ssize_t HMManager::vlog_read(uint64_t zone,uint64_t offset,void *buf,uint64_t count,IOClass io_class){
+        if(zone>=zonenum_ || (int)zone<first_zonenum_){
+            printf("error:no value log zone:%ld\n",zone);
+            return -1;
+        }
+        uint64_t read_time_begin=get_now_micros();
+        uint64_t sector_ofst=zone_[zone].zbz_start+(offset/LOGICAL_BLOCK_SIZE)*(LOGICAL_BLOCK_SIZE/512);
+        uint64_t de_ofst=offset-(offset/LOGICAL_BLOCK_SIZE)*LOGICAL_BLOCK_SIZE;
+        uint64_t sector_count=((count+de_ofst)%LOGICAL_BLOCK_SIZE) ? ((count+de_ofst)/LOGICAL_BLOCK_SIZE+1)*(LOGICAL_BLOCK_SIZE/512) : ((count+de_ofst)/LOGICAL_BLOCK_SIZE)*(LOGICAL_BLOCK_SIZE/512);   //Align with logical block
+
+        void *r_buf=NULL;
+        ssize_t ret=posix_memalign(&r_buf,MEMALIGN_SIZE,sector_count*512);
+        if(ret!=0){
+            printf("error:%ld posix_memalign falid!\n",ret);
+            return -1;
+        }
+        ret=zone_pread(io_class, r_buf, sector_count, sector_ofst);
+        if(ret>0){
+            memcpy(buf,((char *)r_buf)+de_ofst,count);
+        }
+        free(r_buf);
+        if(ret<=0){
+            printf("error:%ld vlog_read falid!\n",ret);
+            return -1;
+        }
+
+        uint64_t read_time_end=get_now_micros();
+        read_time +=(read_time_end-read_time_begin);
+        latency_stats_.add(kLatencyHmRead,read_time_end-read_time_begin);
+        kv_read_sector += sector_count;
+        PERF_COUNTER_ADD(device_reads,1);
+        PERF_COUNTER_ADD(device_read_bytes,sector_count*512);
+        PERF_COUNTER_ADD(io_wait_micros,read_time_end-read_time_begin);
+        perf::RecordZone(zone);
+        return count;
+    }
+
+    void HMManager::vlog_release(uint64_t zone,uint64_t count){
+        MutexLock l(&vlog_mutex_);
+        std::map<uint64_t, struct Valuezone*>::iterator iv=vlog_map_.find(zone);
+        if(iv==vlog_map_.end()){
+            printf("error:no value log zone:%ld\n",zone);
+            return;
+        }
+        struct Valuezone* vz=iv->second;
+        if(count>vz->live){
+            count=vz->live;
+        }
+        vz->live -= count;
+        vlog_live_size -= count;
+        if(vz->live==0 && vz!=vlog_open_){   //whole-zone reclamation, nothing to copy
+            vlog_free_zone(iv);
+        }
+    }
+    //////
+
     struct Ldbfile* HMManager::get_one_table(uint64_t filenum){
         std::map<uint64_t, struct Ldbfile*>::iterator it;
         it=table_map_.find(filenum);
@@ -353,6 +902,29 @@ namespace leveldb{
         return it->second;
     }
 
+    bool HMManager::get_table_location(uint64_t filenum,uint64_t *zone,uint64_t *offset){
+        MutexLock l(&meta_mutex_);
+        std::map<uint64_t, struct Ldbfile*>::iterator it;
+        it=table_map_.find(filenum);
+        if(it==table_map_.end()){   //just moved or deleted, not an error here
+            return false;
+        }
+        *zone=it->second->zone;
+        *offset=it->second->offset;
+        return true;
+    }
+
+    bool HMManager::get_table_size(uint64_t filenum,uint64_t *size){
+        MutexLock l(&meta_mutex_);
+        std::map<uint64_t, struct Ldbfile*>::iterator it;
+        it=table_map_.find(filenum);
+        if(it==table_map_.end()){
+            return false;
+        }
+        *size=it->second->size;
+        return true;
+    }
+
     void HMManager::get_zone_table(uint64_t filenum,std::vector<struct Ldbfile*> **zone_table){
         std::map<uint64_t, struct Ldbfile*>::iterator it;
         it=table_map_.find(filenum);
@@ -382,13 +954,42 @@ namespace leveldb{
         }
 
         uint64_t zone_id=it->second->zone;
-        if((zone_[zone_id].zbz_length-(zone_[zone_id].zbz_write_pointer-zone_[zone_id].zbz_start)) < 64*2048){ //The remaining free space is less than 64MB, triggering
+        if((zone_[zone_id].zbz_length-(zone_[zone_id].zbz_write_pointer-zone_[zone_id].zbz_start)) < TRIVIAL_MOVE_ZONE_REMAIN/512){ //The remaining free space is small, triggering
             return true;
         }
         else return false;
     }
 
+    void HMManager::get_reclaim_share(int level,std::map<uint64_t,double> *share){
+        std::vector<struct Zonefile*>::iterator iz;
+        for(iz=zone_info_[level].begin();iz!=zone_info_[level].end();iz++){
+            uint64_t zone_id=(*iz)->zone;
+            if((zone_[zone_id].zbz_write_pointer-zone_[zone_id].zbz_start) <= 128*2048){ //hm_delete won't reset it when emptied
+                continue;
+            }
+            uint64_t valid=(*iz)->get_all_file_size();
+            std::vector<struct Ldbfile*>::iterator it;
+            for(it=(*iz)->ldb.begin();it!=(*iz)->ldb.end();it++){
+                (*share)[(*it)->table]=1.0*(*it)->size/valid;
+            }
+        }
+    }
+
+    uint64_t HMManager::get_level_zone_remaining(int level){
+        MutexLock l(&meta_mutex_);
+        return level_zone_remaining(level);
+    }
+
+    uint64_t HMManager::level_zone_remaining(int level){
+        if(zone_info_[level].empty()){
+            return 0;
+        }
+        uint64_t zone_id=zone_info_[level][zone_info_[level].size()-1]->zone;
+        return (zone_[zone_id].zbz_length-(zone_[zone_id].zbz_write_pointer-zone_[zone_id].zbz_start))*512;
+    }
+
     void HMManager::move_zone(uint64_t filenum){
+        MutexLock l(&meta_mutex_);
         std::map<uint64_t, struct Ldbfile*>::iterator it;
         it=table_map_.find(filenum);
         if(it==table_map_.end()){
@@ -430,6 +1031,7 @@ namespace leveldb{
         for(int i=0;i<zf->ldb.size();i++){
             zf->ldb[i]->level=level+1;
         }
+        trace_event(kTraceZoneMove,level+1,zone_id,level,zf->ldb.size());
 
         MyLog("move zone:%d table:[",zone_id);
         for(int i=0;i<zf->ldb.size();i++){
@@ -446,6 +1048,7 @@ namespace leveldb{
 
 
     void HMManager::update_com_window(int level){
+        MutexLock l(&meta_mutex_);
         ssize_t window_num=adjust_com_window_num(level);
         if(COM_WINDOW_SEQ) {
             set_com_window_seq(level,window_num);
@@ -453,7 +1056,7 @@ namespace leveldb{
         else{
             set_com_window(level,window_num);
         }
-        
+        trace_event(kTraceWindow,level,com_window_[level].size(),zone_info_[level].size());
     }
 
     ssize_t HMManager::adjust_com_window_num(int level){
@@ -549,12 +1152,7 @@ namespace leveldb{
 
     //////statistics
     uint64_t HMManager::get_zone_num(){
-        uint64_t num=0;
-        int i;
-        for(i=0;i<config::kNumLevels;i++){
-            num += zone_info_[i].size();
-        }
-        return num;
+        return zone_num_;
     }
 
     void HMManager::get_one_level(int level,uint64_t *table_num,uint64_t *table_size){
@@ -569,31 +1167,39 @@ namespace leveldb{
         *table_size = size;
     }
 
+    float HMManager::get_level_fill_percent(int level){
+        MutexLock l(&meta_mutex_);
+        return level_fill_percent(level);
+    }
+
+    float HMManager::level_fill_percent(int level){
+        uint64_t table_num=0;
+        uint64_t table_size=0;
+        get_one_level(level,&table_num,&table_size);
+        if(table_size == 0){
+            return 0;
+        }
+        int zone_num=zone_info_[level].size();
+        uint64_t zone_id=zone_info_[level][zone_num-1]->zone;
+        return 100.0*table_size/((zone_num-1)*256.0*1024*1024+(zone_[zone_id].zbz_write_pointer - zone_[zone_id].zbz_start)*512.0);
+    }
+
     void HMManager::get_per_level_info(){
         int i;
         uint64_t table_num=0;
         uint64_t table_size=0;
         float percent=0;
-        int zone_num=0;
-        uint64_t zone_id;
 
         for(i=0;i<config::kNumLevels;i++){
             get_one_level(i,&table_num,&table_size);
-            if(table_size == 0){
-                percent = 0;
-            }
-            else {
-                zone_num=zone_info_[i].size();
-                zone_id=zone_info_[i][zone_num-1]->zone;
-                percent=100.0*table_size/((zone_num-1)*256.0*1024*1024+(zone_[zone_id].zbz_write_pointer - zone_[zone_id].zbz_start)*512.0);
-            }
+            percent=get_level_fill_percent(i);
             MyLog("Level-%d zone_num:%d table_num:%ld table_size:%ld MB percent:%.2f %%\n",i,zone_info_[i].size(),table_num,table_size/1048576,percent);
         }
     }
 
     void HMManager::get_valid_info(){
         
-        MyLog("write_zone:%ld delete_zone_num:%ld max_zone_num:%ld table_num:%ld table_size:%ld MB\n",get_zone_num(),delete_zone_num,max_zone_num,table_map_.size(),all_table_size/1048576);
+        MyLog("write_zone:%ld delete_zone_num:%ld max_zone_num:%ld table_num:%ld table_size:%ld MB\n",get_zone_num(),delete_zone_num.load(),max_zone_num.load(),table_map_.size(),all_table_size/1048576);
         get_per_level_info();
         uint64_t table_num;
         uint64_t table_size;
@@ -624,11 +1230,210 @@ namespace leveldb{
             kv_read_sector/2048,kv_store_sector/2048,disk_size/2048);
         MyLog("read_time:%.1f s write_time:%.1f s read:%.1f MB/s write:%.1f MB/s\n",1.0*read_time*1e-6,1.0*write_time*1e-6,\
             (kv_read_sector/2048.0)/(read_time*1e-6),(kv_store_sector/2048.0)/(write_time*1e-6));
+        MyLog("log_file_num:%ld log_store_sector:%ld MB\n",log_map_.size(),log_store_sector/2048);
+        MyLog("free_zone:%ld reserve_zone:%d clean_zone_num:%ld clean_size:%ld MB\n",get_free_zone_num(),ZONE_RESERVE_NUM,clean_zone_num.load(),clean_file_size/1048576);
         get_valid_info();
+        get_io_info();
         MyLog("\n");
         
     }
 
+    void HMManager::get_io_info(){
+        struct IOClassStats stats;
+        for(int i=0;i<kNumIOClasses;i++){
+            get_io_stats((IOClass)i,&stats);
+            MyLog("io_class:%s ops:%ld slices:%ld wait:%.3f s avg_wait:%.1f us max_wait:%ld us\n",io_class_name((IOClass)i),\
+                stats.ops,stats.slices,stats.wait_micros*1e-6,stats.slices ? 1.0*stats.wait_micros/stats.slices : 0.0,stats.max_wait_micros);
+        }
+        MyLog("bg_rate_limit:%.1f MB/s auto_tune:%d limited:%ld MB throttled:%.3f s\n",rate_limiter_.get_effective_bytes_per_second()/1048576.0,\
+            rate_limiter_.get_auto_tune(),rate_limiter_.get_total_bytes()/1048576,rate_limiter_.get_throttled_micros()*1e-6);
+        if(smr_model_.enabled()){
+            struct SMRModelStats model;
+            smr_model_.get_stats(&model);
+            MyLog("smr_model device:%.3f s seek:%.3f s rotation:%.3f s transfer:%.3f s reset:%.3f s seeks:%ld resets:%ld wp_violations:%ld\n",\
+                model.device_micros*1e-6,model.seek_micros*1e-6,model.rotation_micros*1e-6,model.transfer_micros*1e-6,\
+                model.reset_micros*1e-6,model.seeks,model.resets,model.wp_violations);
+        }
+    }
+
+    void HMManager::reset_stats(){
+        latency_stats_.reset();
+        io_scheduler_.reset_stats();
+        smr_model_.reset_stats();
+    }
+
+    void HMManager::get_zone_stats(std::string *value){
+        char buf[256];
+        MutexLock l(&meta_mutex_);
+        snprintf(buf,sizeof(buf),"zones: %ld used, %ld free, %d reserve, %ld max used, %ld deleted, %ld cleaned\n",\
+            get_zone_num(),get_free_zone_num(),ZONE_RESERVE_NUM,max_zone_num.load(),delete_zone_num.load(),clean_zone_num.load());
+        value->append(buf);
+        snprintf(buf,sizeof(buf),"tables: %ld, %.1f MB; moved %.1f MB, cleaned %.1f MB\n",\
+            table_map_.size(),all_table_size/1048576.0,move_file_size/1048576.0,clean_file_size/1048576.0);
+        value->append(buf);
+        snprintf(buf,sizeof(buf),"read: %.1f MB in %.3f s; write: %.1f MB in %.3f s; log: %.1f MB\n",\
+            kv_read_sector/2048.0,read_time*1e-6,kv_store_sector/2048.0,write_time*1e-6,log_store_sector/2048.0);
+        value->append(buf);
+        if(vlog_store_sector>0){
+            snprintf(buf,sizeof(buf),"value log: %ld zones, %.1f MB live, %.1f MB written, %ld zones freed\n",\
+                vlog_zone_num_.load(),vlog_live_size/1048576.0,vlog_store_sector/2048.0,vlog_free_zone_num.load());
+            value->append(buf);
+        }
+        value->append("level  zones  tables  size(MB)  fill(%)  remain(MB)\n");
+        uint64_t table_num;
+        uint64_t table_size;
+        int i;
+        for(i=0;i<config::kNumLevels;i++){
+            get_one_level(i,&table_num,&table_size);
+            snprintf(buf,sizeof(buf),"%5d %6ld %7ld %9.1f %8.2f %11.1f\n",i,zone_info_[i].size(),table_num,\
+                table_size/1048576.0,level_fill_percent(i),level_zone_remaining(i)/1048576.0);
+            value->append(buf);
+        }
+        value->append("level  zone  tables  valid(MB)  valid(%)  written(MB)\n");
+        std::vector<struct Zonefile*>::iterator it;
+        for(i=0;i<config::kNumLevels;i++){
+            for(it=zone_info_[i].begin();it!=zone_info_[i].end();it++){
+                uint64_t zone_id=(*it)->zone;
+                table_size=(*it)->get_all_file_size();
+                snprintf(buf,sizeof(buf),"%5d %5ld %7ld %10.1f %9.2f %12.1f\n",i,zone_id,(*it)->ldb.size(),table_size/1048576.0,\
+                    100.0*table_size/(zone_[zone_id].zbz_length*512.0),(zone_[zone_id].zbz_write_pointer-zone_[zone_id].zbz_start)/2048.0);
+                value->append(buf);
+            }
+        }
+    }
+
+    void HMManager::get_space_stats(struct HMSpaceStats *stats){
+        MutexLock l(&meta_mutex_);
+        stats->zone_size=zone_[first_zonenum_].zbz_length*512;
+        stats->zone_capacity=zonenum_-first_zonenum_;
+        stats->used_zones=get_zone_num();
+        stats->free_zones=get_free_zone_num();
+        stats->max_used_zones=max_zone_num;
+        stats->freed_zones=delete_zone_num;
+        stats->live_bytes=all_table_size;
+        stats->store_sectors=kv_store_sector+vlog_store_sector;   //the value log counts toward write amplification
+        stats->move_bytes=move_file_size;
+        stats->clean_zones=clean_zone_num;
+        stats->vlog_zones=vlog_zone_num_;
+        stats->vlog_live_bytes=vlog_live_size;
+        stats->vlog_freed_zones=vlog_free_zone_num;
+        for(int i=0;i<config::kNumLevels;i++){
+            stats->level_zones[i]=zone_info_[i].size();
+        }
+    }
+
+    static const int kValidBuckets = 10;   //zone valid percent in steps of 10%
+
+    static int valid_bucket(uint64_t valid,uint64_t zone_sectors){
+        int b=(int)(valid*kValidBuckets/(zone_sectors*512));
+        return (b<kValidBuckets) ? b : kValidBuckets-1;
+    }
+
+    void HMManager::get_zone_valid_histogram(std::string *value){
+        char buf[64];
+        uint64_t count[config::kNumLevels][kValidBuckets];
+        memset(count,0,sizeof(count));
+        {
+            MutexLock l(&meta_mutex_);
+            std::vector<struct Zonefile*>::iterator it;
+            for(int i=0;i<config::kNumLevels;i++){
+                for(it=zone_info_[i].begin();it!=zone_info_[i].end();it++){
+                    count[i][valid_bucket((*it)->get_all_file_size(),zone_[(*it)->zone].zbz_length)]++;
+                }
+            }
+        }
+        value->append("valid(%)");
+        for(int i=0;i<config::kNumLevels;i++){
+            snprintf(buf,sizeof(buf),"   L%d",i);
+            value->append(buf);
+        }
+        value->append("    all\n");
+        for(int b=0;b<kValidBuckets;b++){
+            snprintf(buf,sizeof(buf),"%3d-%-4d",b*100/kValidBuckets,(b+1)*100/kValidBuckets);
+            value->append(buf);
+            uint64_t all=0;
+            for(int i=0;i<config::kNumLevels;i++){
+                snprintf(buf,sizeof(buf)," %4ld",count[i][b]);
+                value->append(buf);
+                all += count[i][b];
+            }
+            snprintf(buf,sizeof(buf)," %6ld\n",all);
+            value->append(buf);
+        }
+    }
+
+    void HMManager::get_window_stats(std::string *value){
+        char buf[128];
+        MutexLock l(&meta_mutex_);
+        value->append("level  zones  window_zones  window_tables  window_size(MB)\n");
+        for(int i=0;i<config::kNumLevels;i++){
+            uint64_t table_num=0;
+            uint64_t table_size=0;
+            std::vector<struct Zonefile*>::iterator it;
+            for(it=com_window_[i].begin();it!=com_window_[i].end();it++){
+                table_num += (*it)->ldb.size();
+                table_size += (*it)->get_all_file_size();
+            }
+            snprintf(buf,sizeof(buf),"%5d %6ld %13ld %14ld %16.1f\n",i,zone_info_[i].size(),com_window_[i].size(),\
+                table_num,table_size/1048576.0);
+            value->append(buf);
+        }
+    }
+
+    void HMManager::get_stats_json(std::string *value){
+        char buf[256];
+        MutexLock l(&meta_mutex_);
+        snprintf(buf,sizeof(buf),"{\"zones\":{\"total\":%ld,\"used\":%ld,\"free\":%ld,\"reserve\":%d,\"max_used\":%ld,\"deleted\":%ld,\"cleaned\":%ld},",\
+            (uint64_t)(zonenum_-first_zonenum_),get_zone_num(),get_free_zone_num(),ZONE_RESERVE_NUM,max_zone_num.load(),delete_zone_num.load(),clean_zone_num.load());
+        value->append(buf);
+        snprintf(buf,sizeof(buf),"\"tables\":{\"num\":%ld,\"bytes\":%ld,\"moved_bytes\":%ld,\"cleaned_bytes\":%ld},",\
+            table_map_.size(),all_table_size.load(),move_file_size.load(),clean_file_size.load());
+        value->append(buf);
+        snprintf(buf,sizeof(buf),"\"io\":{\"read_sectors\":%ld,\"read_micros\":%ld,\"write_sectors\":%ld,\"write_micros\":%ld,\"log_sectors\":%ld},",\
+            kv_read_sector.load(),read_time.load(),kv_store_sector.load(),write_time.load(),log_store_sector.load());
+        value->append(buf);
+
+        value->append("\"levels\":[");
+        uint64_t count[kValidBuckets];
+        memset(count,0,sizeof(count));
+        for(int i=0;i<config::kNumLevels;i++){
+            uint64_t table_num;
+            uint64_t table_size;
+            uint64_t window_tables=0;
+            uint64_t window_size=0;
+            std::vector<struct Zonefile*>::iterator it;
+            get_one_level(i,&table_num,&table_size);
+            for(it=com_window_[i].begin();it!=com_window_[i].end();it++){
+                window_tables += (*it)->ldb.size();
+                window_size += (*it)->get_all_file_size();
+            }
+            for(it=zone_info_[i].begin();it!=zone_info_[i].end();it++){
+                count[valid_bucket((*it)->get_all_file_size(),zone_[(*it)->zone].zbz_length)]++;
+            }
+            snprintf(buf,sizeof(buf),"%s{\"level\":%d,\"zones\":%ld,\"tables\":%ld,\"bytes\":%ld,\"fill_percent\":%.2f,\"zone_remaining\":%ld,",\
+                i ? "," : "",i,zone_info_[i].size(),table_num,table_size,level_fill_percent(i),level_zone_remaining(i));
+            value->append(buf);
+            snprintf(buf,sizeof(buf),"\"window_zones\":%ld,\"window_tables\":%ld,\"window_bytes\":%ld}",\
+                com_window_[i].size(),window_tables,window_size);
+            value->append(buf);
+        }
+        value->append("],\"valid_histogram\":[");
+        for(int b=0;b<kValidBuckets;b++){
+            snprintf(buf,sizeof(buf),"%s%ld",b ? "," : "",count[b]);
+            value->append(buf);
+        }
+
+        value->append("],\"io_classes\":{");
+        struct IOClassStats stats;
+        for(int i=0;i<kNumIOClasses;i++){
+            get_io_stats((IOClass)i,&stats);
+            snprintf(buf,sizeof(buf),"%s\"%s\":{\"ops\":%ld,\"slices\":%ld,\"wait_micros\":%ld,\"max_wait_micros\":%ld}",\
+                i ? "," : "",io_class_name((IOClass)i),stats.ops,stats.slices,stats.wait_micros,stats.max_wait_micros);
+            value->append(buf);
+        }
+        value->append("}}");
+    }
+
     void HMManager::get_valid_data(){
         
         MyLog2("level,zone_id,table_num,valid_size(MB),percent(%%)\n");
@@ -654,7 +1459,7 @@ namespace leveldb{
 
     void HMManager::get_my_info(int num){
         MyLog6("\nnum:%d table_size:%ld MB kv_read_sector:%ld MB kv_store_sector:%ld MB zone_num:%ld max_zone_num:%ld move_size:%ld MB\n",num,all_table_size/(1024*1024),\
-            kv_read_sector/2048,kv_store_sector/2048,get_zone_num(),max_zone_num,move_file_size/(1024*1024));
+            kv_read_sector/2048,kv_store_sector/2048,get_zone_num(),max_zone_num.load(),move_file_size/(1024*1024));
         MyLog6("read_time:%.1f s write_time:%.1f s read:%.1f MB/s write:%.1f MB/s\n",1.0*read_time*1e-6,1.0*write_time*1e-6,\
             (kv_read_sector/2048.0)/(read_time*1e-6),(kv_store_sector/2048.0)/(write_time*1e-6));
         get_valid_all_data(num);
@@ -668,24 +1473,16 @@ namespace leveldb{
             kv_read_sector/2048,kv_store_sector/2048,disk_size/2048);
         MyLog3("read_time:%.1f s write_time:%.1f s read:%.1f MB/s write:%.1f MB/s\n",1.0*read_time*1e-6,1.0*write_time*1e-6,\
             (kv_read_sector/2048.0)/(read_time*1e-6),(kv_store_sector/2048.0)/(write_time*1e-6));
-        MyLog3("write_zone:%ld delete_zone_num:%ld max_zone_num:%ld table_num:%ld table_size:%ld MB\n",get_zone_num(),delete_zone_num,max_zone_num,table_map_.size(),all_table_size/1048576);
+        MyLog3("write_zone:%ld delete_zone_num:%ld max_zone_num:%ld table_num:%ld table_size:%ld MB\n",get_zone_num(),delete_zone_num.load(),max_zone_num.load(),table_map_.size(),all_table_size/1048576);
         uint64_t table_num;
         uint64_t table_size;
-        int zone_num=0;
         uint64_t zone_id;
         float percent;
         std::vector<struct Zonefile*>::iterator it;
         int i;
         for(i=0;i<config::kNumLevels;i++){
             get_one_level(i,&table_num,&table_size);
-            if(table_size == 0){
-                percent = 0;
-            }
-            else {
-                zone_num=zone_info_[i].size();
-                zone_id=zone_info_[i][zone_num-1]->zone;
-                percent=100.0*table_size/((zone_num-1)*256.0*1024*1024+(zone_[zone_id].zbz_write_pointer - zone_[zone_id].zbz_start)*512.0);
-            }
+            percent=get_level_fill_percent(i);
             MyLog3("Level-%d zone_num:%d table_num:%ld table_size:%ld MB percent:%.2f %% \n",i,zone_info_[i].size(),table_num,table_size/1048576,percent);
         }
         MyLog3("level,zone_id,table_num,valid_size(MB),percent(%%)\n");
@@ -716,4 +1513,4 @@ namespace leveldb{
 
 
 
-}
\ No newline at end of file
+}
\ No newline at end of file
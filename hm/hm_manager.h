@@ -7,14 +7,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
 #include <cstring>
 #include <map>
+#include <string>
 #include <vector>  
 
 #include "../db/dbformat.h"
 #include "../hm/my_log.h"
 #include "../hm/BitMap.h"
 #include "../hm/hm_status.h"
+#include "../hm/io_scheduler.h"
+#include "../hm/latency_stats.h"
+#include "../hm/rate_limiter.h"
+#include "../hm/smr_model.h"
 
 
 extern "C" {
@@ -23,16 +29,35 @@ extern "C" {
 
 namespace leveldb{
 
+    struct HMSpaceStats {
+        uint64_t zone_size;             //bytes per sequential zone
+        uint64_t zone_capacity;         //sequential zones on the drive
+        uint64_t used_zones;            //zones held by the levels
+        uint64_t free_zones;
+        uint64_t max_used_zones;
+        uint64_t freed_zones;           //zones reset after their last table was deleted
+        uint64_t live_bytes;            //bytes of live SSTables
+        uint64_t store_sectors;         //SSTable and value log sectors written since start
+        uint64_t move_bytes;            //bytes copied by move_file
+        uint64_t clean_zones;           //zones freed by relocation
+        uint64_t vlog_zones;            //zones held by the value log
+        uint64_t vlog_live_bytes;       //bytes of values still pointed to by the tables
+        uint64_t vlog_freed_zones;      //value log zones reset once none of their values was live
+        uint64_t level_zones[config::kNumLevels];
+    };
+
     class HMManager {
     public:
         HMManager(const Comparator *icmp);
         ~HMManager();
         
-        ssize_t hm_write(int level,uint64_t filenum,const void *buf,uint64_t count);   //write a SSTable file to a level
-        ssize_t hm_read(uint64_t filenum,void *buf,uint64_t count, uint64_t offset);   //read a SSTable file
+        ssize_t hm_write(int level,uint64_t filenum,const void *buf,uint64_t count,IOClass io_class=kIOCompaction);   //write a SSTable file to a level
+        ssize_t hm_read(uint64_t filenum,void *buf,uint64_t count, uint64_t offset,IOClass io_class=kIOUserRead);   //read a SSTable file
         ssize_t hm_delete(uint64_t filenum);                                           //delete a SSTable file
         ssize_t move_file(uint64_t filenum,int to_level);                              //move a SSTable file
         struct Ldbfile* get_one_table(uint64_t filenum);                               //get a SSTable file pointer
+        bool get_table_location(uint64_t filenum,uint64_t *zone,uint64_t *offset);     //copy where a SSTable file lives, false if it is gone; safe from any thread
+        bool get_table_size(uint64_t filenum,uint64_t *size);                          //copy the size of a SSTable file, false if it is gone; safe from any thread
 
 
         void get_table(std::map<uint64_t, struct Ldbfile*> **table_map){ *table_map=&table_map_; };  //get table_map
@@ -40,6 +65,8 @@ namespace leveldb{
         //////dump relation
         void get_zone_table(uint64_t filenum,std::vector<struct Ldbfile*> **zone_table);
         bool trivial_zone_size_move(uint64_t filenum);
+        uint64_t get_level_zone_remaining(int level);   //free bytes in the zone the level is writing, 0 if it has none
+        void get_reclaim_share(int level,std::map<uint64_t,double> *share);   //<file number, share of its zone's live bytes>
         void move_zone(uint64_t filenum);
         //////
 
@@ -54,12 +81,70 @@ namespace leveldb{
         //////statistics
         uint64_t get_zone_num();
         void get_one_level(int level,uint64_t *table_num,uint64_t *table_size);
+        float get_level_fill_percent(int level);   //valid SSTable bytes / bytes written to the level's zones
         void get_per_level_info();
         void get_valid_info();
         void get_all_info();
         void get_valid_data();
         void get_my_info(int num);
         void get_valid_all_data(int num);
+        void get_io_stats(IOClass io_class,struct IOClassStats *stats){ io_scheduler_.get_stats(io_class,stats); };  //per-class queueing delay
+        void get_io_info();
+
+        //////latency, safe to call from any thread
+        void add_latency(LatencyType type,uint64_t micros){ latency_stats_.add(type,micros); };
+        void get_latency_stats(std::string *value){ latency_stats_.to_string(value); };
+        void get_latency_json(std::string *value){ latency_stats_.to_json(value); };
+        void reset_stats();   //latency histograms, I/O class queueing statistics and drive model time
+
+        //////statistics for DB::GetProperty; safe to call from any thread
+        void get_zone_stats(std::string *value);            //counters, per level and per zone
+        void get_zone_valid_histogram(std::string *value);  //zones by percent of live data, per level
+        void get_window_stats(std::string *value);          //compaction window of each level
+        void get_stats_json(std::string *value);            //all of the above as one JSON object
+        void get_space_stats(struct HMSpaceStats *stats);   //counters for periodic sampling
+
+        //////log file relation (conventional zones)
+        bool log_zone_enabled(){ return LOG_ON_CONV_ZONE && first_zonenum_>0; };
+        void set_log_dbname(const std::string& dbname);   //only this DB's WAL and MANIFEST go to the conventional zones
+        void clear_log_dbname(const std::string& dbname); //undo set_log_dbname() if dbname is still registered
+        bool is_log_dbname(const std::string& dir);       //true if dir is the DB registered above
+        ssize_t log_create(const std::string& fname);    //create or truncate
+        ssize_t log_write(const std::string& fname,uint64_t offset,const void *buf,uint64_t count,uint64_t file_size);
+        ssize_t log_read(const std::string& fname,uint64_t offset,void *buf,uint64_t count);
+        ssize_t log_delete(const std::string& fname);
+        ssize_t log_rename(const std::string& src,const std::string& target);
+        bool log_exists(const std::string& fname);
+        ssize_t log_size(const std::string& fname,uint64_t *size);
+        void log_children(const std::string& dir,std::vector<std::string> *names);
+        //////
+
+        //////value log relation (separated values, sequential zones)
+        ssize_t vlog_write(const void *buf,uint64_t count,uint64_t *zone,uint64_t *offset,IOClass io_class=kIOFlush);  //append values, returns the zone and byte offset
+        ssize_t vlog_read(uint64_t zone,uint64_t offset,void *buf,uint64_t count,IOClass io_class=kIOUserRead);
+        void vlog_release(uint64_t zone,uint64_t count);   //values that no table points to any more
+        //////
+
+        //////capacity relation
+        uint64_t get_free_zone_num();    //sequential zones not used by any level
+        bool is_out_of_space(){ return get_free_zone_num()<ZONE_RESERVE_NUM; };
+        bool is_capacity_pressure(){ return get_free_zone_num()<ZONE_PRESSURE_NUM; };
+        bool need_zone_clean();          //below the reserve and some zone is worth relocating
+        int clean_zones(int max_zones);  //relocate the live tables of the least valid zones, returns zones freed
+        //////
+
+        //////background bandwidth
+        void set_bg_rate_limit(uint64_t bytes_per_second){ rate_limiter_.set_bytes_per_second(bytes_per_second); };  //0 means unlimited
+        uint64_t get_bg_rate_limit(){ return rate_limiter_.get_effective_bytes_per_second(); };
+        void set_bg_rate_auto_tune(bool auto_tune){ rate_limiter_.set_auto_tune(auto_tune); };
+        void update_bg_pressure(int level0_files,uint64_t pending_compaction_bytes){ rate_limiter_.update_pressure(level0_files,pending_compaction_bytes); };
+        //////
+
+        //////drive model, predicted service time of the zone commands
+        void set_smr_model(bool enabled){ smr_model_.set_enabled(enabled); };
+        bool smr_model_enabled(){ return smr_model_.enabled(); };
+        void get_smr_model_stats(struct SMRModelStats *stats){ smr_model_.get_stats(stats); };
+        //////
 
         //////end
 
@@ -77,24 +162,57 @@ namespace leveldb{
         std::vector<struct Zonefile*> zone_info_[config::kNumLevels];  //each level of zone
         std::vector<struct Zonefile*> com_window_[config::kNumLevels]; //each level of compaction window
 
-        //////statistics
-        uint64_t delete_zone_num;
-        uint64_t all_table_size;
-        uint64_t kv_store_sector;
-        uint64_t kv_read_sector;
-        uint64_t max_zone_num;
-        uint64_t move_file_size;
-        uint64_t read_time;
-        uint64_t write_time;
+        port::Mutex meta_mutex_; //held while table_map_, zone_info_ and com_window_ change, and by the statistics readers;
+                                 //the background thread is their only writer and reads them without it
+        port::Mutex log_mutex_;  //WAL and MANIFEST are written from different threads
+        std::map<std::string, struct Logfile*> log_map_;  //<file name, log file in conventional zones>
+        std::string log_dbname_;                          //directory of the DB whose logs live there
+        port::Mutex vlog_mutex_;  //flushes append values while compactions release them
+        std::map<uint64_t, struct Valuezone*> vlog_map_;  //<zone number, value log zone>
+        struct Valuezone* vlog_open_;                     //zone the values are appended to, NULL before the first
+
+        //////statistics, read by monitoring while the I/O paths update them
+        std::atomic<uint64_t> zone_num_;   //sequential zones used by the levels
+        std::atomic<uint64_t> delete_zone_num;
+        std::atomic<uint64_t> all_table_size;
+        std::atomic<uint64_t> kv_store_sector;
+        std::atomic<uint64_t> kv_read_sector;
+        std::atomic<uint64_t> max_zone_num;
+        std::atomic<uint64_t> move_file_size;
+        std::atomic<uint64_t> log_store_sector;
+        std::atomic<uint64_t> clean_zone_num;
+        std::atomic<uint64_t> clean_file_size;
+        std::atomic<uint64_t> read_time;
+        std::atomic<uint64_t> write_time;
+        std::atomic<uint64_t> vlog_zone_num_;
+        std::atomic<uint64_t> vlog_live_size;
+        std::atomic<uint64_t> vlog_store_sector;
+        std::atomic<uint64_t> vlog_free_zone_num;
         //////end
 
+        std::atomic<bool> clean_blocked_;   //the last relocation found no free zone; cleared when a zone is freed
+
+        LatencyStats latency_stats_;
+        IOScheduler io_scheduler_;
+        RateLimiter rate_limiter_;   //compaction and relocation only; flushes keep writers moving
+        SMRModel smr_model_;
+        ssize_t zone_pread(IOClass io_class,void *buf,uint64_t sector_count,uint64_t sector_ofst);
+        ssize_t zone_pwrite(IOClass io_class,const void *buf,uint64_t sector_count,uint64_t sector_ofst);
+
         int set_first_zonenum();
         ssize_t hm_alloc(int level,uint64_t size);
-        ssize_t hm_alloc_zone();
-        void hm_free_zone(uint64_t zone);
+        ssize_t hm_alloc_zone();   //REQUIRES: meta_mutex_ held, it guards bitmap_
+        void hm_free_zone(uint64_t zone);   //REQUIRES: meta_mutex_ held
+        void hm_release_zone(int level,std::vector<struct Zonefile*>::iterator iz);   //drop an empty zone from a level and reset it
+        struct Zonefile* pick_clean_zone(int *level);   //REQUIRES: meta_mutex_ held or the background thread
+        ssize_t log_alloc_zone();   //REQUIRES: log_mutex_ held; takes meta_mutex_
+        void log_free_zones(struct Logfile* lf,size_t keep);   //REQUIRES: log_mutex_ held; takes meta_mutex_
+        void vlog_free_zone(std::map<uint64_t, struct Valuezone*>::iterator iv);   //REQUIRES: vlog_mutex_ held
 
         //////
         bool is_com_window(int level,uint64_t zone);
+        float level_fill_percent(int level);       //REQUIRES: meta_mutex_ held or the background thread
+        uint64_t level_zone_remaining(int level);  //REQUIRES: meta_mutex_ held or the background thread
         //////
 
     };
@@ -5,6 +5,7 @@
 //Module function: Some variables and structures
 //////
 
+#include <string>
 #include <vector>
 
 #define PHYSICAL_BLOCK_SIZE 4096   //Disk physical block size, write operation may align with it; get it maybe can accord to the environment in some way
@@ -15,6 +16,45 @@
 
 #define COM_WINDOW_SEQ 1      //0 means the compaction window selects zone random; 1 means the compaction window selects zone compaction
 
+#define IO_SLICE_SIZE (1*1024*1024)  //Background zone reads and writes are issued in slices of this many bytes, \
+                                    //so a foreground read waits behind at most one slice of compaction I/O
+
+#define BG_RATE_LIMIT 0           //Bytes per second allowed to compaction and relocation zone I/O; 0 means unlimited. \
+                                  //It can be changed at runtime with HMManager::set_bg_rate_limit
+#define BG_RATE_AUTO_TUNE 0       //1 means the background rate limit rises as level 0 approaches kL0_SlowdownWritesTrigger \
+                                  //or pending compaction bytes approach BG_RATE_PENDING_BYTES, and is lifted when either is reached
+#define BG_RATE_PENDING_BYTES (1024ULL*1024*1024)
+
+#define ZONE_FIT_OUTPUT 1         //1 means compaction outputs are cut to the space left in the output level's open zone, \
+                                  //so the zone is filled exactly instead of leaving a tail that the next SSTable can't fit
+#define ZONE_FIT_MIN_TAIL (1*1024*1024)   //A zone tail smaller than this is not worth an SSTable of its own and is left unused
+#define ZONE_FIT_SLACK (256*1024)         //Room kept for the pending data block, filter, index and footer when cutting to fit a zone
+
+#define ZONE_RECLAIM_PICK 1       //1 means a size compaction starts from the file expected to free the most zones per byte of \
+                                  //compaction input; 0 means the files of a level are compacted in key order as in leveldb
+
+#define TRIVIAL_MOVE_ZONE_REMAIN (64*1024*1024)  //A trivial move dumps the whole zone once it has less free space than this
+
+#define ZONE_RESERVE_NUM 4        //Free sequential zones kept for compaction and relocation; below it no new memtable is \
+                                  //flushed and writers get Status::NoSpace until compaction or the zone cleaner frees zones
+#define ZONE_PRESSURE_NUM 16      //Below this many free zones, levels whose zones hold the most dead data are compacted first
+#define ZONE_CLEAN_VALID 50       //Below the reserve, the zone cleaner relocates the live tables of zones less valid than this percent
+#define ZONE_CLEAN_MAX 2          //Zones the cleaner empties per background call, to bound the relocation I/O
+
+#define VALUE_LOG_BATCH (4*1024*1024)   //Separated values are appended to the value log zones this many bytes at a time
+
+#define LOG_ON_CONV_ZONE 1        //1 means the WAL and MANIFEST are appended to the drive's conventional zones with direct I/O \
+                                  //instead of going through the file system; drives without conventional zones keep using files
+
+#define SMR_MODEL 0               //1 means every zone command is charged the service time of a host-managed SMR HDD and the \
+                                  //predicted device time is reported; nothing sleeps. It can be changed with HMManager::set_smr_model
+#define SMR_SEEK_MIN_MICROS 1000.0      //Track to track seek
+#define SMR_SEEK_FULL_MICROS 16000.0    //Full stroke seek
+#define SMR_RPM 7200.0
+#define SMR_OUTER_MBPS 250.0            //Sequential bandwidth at the first LBA
+#define SMR_INNER_MBPS 120.0            //Sequential bandwidth at the last LBA
+#define SMR_RESET_MICROS 5000           //Write pointer reset of one zone
+
 #define MEMALIGN_SIZE (sysconf(_SC_PAGESIZE))     //The size of the alignment when applying for memory using posix_memalign
 
 #define Verify_Table 1        //To confirm whether the SSTable is useful, every time an SSTable is written to the disk, \
@@ -40,6 +80,24 @@ namespace leveldb {
         ~Ldbfile(){};
     };
 
+    struct Logfile {     //WAL or MANIFEST stored in conventional zones
+        std::string name;            //full path the DB uses for the file
+        std::vector<uint64_t> zones; //conventional zones holding the file, in file order
+        uint64_t size;               //bytes of valid data
+
+        Logfile(const std::string& a):name(a),size(0){};
+        ~Logfile(){};
+    };
+
+    struct Valuezone {   //sequential zone of the value log
+        uint64_t zone;     //zone num
+        uint64_t written;  //bytes of values appended
+        uint64_t live;     //bytes of values still pointed to by the tables
+
+        Valuezone(uint64_t a):zone(a),written(0),live(0){};
+        ~Valuezone(){};
+    };
+
     struct Zonefile {    //zone struct
         uint64_t zone; //zone num 
         
@@ -80,4 +138,4 @@ namespace leveldb {
 
 
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <sys/time.h>
+
+#include "../hm/io_scheduler.h"
+#include "../util/mutexlock.h"
+
+namespace leveldb{
+    static uint64_t get_now_micros(){
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+    IOScheduler::IOScheduler()
+        :cv_(&mutex_),active_foreground_(0),background_active_(false) {
+        for(int i=0;i<kNumIOClasses;i++){
+            waiting_[i]=0;
+            stats_[i].ops=0;
+            stats_[i].slices=0;
+            stats_[i].wait_micros=0;
+            stats_[i].max_wait_micros=0;
+        }
+    }
+
+    IOScheduler::~IOScheduler(){
+    }
+
+    bool IOScheduler::can_start(IOClass io_class){
+        if(background_active_){
+            return false;
+        }
+        if(io_class<=kIOLog){
+            return true;
+        }
+        if(active_foreground_>0){
+            return false;
+        }
+        for(int i=0;i<io_class;i++){   //a more urgent request is queued
+            if(waiting_[i]>0){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void IOScheduler::begin_io(IOClass io_class){
+        uint64_t wait_begin=get_now_micros();
+        MutexLock l(&mutex_);
+        waiting_[io_class]++;
+        while(!can_start(io_class)){
+            cv_.Wait();
+        }
+        waiting_[io_class]--;
+        if(io_class<=kIOLog){
+            active_foreground_++;
+        }
+        else{
+            background_active_=true;
+        }
+
+        uint64_t wait=get_now_micros()-wait_begin;
+        stats_[io_class].slices++;
+        stats_[io_class].wait_micros += wait;
+        if(wait>stats_[io_class].max_wait_micros){
+            stats_[io_class].max_wait_micros=wait;
+        }
+    }
+
+    void IOScheduler::end_io(IOClass io_class){
+        MutexLock l(&mutex_);
+        if(io_class<=kIOLog){
+            active_foreground_--;
+            if(active_foreground_>0){
+                return;
+            }
+        }
+        else{
+            background_active_=false;
+        }
+        cv_.SignalAll();
+    }
+
+    void IOScheduler::count_op(IOClass io_class){
+        MutexLock l(&mutex_);
+        stats_[io_class].ops++;
+    }
+
+    void IOScheduler::get_stats(IOClass io_class,struct IOClassStats *stats){
+        MutexLock l(&mutex_);
+        *stats=stats_[io_class];
+    }
+
+    void IOScheduler::reset_stats(){
+        MutexLock l(&mutex_);
+        for(int i=0;i<kNumIOClasses;i++){
+            stats_[i].ops=0;
+            stats_[i].slices=0;
+            stats_[i].wait_micros=0;
+            stats_[i].max_wait_micros=0;
+        }
+    }
+
+    const char* io_class_name(IOClass io_class){
+        switch(io_class){
+            case kIOUserRead:
+                return "user_read";
+            case kIOLog:
+                return "log";
+            case kIOFlush:
+                return "flush";
+            case kIOCompaction:
+                return "compaction";
+            case kIORelocation:
+                return "relocation";
+            default:
+                return "unknown";
+        }
+    }
+
+}
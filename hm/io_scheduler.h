@@ -0,0 +1,68 @@
+#ifndef LEVELDB_HM_IO_SCHEDULER_H
+#define LEVELDB_HM_IO_SCHEDULER_H
+
+//////
+//Module function: priority scheduling of zone I/O on the single actuator
+//////
+
+#include <stdint.h>
+
+#include "../port/port.h"
+
+namespace leveldb{
+
+    enum IOClass {          //in priority order, the smaller the more urgent
+        kIOUserRead = 0,    //foreground point reads (Get)
+        kIOLog,             //WAL and MANIFEST appends in the conventional zones
+        kIOFlush,           //memtable dump to level 0
+        kIOCompaction,      //compaction reads and writes of whole SSTables
+        kIORelocation,      //move_file copies between levels
+        kNumIOClasses
+    };
+
+    struct IOClassStats {
+        uint64_t ops;           //requests of this class
+        uint64_t slices;        //device commands issued for them
+        uint64_t wait_micros;   //total time spent queueing for the device
+        uint64_t max_wait_micros;
+    };
+
+    //User reads and log writes (the foreground classes) are never split and
+    //may run concurrently with each other.
+    //Background requests are cut into slices by the caller and each slice
+    //holds the device alone: it only starts when no user read is waiting or
+    //running and no more urgent background class is queued, so a Get waits
+    //for at most one slice.
+    class IOScheduler {
+    public:
+        IOScheduler();
+        ~IOScheduler();
+
+        void begin_io(IOClass io_class);   //blocks until the request may use the device
+        void end_io(IOClass io_class);
+        void count_op(IOClass io_class);   //one logical request, however many slices
+
+        void get_stats(IOClass io_class,struct IOClassStats *stats);
+        void reset_stats();
+
+    private:
+        port::Mutex mutex_;
+        port::CondVar cv_;
+        int waiting_[kNumIOClasses];     //requests queued per class
+        int active_foreground_;               //foreground requests on the device
+        bool background_active_;         //a background slice is on the device
+
+        struct IOClassStats stats_[kNumIOClasses];
+
+        bool can_start(IOClass io_class);
+
+        //No copying allowed
+        IOScheduler(const IOScheduler&);
+        void operator=(const IOScheduler&);
+    };
+
+    const char* io_class_name(IOClass io_class);
+
+}
+
+#endif
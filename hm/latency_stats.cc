@@ -0,0 +1,75 @@
+#include <stdio.h>
+
+#include "../hm/latency_stats.h"
+
+namespace leveldb{
+
+    std::string latency_type_name(int type){
+        switch(type){
+            case kLatencyHmRead:
+                return "hm_read";
+            case kLatencyHmWrite:
+                return "hm_write";
+            case kLatencyZoneReset:
+                return "zone_reset";
+            case kLatencyZoneAlloc:
+                return "zone_alloc";
+            case kLatencyFlush:
+                return "flush";
+            case kLatencyGearMerge:
+                return "gear_merge";
+            case kLatencyGearInstall:
+                return "gear_install";
+            default:
+                break;
+        }
+        if(type>=kLatencyGearWindow && type<kLatencyGearInstall){
+            char buf[32];
+            snprintf(buf,sizeof(buf),"gear_window_L%d",type-kLatencyGearWindow);
+            return buf;
+        }
+        return "unknown";
+    }
+
+    void LatencyStats::reset(){
+        for(int i=0;i<kNumLatencyTypes;i++){
+            hist_[i].Clear();
+        }
+    }
+
+    void LatencyStats::get_histogram(LatencyType type,Histogram *hist){
+        hist->Clear();
+        hist_[type].Merge(hist);
+    }
+
+    void LatencyStats::to_string(std::string *value){
+        char buf[200];
+        Histogram hist;
+        value->append("type                 count    avg(us)    p50(us)    p99(us)   p999(us)    max(us)\n");
+        for(int i=0;i<kNumLatencyTypes;i++){
+            get_histogram((LatencyType)i,&hist);
+            if(hist.Count()==0){
+                continue;
+            }
+            snprintf(buf,sizeof(buf),"%-18s %8.0f %10.1f %10.1f %10.1f %10.1f %10.0f\n",latency_type_name(i).c_str(),\
+                hist.Count(),hist.Average(),hist.Median(),hist.Percentile(99),hist.Percentile(99.9),hist.Max());
+            value->append(buf);
+        }
+    }
+
+    void LatencyStats::to_json(std::string *value){
+        char buf[256];
+        Histogram hist;
+        value->append("{");
+        for(int i=0;i<kNumLatencyTypes;i++){
+            get_histogram((LatencyType)i,&hist);
+            bool empty=(hist.Count()==0);   //percentiles of nothing are not numbers
+            snprintf(buf,sizeof(buf),"%s\"%s\":{\"count\":%.0f,\"avg\":%.1f,\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.0f}",\
+                i ? "," : "",latency_type_name(i).c_str(),hist.Count(),hist.Average(),empty ? 0 : hist.Median(),\
+                empty ? 0 : hist.Percentile(99),empty ? 0 : hist.Percentile(99.9),hist.Max());
+            value->append(buf);
+        }
+        value->append("}");
+    }
+
+}
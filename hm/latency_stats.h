@@ -0,0 +1,54 @@
+#ifndef LEVELDB_HM_LATENCY_STATS_H
+#define LEVELDB_HM_LATENCY_STATS_H
+
+//////
+//Module function: latency distributions of zone I/O, flushes and gear compaction phases
+//////
+
+#include <stdint.h>
+#include <string>
+
+#include "../db/dbformat.h"
+#include "../util/histogram.h"
+
+namespace leveldb{
+
+    enum LatencyType {
+        kLatencyHmRead = 0,      //hm_read of a table or a part of it
+        kLatencyHmWrite,         //hm_write of a whole table
+        kLatencyZoneReset,       //zbc_reset_zone of a freed zone
+        kLatencyZoneAlloc,       //hm_alloc_zone, including the write pointer check
+        kLatencyFlush,           //memtable dump to level 0
+        kLatencyGearMerge,       //DoMyCompactionWork merging the picked level into the next one
+        kLatencyGearWindow,      //one MergeCompactionWork, kLatencyGearWindow+level for each output level
+        kLatencyGearInstall=kLatencyGearWindow+config::kNumLevels,   //installing the results of a gear compaction
+        kNumLatencyTypes
+    };
+
+    //Samples are microseconds. Adding is lock-free, so the I/O paths can
+    //record every request; readers merge the per-thread shards.
+    class LatencyStats {
+    public:
+        LatencyStats(){};
+        ~LatencyStats(){};
+
+        void add(LatencyType type,uint64_t micros){ hist_[type].Add(micros); };
+        void reset();
+        void get_histogram(LatencyType type,Histogram *hist);
+
+        void to_string(std::string *value);   //one line per type that has samples
+        void to_json(std::string *value);
+
+    private:
+        ConcurrentHistogram hist_[kNumLatencyTypes];
+
+        //No copying allowed
+        LatencyStats(const LatencyStats&);
+        void operator=(const LatencyStats&);
+    };
+
+    std::string latency_type_name(int type);
+
+}
+
+#endif
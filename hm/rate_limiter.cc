@@ -0,0 +1,134 @@
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../hm/rate_limiter.h"
+#include "../hm/hm_status.h"
+#include "../db/dbformat.h"
+#include "../util/mutexlock.h"
+
+namespace leveldb{
+    static uint64_t get_now_micros(){
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+    static const double kMaxAutoTuneBoost = 4.0;       //rate multiplier just below full pressure
+    static const uint64_t kMaxSleepMicros = 100000;    //re-check the rate at least this often
+
+    RateLimiter::RateLimiter(uint64_t bytes_per_second)
+        :bytes_per_second_(bytes_per_second),auto_tune_(false),pressure_(0),tokens_(0),
+         last_refill_micros_(get_now_micros()),total_bytes_(0),throttled_micros_(0) {
+    }
+
+    RateLimiter::~RateLimiter(){
+    }
+
+    uint64_t RateLimiter::effective_rate(){
+        if(bytes_per_second_==0){
+            return 0;
+        }
+        if(!auto_tune_){
+            return bytes_per_second_;
+        }
+        if(pressure_>=1.0){
+            return 0;
+        }
+        return bytes_per_second_*(1.0+(kMaxAutoTuneBoost-1.0)*pressure_);
+    }
+
+    void RateLimiter::refill(uint64_t now){
+        uint64_t rate=effective_rate();
+        double burst=rate/10.0;      //100ms worth of tokens, but always at least one slice
+        if(burst<IO_SLICE_SIZE){
+            burst=IO_SLICE_SIZE;
+        }
+        tokens_ += (now-last_refill_micros_)*1e-6*rate;
+        if(tokens_>burst){
+            tokens_=burst;
+        }
+        last_refill_micros_=now;
+    }
+
+    void RateLimiter::request(uint64_t bytes){
+        uint64_t begin=get_now_micros();
+        MutexLock l(&mutex_);
+        total_bytes_ += bytes;
+        while(true){
+            uint64_t rate=effective_rate();
+            uint64_t now=get_now_micros();
+            if(rate==0){
+                tokens_=0;
+                last_refill_micros_=now;
+                break;
+            }
+            refill(now);
+            if(tokens_>=0){
+                tokens_ -= bytes;
+                break;
+            }
+            uint64_t wait=(-tokens_)*1e6/rate+1;
+            if(wait>kMaxSleepMicros){
+                wait=kMaxSleepMicros;
+            }
+            mutex_.Unlock();
+            usleep(wait);
+            mutex_.Lock();
+        }
+        throttled_micros_ += get_now_micros()-begin;
+    }
+
+    void RateLimiter::set_bytes_per_second(uint64_t bytes_per_second){
+        MutexLock l(&mutex_);
+        refill(get_now_micros());
+        bytes_per_second_=bytes_per_second;
+    }
+
+    uint64_t RateLimiter::get_bytes_per_second(){
+        MutexLock l(&mutex_);
+        return bytes_per_second_;
+    }
+
+    uint64_t RateLimiter::get_effective_bytes_per_second(){
+        MutexLock l(&mutex_);
+        return effective_rate();
+    }
+
+    void RateLimiter::set_auto_tune(bool auto_tune){
+        MutexLock l(&mutex_);
+        refill(get_now_micros());
+        auto_tune_=auto_tune;
+    }
+
+    bool RateLimiter::get_auto_tune(){
+        MutexLock l(&mutex_);
+        return auto_tune_;
+    }
+
+    void RateLimiter::update_pressure(int level0_files,uint64_t pending_compaction_bytes){
+        double l0_pressure=1.0*(level0_files-config::kL0_CompactionTrigger)/
+                                (config::kL0_SlowdownWritesTrigger-config::kL0_CompactionTrigger);
+        double pending_pressure=1.0*pending_compaction_bytes/BG_RATE_PENDING_BYTES;
+        double pressure=(l0_pressure>pending_pressure) ? l0_pressure : pending_pressure;
+        if(pressure<0){
+            pressure=0;
+        }
+        if(pressure>1){
+            pressure=1;
+        }
+        MutexLock l(&mutex_);
+        refill(get_now_micros());
+        pressure_=pressure;
+    }
+
+    uint64_t RateLimiter::get_total_bytes(){
+        MutexLock l(&mutex_);
+        return total_bytes_;
+    }
+
+    uint64_t RateLimiter::get_throttled_micros(){
+        MutexLock l(&mutex_);
+        return throttled_micros_;
+    }
+
+}
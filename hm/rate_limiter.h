@@ -0,0 +1,62 @@
+#ifndef LEVELDB_HM_RATE_LIMITER_H
+#define LEVELDB_HM_RATE_LIMITER_H
+
+//////
+//Module function: token bucket limiting background zone bandwidth
+//////
+
+#include <stdint.h>
+
+#include "../port/port.h"
+
+namespace leveldb{
+
+    //Compaction and relocation I/O asks for tokens before each slice.
+    //Tokens refill at the configured rate; a request may drive the bucket
+    //into debt, and the next request then sleeps until the debt is repaid,
+    //so any request size works and the long-run rate is exact.
+    //
+    //In auto-tune mode the effective rate rises with the write pressure
+    //reported by the DB: it is the base rate while level 0 is below the
+    //compaction trigger and becomes unlimited when level 0 reaches
+    //kL0_SlowdownWritesTrigger, so compaction is never throttled into a
+    //write stall.
+    class RateLimiter {
+    public:
+        explicit RateLimiter(uint64_t bytes_per_second);   //0 means unlimited
+        ~RateLimiter();
+
+        void request(uint64_t bytes);     //blocks until the bytes may be transferred
+
+        void set_bytes_per_second(uint64_t bytes_per_second);
+        uint64_t get_bytes_per_second();
+        uint64_t get_effective_bytes_per_second();   //base rate scaled by the current pressure
+        void set_auto_tune(bool auto_tune);
+        bool get_auto_tune();
+        void update_pressure(int level0_files,uint64_t pending_compaction_bytes);
+
+        uint64_t get_total_bytes();
+        uint64_t get_throttled_micros();
+
+    private:
+        port::Mutex mutex_;
+        uint64_t bytes_per_second_;
+        bool auto_tune_;
+        double pressure_;          //0: no write pressure, 1: writes are about to be slowed down
+        double tokens_;            //may go negative
+        uint64_t last_refill_micros_;
+
+        uint64_t total_bytes_;
+        uint64_t throttled_micros_;
+
+        uint64_t effective_rate();   //REQUIRES: mutex_ held; 0 means unlimited
+        void refill(uint64_t now);
+
+        //No copying allowed
+        RateLimiter(const RateLimiter&);
+        void operator=(const RateLimiter&);
+    };
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../hm/smr_model.h"
+#include "../hm/hm_status.h"
+#include "../util/mutexlock.h"
+
+namespace leveldb{
+
+    SMRModel::SMRModel()
+        :enabled_(SMR_MODEL),zone_sectors_(0),zone_num_(0),first_seq_zone_(0),total_sectors_(0),head_(0),wp_(NULL) {
+        memset(&stats_,0,sizeof(stats_));
+    }
+
+    SMRModel::~SMRModel(){
+        free(wp_);
+    }
+
+    void SMRModel::init(const struct zbc_zone *zones,unsigned int zone_num){
+        MutexLock l(&mutex_);
+        free(wp_);
+        wp_=(uint64_t *)malloc(sizeof(uint64_t)*zone_num);
+        zone_num_=zone_num;
+        first_seq_zone_=zone_num;
+        for(unsigned int i=0;i<zone_num;i++){
+            wp_[i]=zones[i].zbz_write_pointer;
+            if(first_seq_zone_==zone_num && (zones[i].zbz_type==2 || zones[i].zbz_type==3)){
+                first_seq_zone_=i;
+            }
+        }
+        zone_sectors_=zone_num ? zones[0].zbz_length : 0;
+        total_sectors_=zone_num ? zones[zone_num-1].zbz_start+zones[zone_num-1].zbz_length : 0;
+        head_=0;
+    }
+
+    void SMRModel::set_enabled(bool enabled){
+        enabled_=enabled;
+    }
+
+    void SMRModel::access(IOClass io_class,uint64_t sector_ofst,uint64_t sector_count){
+        uint64_t micros=0;
+        if(sector_ofst!=head_){
+            uint64_t distance=(sector_ofst>head_) ? sector_ofst-head_ : head_-sector_ofst;
+            double seek=SMR_SEEK_MIN_MICROS+(SMR_SEEK_FULL_MICROS-SMR_SEEK_MIN_MICROS)*sqrt(1.0*distance/total_sectors_);
+            double rotation=60e6/SMR_RPM/2;
+            stats_.seeks++;
+            stats_.seek_micros += seek;
+            stats_.rotation_micros += rotation;
+            micros += (uint64_t)seek+(uint64_t)rotation;
+        }
+        double position=1.0*sector_ofst/total_sectors_;   //0 at the outer edge, 1 at the inner edge
+        double mbps=SMR_OUTER_MBPS-(SMR_OUTER_MBPS-SMR_INNER_MBPS)*position;
+        uint64_t transfer=sector_count*512/(mbps*1048576)*1e6;
+        stats_.transfer_micros += transfer;
+        micros += transfer;
+        stats_.device_micros += micros;
+        stats_.class_micros[io_class] += micros;
+        head_=sector_ofst+sector_count;
+    }
+
+    void SMRModel::read(IOClass io_class,uint64_t sector_ofst,uint64_t sector_count){
+        if(!enabled_ || total_sectors_==0){
+            return;
+        }
+        MutexLock l(&mutex_);
+        access(io_class,sector_ofst,sector_count);
+    }
+
+    void SMRModel::write(IOClass io_class,uint64_t sector_ofst,uint64_t sector_count){
+        if(total_sectors_==0){
+            return;
+        }
+        MutexLock l(&mutex_);
+        uint64_t zone=sector_ofst/zone_sectors_;
+        bool violation=false;
+        if(zone>=first_seq_zone_ && zone<zone_num_){   //a host-managed zone only takes writes at its write pointer
+            violation=(sector_ofst!=wp_[zone]);
+            wp_[zone]=sector_ofst+sector_count;
+        }
+        if(!enabled_){
+            return;
+        }
+        if(violation){
+            stats_.wp_violations++;
+        }
+        access(io_class,sector_ofst,sector_count);
+    }
+
+    void SMRModel::reset_zone(uint64_t sector_ofst){
+        if(total_sectors_==0){
+            return;
+        }
+        MutexLock l(&mutex_);
+        uint64_t zone=sector_ofst/zone_sectors_;
+        if(zone<zone_num_){
+            wp_[zone]=sector_ofst;
+        }
+        if(!enabled_){
+            return;
+        }
+        stats_.resets++;
+        stats_.reset_micros += SMR_RESET_MICROS;
+        stats_.device_micros += SMR_RESET_MICROS;
+    }
+
+    void SMRModel::get_stats(struct SMRModelStats *stats){
+        MutexLock l(&mutex_);
+        *stats=stats_;
+    }
+
+    void SMRModel::reset_stats(){
+        MutexLock l(&mutex_);
+        memset(&stats_,0,sizeof(stats_));
+    }
+
+}
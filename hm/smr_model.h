@@ -0,0 +1,81 @@
+#ifndef LEVELDB_HM_SMR_MODEL_H
+#define LEVELDB_HM_SMR_MODEL_H
+
+//////
+//Module function: service time model of a host-managed SMR drive
+//////
+
+#include <stdint.h>
+#include <atomic>
+
+#include "../hm/io_scheduler.h"
+#include "../port/port.h"
+
+extern "C" {
+#include <libzbc/zbc.h>
+}
+
+namespace leveldb{
+
+    struct SMRModelStats {
+        uint64_t device_micros;          //predicted busy time of the drive, the sum of the parts below
+        uint64_t seek_micros;
+        uint64_t rotation_micros;
+        uint64_t transfer_micros;
+        uint64_t reset_micros;
+        uint64_t seeks;                  //commands that did not start where the head was
+        uint64_t resets;
+        uint64_t wp_violations;          //writes to a sequential zone away from its write pointer
+        uint64_t class_micros[kNumIOClasses];
+    };
+
+    //Every command the manager sends to the drive is charged the time a
+    //host-managed SMR disk would take to serve it, without sleeping:
+    //  seek      0 when the command starts where the last one ended, otherwise
+    //            SMR_SEEK_MIN_MICROS growing with the square root of the LBA
+    //            distance up to SMR_SEEK_FULL_MICROS
+    //  rotation  half a revolution after each seek
+    //  transfer  at a bandwidth falling linearly from SMR_OUTER_MBPS at LBA 0
+    //            to SMR_INNER_MBPS at the last LBA
+    //  reset     SMR_RESET_MICROS per zone
+    //The commands are served one at a time, as by the single actuator, so the
+    //predicted time is the sum of their service times. Write pointers are
+    //followed even while the model is disabled, so it can be turned on at any time.
+    class SMRModel {
+    public:
+        SMRModel();
+        ~SMRModel();
+
+        void init(const struct zbc_zone *zones,unsigned int zone_num);
+        void set_enabled(bool enabled);
+        bool enabled(){ return enabled_.load(); };
+
+        void read(IOClass io_class,uint64_t sector_ofst,uint64_t sector_count);
+        void write(IOClass io_class,uint64_t sector_ofst,uint64_t sector_count);
+        void reset_zone(uint64_t sector_ofst);
+
+        void get_stats(struct SMRModelStats *stats);
+        void reset_stats();
+
+    private:
+        port::Mutex mutex_;
+        std::atomic<bool> enabled_;
+        uint64_t zone_sectors_;
+        unsigned int zone_num_;
+        unsigned int first_seq_zone_;
+        uint64_t total_sectors_;
+        uint64_t head_;              //sector after the last one accessed
+        uint64_t *wp_;               //write pointer of each zone as the drive sees it
+
+        struct SMRModelStats stats_;
+
+        void access(IOClass io_class,uint64_t sector_ofst,uint64_t sector_count);   //REQUIRES: mutex_ held
+
+        //No copying allowed
+        SMRModel(const SMRModel&);
+        void operator=(const SMRModel&);
+    };
+
+}
+
+#endif
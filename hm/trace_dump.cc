@@ -0,0 +1,277 @@
+//////
+//Module function: decode a trace written by Tracer
+//////
+//
+//Usage: trace_dump [--events|--valid|--compaction] <trace_file>
+//  --events      one line per event, the content MyLOG used to have (default)
+//  --valid       zone occupancy at the end of the trace, as Valid_DATA.csv
+//  --compaction  one line per compaction, as Compaction_time.csv
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "../hm/tracer.h"
+
+namespace leveldb{
+
+    static const int kMaxTraceLevel = 16;
+
+    static const char* trace_type_name(int type){
+        switch(type){
+            case kTraceZoneAlloc:       return "zone_alloc";
+            case kTraceZoneFree:        return "zone_free";
+            case kTraceZoneMove:        return "zone_move";
+            case kTraceTableWrite:      return "table_write";
+            case kTraceTableDelete:     return "table_delete";
+            case kTraceTableMove:       return "table_move";
+            case kTraceWindow:          return "window";
+            case kTraceFlushBegin:      return "flush_begin";
+            case kTraceFlushEnd:        return "flush_end";
+            case kTraceCompactionBegin: return "compaction_begin";
+            case kTraceCompactionEnd:   return "compaction_end";
+            case kTraceMergeBegin:      return "merge_begin";
+            case kTraceMergeEnd:        return "merge_end";
+            case kTraceInstall:         return "install";
+            default:                    return "unknown";
+        }
+    }
+
+    static void print_event(const TraceEvent& ev,uint64_t base_micros){
+        const uint64_t* a=ev.arg;
+        printf("%.6f t%u ",(ev.micros-base_micros)*1e-6,ev.thread);
+        switch(ev.type){
+            case kTraceZoneAlloc:
+                printf("alloc zone:%lu to level-%d\n",a[0],ev.level);
+                break;
+            case kTraceZoneFree:
+                printf("delete zone:%lu from level-%d\n",a[0],ev.level);
+                break;
+            case kTraceZoneMove:
+                printf("move zone:%lu of %lu tables from level-%lu to level-%d\n",a[0],a[2],a[1],ev.level);
+                break;
+            case kTraceTableWrite:
+                printf("write table:%lu to level-%d zone:%lu of size:%lu bytes ofst:%lu\n",a[0],ev.level,a[1],a[3],a[2]);
+                break;
+            case kTraceTableDelete:
+                printf("delete table:%lu from level-%d zone:%lu of size:%lu MB\n",a[0],ev.level,a[1],a[3]/1048576);
+                break;
+            case kTraceTableMove:
+                printf("move table:%lu from level-%lu to level-%d zone:%lu of size:%lu MB\n",a[0],a[2],ev.level,a[1],a[3]/1048576);
+                break;
+            case kTraceWindow:
+                printf("window level-%d: %lu of %lu zones\n",ev.level,a[0],a[1]);
+                break;
+            case kTraceFlushBegin:
+                printf("flush table:%lu started\n",a[0]);
+                break;
+            case kTraceFlushEnd:
+                printf("flush table:%lu to level-%d: %lu bytes %.3f s\n",a[0],ev.level,a[1],a[2]*1e-6);
+                break;
+            case kTraceCompactionBegin:
+                printf("compacting %lu@%d + %lu@%d files\n",a[0],ev.level,a[1],ev.level+1);
+                break;
+            case kTraceCompactionEnd:
+                printf("compacted level-%d read:%lu MB write:%lu MB %.2f s\n",ev.level,a[0]/1048576,a[1]/1048576,a[2]*1e-6);
+                break;
+            case kTraceMergeBegin:
+                printf("merge compacting %lu@%d input\n",a[0],ev.level);
+                break;
+            case kTraceMergeEnd:
+                printf("merge compacted level-%d %.3f s\n",ev.level,a[0]*1e-6);
+                break;
+            case kTraceInstall:
+                printf("install level-%d: %lu outputs %.3f s\n",ev.level,a[0],a[1]*1e-6);
+                break;
+            default:
+                printf("%s level:%d %lu %lu %lu %lu\n",trace_type_name(ev.type),ev.level,a[0],a[1],a[2],a[3]);
+                break;
+        }
+    }
+
+    struct ZoneState {
+        std::set<uint64_t> tables;
+        uint64_t valid_size;
+        ZoneState():valid_size(0) {}
+    };
+
+    struct TableState {
+        uint64_t zone;
+        uint64_t size;
+    };
+
+    //Replays the zone manager's metadata changes in the order they happened.
+    //move_file records a delete from the old zone followed by a table_move
+    //into the new one; move_zone keeps the tables where they are.
+    class ZoneReplay {
+    public:
+        void apply(const TraceEvent& ev){
+            if(ev.level<0 || ev.level>=kMaxTraceLevel){
+                return;
+            }
+            const uint64_t* a=ev.arg;
+            switch(ev.type){
+                case kTraceZoneAlloc:
+                    levels_[ev.level].push_back(a[0]);
+                    zones_[a[0]]=ZoneState();
+                    break;
+                case kTraceZoneFree:
+                    remove_zone(ev.level,a[0]);
+                    zones_.erase(a[0]);
+                    break;
+                case kTraceZoneMove:
+                    if(a[1]<(uint64_t)kMaxTraceLevel){
+                        remove_zone(a[1],a[0]);
+                    }
+                    {
+                        std::vector<uint64_t>& v=levels_[ev.level];
+                        size_t pos=v.empty() ? 0 : v.size()-1;   //before the zone being written, as move_zone does
+                        v.insert(v.begin()+pos,a[0]);
+                    }
+                    break;
+                case kTraceTableWrite:
+                case kTraceTableMove:
+                    {
+                        TableState t;
+                        t.zone=a[1];
+                        t.size=a[3];
+                        tables_[a[0]]=t;
+                        zones_[a[1]].tables.insert(a[0]);
+                        zones_[a[1]].valid_size += a[3];
+                    }
+                    break;
+                case kTraceTableDelete:
+                    {
+                        std::map<uint64_t,TableState>::iterator it=tables_.find(a[0]);
+                        if(it==tables_.end()){
+                            break;
+                        }
+                        std::map<uint64_t,ZoneState>::iterator iz=zones_.find(it->second.zone);
+                        if(iz!=zones_.end()){
+                            iz->second.tables.erase(a[0]);
+                            iz->second.valid_size -= it->second.size;
+                        }
+                        tables_.erase(it);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void print_valid_csv(){
+            printf("level,zone_id,table_num,valid_size(MB),percent(%%)\n");
+            for(int i=0;i<kMaxTraceLevel;i++){
+                for(size_t j=0;j<levels_[i].size();j++){
+                    uint64_t zone_id=levels_[i][j];
+                    ZoneState& z=zones_[zone_id];
+                    float percent=100.0*z.valid_size/(256.0*1024*1024);
+                    printf("%d,%lu,%lu,%lu,%.2f\n",i,zone_id,(uint64_t)z.tables.size(),z.valid_size/1048576,percent);
+                }
+            }
+        }
+
+    private:
+        std::vector<uint64_t> levels_[kMaxTraceLevel];
+        std::map<uint64_t,ZoneState> zones_;
+        std::map<uint64_t,TableState> tables_;
+
+        void remove_zone(int level,uint64_t zone_id){
+            std::vector<uint64_t>& v=levels_[level];
+            for(size_t i=0;i<v.size();i++){
+                if(v[i]==zone_id){
+                    v.erase(v.begin()+i);
+                    return;
+                }
+            }
+        }
+    };
+
+    enum DumpMode { kDumpEvents, kDumpValid, kDumpCompaction };
+
+    static int dump_trace(const char* fname,DumpMode mode){
+        FILE* f=fopen(fname,"rb");
+        if(f==NULL){
+            fprintf(stderr,"error:open trace file %s failed!\n",fname);
+            return 1;
+        }
+        char magic[sizeof(kTraceMagic)];
+        if(fread(magic,sizeof(magic),1,f)!=1 || memcmp(magic,kTraceMagic,sizeof(magic))!=0){
+            fprintf(stderr,"error:%s is not a trace file!\n",fname);
+            fclose(f);
+            return 1;
+        }
+
+        //Rings are drained one after another, so events of different threads
+        //are only ordered after sorting by time.
+        std::vector<TraceEvent> events;
+        TraceEvent ev;
+        while(fread(&ev,sizeof(ev),1,f)==1){
+            events.push_back(ev);
+        }
+        fclose(f);
+        std::multimap<uint64_t,size_t> order;
+        for(size_t i=0;i<events.size();i++){
+            order.insert(std::make_pair(events[i].micros,i));
+        }
+
+        uint64_t base_micros=events.empty() ? 0 : order.begin()->first;
+        uint64_t compaction_num=0;
+        ZoneReplay replay;
+        if(mode==kDumpCompaction){
+            printf("compaction,read(MB),write(MB),time(s)\n");
+        }
+        std::multimap<uint64_t,size_t>::iterator it;
+        for(it=order.begin();it!=order.end();it++){
+            const TraceEvent& e=events[it->second];
+            switch(mode){
+                case kDumpEvents:
+                    print_event(e,base_micros);
+                    break;
+                case kDumpValid:
+                    replay.apply(e);
+                    break;
+                case kDumpCompaction:
+                    if(e.type==kTraceCompactionEnd){
+                        printf("%lu,%lu,%lu,%.2f\n",++compaction_num,e.arg[0]/1048576,e.arg[1]/1048576,e.arg[2]*1e-6);
+                    }
+                    break;
+            }
+        }
+        if(mode==kDumpValid){
+            replay.print_valid_csv();
+        }
+        return 0;
+    }
+
+}
+
+int main(int argc,char** argv){
+    leveldb::DumpMode mode=leveldb::kDumpEvents;
+    const char* fname=NULL;
+    for(int i=1;i<argc;i++){
+        if(strcmp(argv[i],"--events")==0){
+            mode=leveldb::kDumpEvents;
+        }
+        else if(strcmp(argv[i],"--valid")==0){
+            mode=leveldb::kDumpValid;
+        }
+        else if(strcmp(argv[i],"--compaction")==0){
+            mode=leveldb::kDumpCompaction;
+        }
+        else if(fname==NULL && argv[i][0]!='-'){
+            fname=argv[i];
+        }
+        else{
+            fname=NULL;
+            break;
+        }
+    }
+    if(fname==NULL){
+        fprintf(stderr,"Usage: %s [--events|--valid|--compaction] <trace_file>\n",argv[0]);
+        return 1;
+    }
+    return leveldb::dump_trace(fname,mode);
+}
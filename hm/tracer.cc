@@ -0,0 +1,156 @@
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../hm/tracer.h"
+#include "../util/mutexlock.h"
+
+namespace leveldb{
+    static uint64_t get_now_micros(){
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+    static const int kDrainIntervalMicros = 10000;   //a ring fills in no less than this at normal event rates
+
+    static __thread void* tls_ring = NULL;
+
+    Tracer* Tracer::global(){
+        static Tracer* tracer = new Tracer();   //never deleted, the drainer may outlive static destructors
+        return tracer;
+    }
+
+    Tracer::Tracer()
+        :enabled_(false),file_(NULL),running_(false) {
+    }
+
+    Tracer::~Tracer(){
+        stop();
+    }
+
+    Tracer::Ring* Tracer::thread_ring(){
+        if(tls_ring==NULL){
+            Ring* r=new Ring;
+            r->head.store(0);
+            r->tail.store(0);
+            r->dropped.store(0);
+            MutexLock l(&rings_mutex_);
+            r->id=rings_.size();
+            rings_.push_back(r);
+            tls_ring=r;
+        }
+        return (Ring*)tls_ring;
+    }
+
+    void Tracer::record(TraceEventType type,int level,uint64_t a0,uint64_t a1,uint64_t a2,uint64_t a3){
+        Ring* r=thread_ring();
+        uint64_t head=r->head.load(std::memory_order_relaxed);
+        if(head-r->tail.load(std::memory_order_acquire)>=kRingSize){
+            r->dropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        TraceEvent* ev=&r->events[head%kRingSize];
+        ev->micros=get_now_micros();
+        ev->type=type;
+        ev->level=level;
+        ev->thread=r->id;
+        ev->arg[0]=a0;
+        ev->arg[1]=a1;
+        ev->arg[2]=a2;
+        ev->arg[3]=a3;
+        r->head.store(head+1,std::memory_order_release);
+    }
+
+    void Tracer::drain(){
+        std::vector<Ring*> rings;
+        {
+            MutexLock l(&rings_mutex_);
+            rings=rings_;
+        }
+        for(size_t i=0;i<rings.size();i++){
+            Ring* r=rings[i];
+            uint64_t tail=r->tail.load(std::memory_order_relaxed);
+            uint64_t head=r->head.load(std::memory_order_acquire);
+            while(tail<head){   //at most two pieces, before and after the wrap
+                uint64_t n=kRingSize-tail%kRingSize;
+                if(n>head-tail){
+                    n=head-tail;
+                }
+                if(file_!=NULL){
+                    fwrite(&r->events[tail%kRingSize],sizeof(TraceEvent),n,file_);
+                }
+                tail += n;
+            }
+            r->tail.store(tail,std::memory_order_release);
+        }
+        if(file_!=NULL){
+            fflush(file_);
+        }
+    }
+
+    void* Tracer::drainer(void* arg){
+        Tracer* t=reinterpret_cast<Tracer*>(arg);
+        while(true){
+            {
+                MutexLock l(&t->file_mutex_);
+                if(!t->running_){
+                    break;
+                }
+                t->drain();
+            }
+            usleep(kDrainIntervalMicros);
+        }
+        return NULL;
+    }
+
+    bool Tracer::start(const std::string& fname){
+        MutexLock l(&file_mutex_);
+        if(running_){
+            return false;
+        }
+        file_=fopen(fname.c_str(),"wb");
+        if(file_==NULL){
+            printf("error:open trace file %s failed!\n",fname.c_str());
+            return false;
+        }
+        fwrite(kTraceMagic,sizeof(kTraceMagic),1,file_);
+        drain();            //events left from an earlier trace are not written twice
+        running_=true;
+        if(pthread_create(&drainer_thread_,NULL,&Tracer::drainer,this)!=0){
+            printf("error:start trace drainer failed!\n");
+            running_=false;
+            fclose(file_);
+            file_=NULL;
+            return false;
+        }
+        enabled_.store(true,std::memory_order_release);
+        return true;
+    }
+
+    void Tracer::stop(){
+        {
+            MutexLock l(&file_mutex_);
+            if(!running_){
+                return;
+            }
+            enabled_.store(false,std::memory_order_release);
+            running_=false;
+        }
+        pthread_join(drainer_thread_,NULL);
+        MutexLock l(&file_mutex_);
+        drain();
+        fclose(file_);
+        file_=NULL;
+    }
+
+    uint64_t Tracer::get_dropped(){
+        uint64_t dropped=0;
+        MutexLock l(&rings_mutex_);
+        for(size_t i=0;i<rings_.size();i++){
+            dropped += rings_[i]->dropped.load(std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+}
@@ -0,0 +1,100 @@
+#ifndef LEVELDB_HM_TRACER_H
+#define LEVELDB_HM_TRACER_H
+
+//////
+//Module function: binary event trace of zone and compaction activity
+//////
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../port/port.h"
+
+namespace leveldb{
+
+    enum TraceEventType {
+        kTraceZoneAlloc = 1,     //level, arg0 zone
+        kTraceZoneFree,          //level, arg0 zone
+        kTraceZoneMove,          //level to, arg0 zone, arg1 level from, arg2 tables
+        kTraceTableWrite,        //level, arg0 table, arg1 zone, arg2 sector offset, arg3 size
+        kTraceTableDelete,       //level, arg0 table, arg1 zone, arg3 size
+        kTraceTableMove,         //level to, arg0 table, arg1 zone, arg2 level from, arg3 size
+        kTraceWindow,            //level, arg0 window zones, arg1 level zones
+        kTraceFlushBegin,        //level 0
+        kTraceFlushEnd,          //level 0, arg0 table, arg1 size, arg2 micros
+        kTraceCompactionBegin,   //level, arg0 files at level, arg1 files at level+1
+        kTraceCompactionEnd,     //level, arg0 read bytes, arg1 written bytes, arg2 micros
+        kTraceMergeBegin,        //window level, arg0 input ranges
+        kTraceMergeEnd,          //window level, arg0 micros
+        kTraceInstall,           //level, arg0 output files, arg1 micros
+        kNumTraceEventTypes
+    };
+
+    struct TraceEvent {      //48 bytes, stored in the trace file as they are in memory
+        uint64_t micros;
+        uint16_t type;
+        int16_t level;
+        uint32_t thread;     //ring of the recording thread
+        uint64_t arg[4];
+    };
+
+    static const char kTraceMagic[8] = {'G','E','A','R','T','R','C','1'};   //trace file header
+
+    //Each recording thread owns a ring that only it writes and only the
+    //drainer reads, so recording is a few stores and no lock. A full ring
+    //drops the event and counts it rather than block the I/O path.
+    class Tracer {
+    public:
+        static Tracer* global();
+
+        bool start(const std::string& fname);   //opens the file and starts the drainer
+        void stop();                            //drains what is left and closes the file
+        bool enabled(){ return enabled_.load(std::memory_order_relaxed); };
+
+        void record(TraceEventType type,int level,uint64_t a0=0,uint64_t a1=0,uint64_t a2=0,uint64_t a3=0);
+        uint64_t get_dropped();
+
+    private:
+        enum { kRingSize = 4096 };
+        struct Ring {
+            TraceEvent events[kRingSize];
+            std::atomic<uint64_t> head;    //written by the owner thread
+            std::atomic<uint64_t> tail;    //written by the drainer
+            std::atomic<uint64_t> dropped;
+            uint32_t id;
+        };
+
+        Tracer();
+        ~Tracer();
+
+        Ring* thread_ring();
+        void drain();           //REQUIRES: file_mutex_ held
+        static void* drainer(void* arg);
+
+        std::atomic<bool> enabled_;
+        port::Mutex rings_mutex_;
+        std::vector<Ring*> rings_;   //never freed, threads may still hold them
+
+        port::Mutex file_mutex_;
+        FILE* file_;
+        bool running_;
+        pthread_t drainer_thread_;
+
+        //No copying allowed
+        Tracer(const Tracer&);
+        void operator=(const Tracer&);
+    };
+
+    inline void trace_event(TraceEventType type,int level,uint64_t a0=0,uint64_t a1=0,uint64_t a2=0,uint64_t a3=0){
+        Tracer* t=Tracer::global();
+        if(t->enabled()){
+            t->record(type,level,a0,a1,a2,a3);
+        }
+    }
+
+}
+
+#endif
@@ -187,7 +187,9 @@ LEVELDB_EXPORT void leveldb_options_set_block_restart_interval(
 
 enum {
   leveldb_no_compression = 0,
-  leveldb_snappy_compression = 1
+  leveldb_snappy_compression = 1,
+  leveldb_lz4_compression = 2,
+  leveldb_zstd_compression = 3
 };
 LEVELDB_EXPORT void leveldb_options_set_compression(leveldb_options_t*, int);
 
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <vector>
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 #include "leveldb/options.h"
@@ -76,6 +77,13 @@ class LEVELDB_EXPORT DB {
   // Note: consider setting options.sync = true.
   virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
 
+  // Remove the database entries (if any) for every key in [begin, end),
+  // as of now.  Returns OK on success, and a non-OK status on error.  It
+  // is an error if "begin" does not sort before "end".
+  // Note: consider setting options.sync = true.
+  virtual Status DeleteRange(const WriteOptions& options,
+                             const Slice& begin, const Slice& end) = 0;
+
   // Apply the specified updates to the database.
   // Returns OK on success, non-OK on failure.
   // Note: consider setting options.sync = true.
@@ -91,6 +99,20 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key, std::string* value) = 0;
 
+  // Batched form of Get().  Looks up every key in "keys" against a single
+  // consistent view of the database and stores the result for keys[i] in
+  // (*values)[i] and the returned status vector's i-th entry, with the
+  // same meaning as the value and status of the corresponding Get().
+  //
+  // All keys are first resolved against the memtables and the file
+  // metadata; the remaining table probes are then issued level by level,
+  // sorted by their physical location on the drive, so that a batch of
+  // lookups sweeps the head across the disk instead of seeking in key
+  // order.  *values is resized to keys.size().
+  virtual std::vector<Status> MultiGet(const ReadOptions& options,
+                                       const std::vector<Slice>& keys,
+                                       std::vector<std::string>* values) = 0;
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -125,8 +147,29 @@ class LEVELDB_EXPORT DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.compaction-micros" - returns the time spent in memtable
+  //     flushes and compactions since the DB was opened, the sum of the
+  //     Time column of "leveldb.stats" in microseconds.
+  //  "leveldb.zone-fill" - returns one line per level: the level, the percent
+  //     of the bytes written to its zones that still hold live tables, and
+  //     the free bytes left in the zone it is writing.
+  //  "leveldb.zone-stats" - returns a multi-line string with the zone and
+  //     table counters of the drive, one line per level and one per zone.
+  //  "leveldb.zone-valid-histogram" - returns the number of zones of each
+  //     level by percent of live data, in steps of 10%.
+  //  "leveldb.window-stats" - returns the compaction window of each level.
+  //  "leveldb.zone-stats-json" - returns all of the above, plus the queueing
+  //     statistics of each zone I/O class, as one JSON object.
+  //  "leveldb.latency" - returns count, average, p50, p99, p999 and maximum
+  //     latency in microseconds of zone reads, writes, resets and
+  //     allocations, of memtable flushes and of each gear compaction phase.
+  //  "leveldb.latency-json" - returns the same as a JSON object.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
+  // Clear the latency histograms and the zone I/O queueing statistics, so
+  // the properties above describe only what happens from now on.
+  virtual void ResetStats() { }
+
   // For each i in [0,n-1], store in "sizes[i]", the approximate
   // file system space used by keys in "[range[i].start .. range[i].limit)".
   //
@@ -219,6 +219,10 @@ class LEVELDB_EXPORT RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
 
+  // Returns the whole file if the implementation already holds it in
+  // memory, else NULL.  The buffer stays valid while the file is live.
+  virtual const char* Getbuf() const { return NULL; }
+
  private:
   // No copying allowed
   RandomAccessFile(const RandomAccessFile&);
@@ -65,6 +65,19 @@ class LEVELDB_EXPORT FilterPolicy {
 // FilterPolicy (like NewBloomFilterPolicy) that does not ignore
 // trailing spaces in keys.
 LEVELDB_EXPORT const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+
+// Return a new filter policy that uses a blocked bloom filter: all the
+// bits of a key fall in one 64-byte block, so a lookup touches a single
+// cache line instead of one per probe.  Its false positive rate is about
+// the same (~1% at 10 bits per key), but each filter is rounded up to
+// whole 64-byte blocks once it holds more than a few dozen keys.
+// Filters made with any bits_per_key can be read by any instance, so
+// instances with different bits_per_key may be used for different levels
+// (see Options::filter_policy_per_level).
+//
+// The same notes as for NewBloomFilterPolicy() apply.
+LEVELDB_EXPORT const FilterPolicy* NewBlockedBloomFilterPolicy(
+    int bits_per_key);
 }
 
 #endif  // STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
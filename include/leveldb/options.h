@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <stddef.h>
+#include <vector>
 #include "leveldb/export.h"
 
 namespace leveldb {
@@ -15,6 +16,8 @@ class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class Slice;
+class SliceTransform;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -25,7 +28,9 @@ enum CompressionType {
   // NOTE: do not change the values of existing entries, as these are
   // part of the persistent format on disk.
   kNoCompression     = 0x0,
-  kSnappyCompression = 0x1
+  kSnappyCompression = 0x1,
+  kLZ4Compression    = 0x2,
+  kZstdCompression   = 0x3
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -113,6 +118,16 @@ struct LEVELDB_EXPORT Options {
   // Default: 16
   int block_restart_interval;
 
+  // If true, each data block carries a small hash index from user key to
+  // restart interval (about one byte per distinct key), so that a point
+  // lookup goes straight to the right interval instead of binary searching
+  // the restart array.  Keys must carry leveldb's 8 byte internal key
+  // trailer, as in all tables written by a DB.  Tables without the index
+  // remain readable, but tables with it cannot be read by older releases.
+  //
+  // Default: false
+  bool data_block_hash_index;
+
   // Leveldb will write up to this amount of bytes to a file before
   // switching to a new one.
   // Most clients should leave this parameter alone.  However if your
@@ -141,6 +156,34 @@ struct LEVELDB_EXPORT Options {
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression;
 
+  // If non-empty, the tables written to level L are compressed with
+  // compression_per_level[L], or with the last entry for the levels past
+  // the end, instead of with "compression".  Memtable flushes use the
+  // entry of level 0.  The upper levels are rewritten often and want a
+  // fast codec (kLZ4Compression); the bottom levels hold most of the
+  // bytes and gain capacity from a stronger one (kZstdCompression).
+  // A codec this build does not support stores its blocks uncompressed.
+  //
+  // Default: empty
+  std::vector<CompressionType> compression_per_level;
+
+  // If positive, each compaction that writes kZstdCompression tables
+  // trains a Zstandard dictionary of at most this many bytes from the data
+  // blocks of its first output, and compresses the data blocks of its
+  // later outputs with it.  Each table stores the dictionary it used.
+  //
+  // Default: 0 (no dictionary)
+  int zstd_max_dict_bytes;
+
+  // If positive, data blocks are compressed and checksummed by a pool of
+  // this many worker threads, shared by all tables being built, while the
+  // thread writing the table fills the next block.  Blocks are still
+  // written in order, so the table is the same as with 0, which
+  // compresses each block inline.  Only read when a table is started.
+  //
+  // Default: 0
+  int compression_threads;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
@@ -154,6 +197,37 @@ struct LEVELDB_EXPORT Options {
   // Default: NULL
   const FilterPolicy* filter_policy;
 
+  // If non-empty, the tables written to level L get their filters from
+  // filter_policy_per_level[L], or from the last entry for the levels past
+  // the end, instead of from filter_policy; a NULL entry means
+  // filter_policy.  Memtable flushes use the entry of level 0.  Reads
+  // always use filter_policy, so every entry must have its Name(); e.g.
+  // NewBlockedBloomFilterPolicy() with more bits per key for the bottom
+  // levels, which serve most of the reads that reach the disk.
+  // Ignored if filter_policy is NULL.
+  //
+  // Default: empty
+  std::vector<const FilterPolicy*> filter_policy_per_level;
+
+  // If non-NULL, the filters also hold the prefix of every key, as given
+  // by the extractor, so that iterators opened with
+  // ReadOptions::prefix_same_as_start skip the tables without the prefix
+  // they were positioned at.  Without a filter_policy such iterators are
+  // still bounded to the prefix but cannot skip any table.
+  // E.g. NewFixedPrefixTransform() from "leveldb/slice_transform.h".
+  //
+  // Default: NULL
+  const SliceTransform* prefix_extractor;
+
+  // If positive, memtable flushes append every value of at least this many
+  // bytes to the value log zones and store only a small pointer to it in
+  // the tables, so compactions rewrite the keys but not the large values.
+  // A value log zone is reset once no table points into it any more.
+  // Reads of a separated value cost one more device read.
+  //
+  // Default: 0 (values are kept in the tables)
+  size_t value_separation_threshold;
+
   // Create an Options object with default values for all fields.
   Options();
 };
@@ -177,10 +251,26 @@ struct LEVELDB_EXPORT ReadOptions {
   // Default: NULL
   const Snapshot* snapshot;
 
+  // If non-NULL, iterators stop before the first key >= *iterate_upper_bound
+  // and do not open the tables that only hold such keys.  The slice must
+  // stay valid until the iterator is deleted.
+  // Default: NULL
+  const Slice* iterate_upper_bound;
+
+  // If true and Options::prefix_extractor is set, an iterator positioned
+  // by Seek() only returns the keys sharing the prefix of the seek target,
+  // and consults the prefix filters to skip the tables holding none.
+  // The order and contents beyond the prefix are then unspecified until
+  // the next Seek(); SeekToFirst() and SeekToLast() are unaffected.
+  // Default: false
+  bool prefix_same_as_start;
+
   ReadOptions()
       : verify_checksums(false),
         fill_cache(true),
-        snapshot(NULL) {
+        snapshot(NULL),
+        iterate_upper_bound(NULL),
+        prefix_same_as_start(false) {
   }
 };
 
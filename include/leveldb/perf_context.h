@@ -0,0 +1,52 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// PerfContext counts the work done by the reads of the calling thread:
+// how many tables a lookup probed, what the filters and the block cache
+// answered, and how much of the drive it touched.  Counting is off by
+// default and is switched on per thread.
+//
+//   leveldb::SetPerfContextEnabled(true);
+//   leveldb::GetPerfContext()->Reset();
+//   db->Get(...);
+//   printf("%s\n", leveldb::GetPerfContext()->ToString().c_str());
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+#define STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+
+#include <stdint.h>
+#include <string>
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+struct LEVELDB_EXPORT PerfContext {
+  uint64_t table_probes;        // Tables searched by Get() and MultiGet()
+  uint64_t filter_hits;         // Filter said the key may be in the block
+  uint64_t filter_misses;       // Filter ruled the block out, no read needed
+  uint64_t prefix_filter_hits;    // Prefix seek may find the prefix in a table
+  uint64_t prefix_filter_misses;  // Prefix seek skipped the table
+  uint64_t block_cache_hits;
+  uint64_t block_cache_misses;  // Includes reads done without a block cache
+  uint64_t device_reads;        // Reads issued to the zoned drive
+  uint64_t device_read_bytes;
+  uint64_t zones_touched;       // Distinct zones read, summed over operations
+  uint64_t io_wait_micros;      // Time spent waiting for device reads
+
+  void Reset();
+  void Merge(const PerfContext& other);
+  std::string ToString() const;
+};
+
+// Counting is per thread; it costs a branch per event when disabled.
+LEVELDB_EXPORT void SetPerfContextEnabled(bool enabled);
+LEVELDB_EXPORT bool PerfContextEnabled();
+
+// Returns the calling thread's context.  It is never shared, so it may be
+// read and reset without synchronization.
+LEVELDB_EXPORT PerfContext* GetPerfContext();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
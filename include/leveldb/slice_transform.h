@@ -0,0 +1,62 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A database can be configured with a prefix extractor, a SliceTransform
+// that maps a user key to its prefix.  The prefixes are added to the
+// table filters, so that an iterator scanning a single prefix (see
+// ReadOptions::prefix_same_as_start) skips the tables and levels that hold
+// no key with that prefix.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <stddef.h>
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+class Slice;
+
+// The prefix of a key must be a prefix of its bytes, and the keys sharing
+// a prefix must be adjacent in the comparator order, as they are with the
+// default bytewise comparator.
+class LEVELDB_EXPORT SliceTransform {
+ public:
+  virtual ~SliceTransform();
+
+  // Return the name of this transform.  It is stored in every table whose
+  // filter holds the prefixes, which are only used while the configured
+  // extractor has the same name, so the name must change whenever the
+  // prefixes it produces do.
+  virtual const char* Name() const = 0;
+
+  // Return true if "key" has a prefix.  Keys outside the domain are
+  // filtered on the whole key only.
+  virtual bool InDomain(const Slice& key) const = 0;
+
+  // Return the prefix of "key".
+  // REQUIRES: InDomain(key)
+  virtual Slice Transform(const Slice& key) const = 0;
+};
+
+// Return a new transform whose prefix is the first "prefix_len" bytes of
+// the key; shorter keys have none.
+//
+// Callers must delete the result after any database that is using the
+// result has been closed.
+LEVELDB_EXPORT const SliceTransform* NewFixedPrefixTransform(
+    size_t prefix_len);
+
+// Return a new transform whose prefix runs up to and including the
+// "fields"-th occurrence of "delimiter"; keys with fewer delimiters have
+// none.  E.g. ('|', 2) maps "tenant|entity|timestamp" to "tenant|entity|".
+//
+// Callers must delete the result after any database that is using the
+// result has been closed.
+LEVELDB_EXPORT const SliceTransform* NewDelimitedPrefixTransform(
+    char delimiter, int fields);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
@@ -56,12 +56,23 @@ class LEVELDB_EXPORT Table {
   // be close to the file length.
   uint64_t ApproximateOffsetOf(const Slice& key) const;
 
+  // If the file holds the whole table in memory (see
+  // RandomAccessFile::Getbuf), verify the checksums of all data blocks in
+  // one pass and return true if they match.  Reads asking for
+  // verify_checksums then skip the per-block check.  Returns false if the
+  // table is not in memory or a block is corrupt, in which case each block
+  // is still verified when it is read.  The outcome is remembered.
+  bool VerifyChecksums() const;
+
  private:
   struct Rep;
   Rep* rep_;
 
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+  static Iterator* NewBlockIterator(Table* table, const ReadOptions& options,
+                                    const Slice& index_value,
+                                    bool point_lookup);
 
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
@@ -73,8 +84,14 @@ class LEVELDB_EXPORT Table {
       void (*handle_result)(void* arg, const Slice& k, const Slice& v));
 
 
+  // Returns false if the filter proves that the table holds no key >= target
+  // in the prefix whose filter entry is filter_key.
+  // REQUIRES: target has that prefix.
+  bool PrefixMayMatch(const Slice& target, const Slice& filter_key);
+
   void ReadMeta(const Footer& footer);
   void ReadFilter(const Slice& filter_handle_value);
+  void ReadCompressionDictionary(const Slice& dict_handle_value);
 
   // No copying allowed
   Table(const Table&);
@@ -75,6 +75,24 @@ class LEVELDB_EXPORT TableBuilder {
   // Finish() call, returns the size of the final generated file.
   uint64_t FileSize() const;
 
+  // Compress the data blocks with this Zstandard dictionary, which is
+  // stored in the table for its readers.  Ignored unless the table is
+  // written with kZstdCompression.
+  // REQUIRES: Add() has not been called
+  void SetCompressionDictionary(const Slice& dict);
+
+  // Train a dictionary of at most options.zstd_max_dict_bytes from the
+  // data blocks written so far and store it in *dict.  Returns false if
+  // the table is not written with kZstdCompression, already has a
+  // dictionary, or training failed.
+  bool TrainCompressionDictionary(std::string* dict) const;
+
+  // Bytes of the data blocks before and after compression, and the time
+  // spent compressing them.
+  uint64_t RawDataSize() const;
+  uint64_t StoredDataSize() const;
+  uint64_t CompressionMicros() const;
+
  private:
   bool ok() const { return status().ok(); }
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
@@ -122,6 +122,40 @@ extern bool Snappy_GetUncompressedLength(const char* input, size_t length,
 extern bool Snappy_Uncompress(const char* input_data, size_t input_length,
                               char* output);
 
+// Append the LZ4 compression of "input[0,input_length-1]" to *output.
+// Returns false if LZ4 is not supported by this port.
+extern bool LZ4_Compress(const char* input, size_t input_length,
+                         std::string* output);
+
+// Attempt to LZ4 uncompress input[0,input_length-1] into
+// output[0,output_length-1].  Returns false unless exactly
+// "output_length" bytes were produced.
+extern bool LZ4_Uncompress(const char* input_data, size_t input_length,
+                           char* output, size_t output_length);
+
+// Append the Zstandard compression of "input[0,input_length-1]" to
+// *output, using the dictionary dict[0,dict_length-1] if dict_length is
+// non-zero.  Returns false if Zstandard is not supported by this port.
+extern bool Zstd_Compress(const char* input, size_t input_length,
+                          const char* dict, size_t dict_length,
+                          std::string* output);
+
+// Attempt to Zstandard uncompress input[0,input_length-1] with the
+// dictionary it was compressed with into output[0,output_length-1].
+// Returns false unless exactly "output_length" bytes were produced.
+extern bool Zstd_Uncompress(const char* input_data, size_t input_length,
+                            const char* dict, size_t dict_length,
+                            char* output, size_t output_length);
+
+// Train a Zstandard dictionary of at most "max_dict_length" bytes from
+// the samples concatenated in "samples", whose lengths are listed in
+// "sample_lengths", and store it in *dict.  Returns false if there are
+// too few samples or Zstandard is not supported by this port.
+extern bool Zstd_TrainDictionary(const std::string& samples,
+                                 const std::vector<size_t>& sample_lengths,
+                                 size_t max_dict_length,
+                                 std::string* dict);
+
 // ------------------ Miscellaneous -------------------
 
 // If heap profiling is not supported, returns false.
@@ -135,6 +169,14 @@ extern bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg);
 // the newly extended CRC value (which may also be zero).
 uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size);
 
+// Set crcs[i] to the CRC of the first n[i] bytes of data[i] for i < count,
+// working on several buffers at once to hide the latency of the CRC
+// instruction.
+//
+// Returns false without touching crcs if acceleration is not available.
+bool AcceleratedCRC32CMulti(const char* const* data, const size_t* n,
+                            int count, uint32_t* crcs);
+
 }  // namespace port
 }  // namespace leveldb
 
@@ -45,8 +45,16 @@
 #ifdef HAVE_SNAPPY
 #include <snappy.h>
 #endif  // defined(HAVE_SNAPPY)
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif  // defined(HAVE_LZ4)
+#ifdef HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif  // defined(HAVE_ZSTD)
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include "port/atomic_pointer.h"
 
 #ifndef PLATFORM_IS_LITTLE_ENDIAN
@@ -138,11 +146,131 @@ inline bool Snappy_Uncompress(const char* input, size_t length,
 #endif  // defined(HAVE_SNAPPY)
 }
 
+#ifdef HAVE_LZ4
+inline bool LZ4_Compress(const char* input, size_t length,
+                         ::std::string* output) {
+  size_t start = output->size();
+  output->resize(start + LZ4_compressBound(length));
+  int outlen = LZ4_compress_default(input, &(*output)[start], length,
+                                    output->size() - start);
+  if (outlen <= 0) {
+    return false;
+  }
+  output->resize(start + outlen);
+  return true;
+}
+
+inline bool LZ4_Uncompress(const char* input, size_t length,
+                           char* output, size_t output_length) {
+  return LZ4_decompress_safe(input, output, length, output_length) ==
+         static_cast<int>(output_length);
+}
+#else
+inline bool LZ4_Compress(const char* /*input*/, size_t /*length*/,
+                         ::std::string* /*output*/) {
+  return false;
+}
+
+inline bool LZ4_Uncompress(const char* /*input*/, size_t /*length*/,
+                           char* /*output*/, size_t /*output_length*/) {
+  return false;
+}
+#endif  // defined(HAVE_LZ4)
+
+#ifdef HAVE_ZSTD
+// Contexts are reused by each thread; creating one per block would cost
+// more than compressing it.
+inline ZSTD_CCtx* Zstd_ThreadCCtx() {
+  static __thread ZSTD_CCtx* cctx = NULL;
+  if (cctx == NULL) cctx = ZSTD_createCCtx();
+  return cctx;
+}
+
+inline ZSTD_DCtx* Zstd_ThreadDCtx() {
+  static __thread ZSTD_DCtx* dctx = NULL;
+  if (dctx == NULL) dctx = ZSTD_createDCtx();
+  return dctx;
+}
+
+inline bool Zstd_Compress(const char* input, size_t length,
+                          const char* dict, size_t dict_length,
+                          ::std::string* output) {
+  size_t start = output->size();
+  output->resize(start + ZSTD_compressBound(length));
+  size_t outlen = ZSTD_compress_usingDict(
+      Zstd_ThreadCCtx(), &(*output)[start], output->size() - start,
+      input, length, dict, dict_length, ZSTD_CLEVEL_DEFAULT);
+  if (ZSTD_isError(outlen)) {
+    return false;
+  }
+  output->resize(start + outlen);
+  return true;
+}
+
+inline bool Zstd_Uncompress(const char* input, size_t length,
+                            const char* dict, size_t dict_length,
+                            char* output, size_t output_length) {
+  size_t n = ZSTD_decompress_usingDict(Zstd_ThreadDCtx(), output,
+                                       output_length, input, length,
+                                       dict, dict_length);
+  return !ZSTD_isError(n) && n == output_length;
+}
+
+inline bool Zstd_TrainDictionary(const ::std::string& samples,
+                                 const ::std::vector<size_t>& sample_lengths,
+                                 size_t max_dict_length,
+                                 ::std::string* dict) {
+  if (sample_lengths.empty()) {
+    return false;
+  }
+  dict->resize(max_dict_length);
+  size_t n = ZDICT_trainFromBuffer(&(*dict)[0], max_dict_length,
+                                   samples.data(), &sample_lengths[0],
+                                   sample_lengths.size());
+  if (ZDICT_isError(n)) {
+    dict->clear();
+    return false;
+  }
+  dict->resize(n);
+  return true;
+}
+#else
+inline bool Zstd_Compress(const char* /*input*/, size_t /*length*/,
+                          const char* /*dict*/, size_t /*dict_length*/,
+                          ::std::string* /*output*/) {
+  return false;
+}
+
+inline bool Zstd_Uncompress(const char* /*input*/, size_t /*length*/,
+                            const char* /*dict*/, size_t /*dict_length*/,
+                            char* /*output*/, size_t /*output_length*/) {
+  return false;
+}
+
+inline bool Zstd_TrainDictionary(
+    const ::std::string& /*samples*/,
+    const ::std::vector<size_t>& /*sample_lengths*/,
+    size_t /*max_dict_length*/, ::std::string* /*dict*/) {
+  return false;
+}
+#endif  // defined(HAVE_ZSTD)
+
 inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   return false;
 }
 
+// In-tree CRC32C kernels using the SSE4.2 (x86-64) or ARMv8 CRC32 (aarch64)
+// instructions, compiled for those targets regardless of the build flags and
+// selected at runtime.  Defined in port_posix.cc.
+bool HasHardwareCRC32C();
+uint32_t HardwareCRC32C(uint32_t crc, const char* buf, size_t size);
+void HardwareCRC32CMulti(const char* const* data, const size_t* n, int count,
+                         uint32_t* crcs);
+
 inline uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
+  if (HasHardwareCRC32C()) {
+    return HardwareCRC32C(crc, buf, size);
+  }
 #if defined(HAVE_CRC32C)
   return ::crc32c::Extend(crc, reinterpret_cast<const uint8_t*>(buf), size);
 #else
@@ -150,6 +278,15 @@ inline uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
 #endif  // defined(HAVE_CRC32C)
 }
 
+inline bool AcceleratedCRC32CMulti(const char* const* data, const size_t* n,
+                                   int count, uint32_t* crcs) {
+  if (!HasHardwareCRC32C()) {
+    return false;
+  }
+  HardwareCRC32CMulti(data, n, count, crcs);
+  return true;
+}
+
 }  // namespace port
 }  // namespace leveldb
 
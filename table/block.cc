@@ -15,25 +15,43 @@
 
 namespace leveldb {
 
-inline uint32_t Block::NumRestarts() const {
-  assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
-}
-
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
+      num_restarts_(0),
+      hash_buckets_(NULL),
+      num_hash_buckets_(0),
       owned_(contents.heap_allocated) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    size_t max_restarts_allowed = (size_-sizeof(uint32_t)) / sizeof(uint32_t);
-    if (NumRestarts() > max_restarts_allowed) {
-      // The size is too small for NumRestarts()
+    return;
+  }
+  size_t trailer = sizeof(uint32_t);
+  num_restarts_ = DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  if ((num_restarts_ & kBlockHashIndexFlag) != 0) {
+    num_restarts_ &= ~kBlockHashIndexFlag;
+    trailer += sizeof(uint16_t);
+    if (size_ < trailer) {
       size_ = 0;
-    } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
+    }
+    const unsigned char* p =
+        reinterpret_cast<const unsigned char*>(data_ + size_ - trailer);
+    num_hash_buckets_ = p[0] | (static_cast<uint32_t>(p[1]) << 8);
+    trailer += num_hash_buckets_;
+    if (size_ < trailer || num_hash_buckets_ == 0 ||
+        num_restarts_ > kBlockHashMaxRestarts) {
+      size_ = 0;
+      return;
     }
+    hash_buckets_ = data_ + size_ - trailer;
+  }
+  size_t max_restarts_allowed = (size_ - trailer) / sizeof(uint32_t);
+  if (num_restarts_ > max_restarts_allowed) {
+    // The size is too small for num_restarts_
+    size_ = 0;
+  } else {
+    restart_offset_ = size_ - trailer - num_restarts_ * sizeof(uint32_t);
   }
 }
 
@@ -79,6 +97,8 @@ class Block::Iter : public Iterator {
   const char* const data_;      // underlying block contents
   uint32_t const restarts_;     // Offset of restart array (list of fixed32)
   uint32_t const num_restarts_; // Number of uint32_t entries in restart array
+  const char* const buckets_;   // Hash index, or NULL if Seek() must not use it
+  uint32_t const num_buckets_;
 
   // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
   uint32_t current_;
@@ -115,11 +135,15 @@ class Block::Iter : public Iterator {
   Iter(const Comparator* comparator,
        const char* data,
        uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts,
+       const char* buckets,
+       uint32_t num_buckets)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
+        buckets_(buckets),
+        num_buckets_(num_buckets),
         current_(restarts_),
         restart_index_(num_restarts_) {
     assert(num_restarts_ > 0);
@@ -163,6 +187,28 @@ class Block::Iter : public Iterator {
   }
 
   virtual void Seek(const Slice& target) {
+    if (buckets_ != NULL && target.size() >= 8) {
+      const uint8_t bucket = static_cast<uint8_t>(
+          buckets_[BlockHashIndexHash(target) % num_buckets_]);
+      if (bucket == kBlockHashNoEntry) {
+        // No entry has this user key
+        current_ = restarts_;
+        restart_index_ = num_restarts_;
+        return;
+      }
+      if (bucket != kBlockHashCollision) {
+        if (bucket >= num_restarts_) {
+          CorruptionError();
+          return;
+        }
+        SeekToRestartPoint(bucket);
+        while (ParseNextKey() && Compare(key_, target) < 0) {
+          // Keep skipping
+        }
+        return;
+      }
+    }
+
     // Binary search in restart array to find the last restart point
     // with a key < target
     uint32_t left = 0;
@@ -257,11 +303,22 @@ Iterator* Block::NewIterator(const Comparator* cmp) {
   if (size_ < sizeof(uint32_t)) {
     return NewErrorIterator(Status::Corruption("bad block contents"));
   }
-  const uint32_t num_restarts = NumRestarts();
-  if (num_restarts == 0) {
+  if (num_restarts_ == 0) {
+    return NewEmptyIterator();
+  } else {
+    return new Iter(cmp, data_, restart_offset_, num_restarts_, NULL, 0);
+  }
+}
+
+Iterator* Block::NewPointLookupIterator(const Comparator* cmp) {
+  if (size_ < sizeof(uint32_t)) {
+    return NewErrorIterator(Status::Corruption("bad block contents"));
+  }
+  if (num_restarts_ == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(cmp, data_, restart_offset_, num_restarts);
+    return new Iter(cmp, data_, restart_offset_, num_restarts_,
+                    hash_buckets_, num_hash_buckets_);
   }
 }
 
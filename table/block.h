@@ -24,12 +24,18 @@ class Block {
   size_t size() const { return size_; }
   Iterator* NewIterator(const Comparator* comparator);
 
- private:
-  uint32_t NumRestarts() const;
+  // Like NewIterator(), but Seek() may use the block's hash index: if no
+  // entry has the user key of the target, it leaves the iterator invalid
+  // instead of at the next larger key.  Meant for point lookups.
+  Iterator* NewPointLookupIterator(const Comparator* comparator);
 
+ private:
   const char* data_;
   size_t size_;
   uint32_t restart_offset_;     // Offset in data_ of restart array
+  uint32_t num_restarts_;
+  const char* hash_buckets_;    // Hash index, see block_builder.cc
+  uint32_t num_hash_buckets_;   // 0 if the block has no hash index
   bool owned_;                  // Block owns data_[]
 
   // No copying allowed
@@ -25,6 +25,16 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// With Options::data_block_hash_index the trailer has the form:
+//     restarts: uint32[num_restarts]
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint16
+//     num_restarts | kBlockHashIndexFlag: uint32
+// buckets[BlockHashIndexHash(key) % num_buckets] is the restart point
+// whose interval holds every entry with the user key of "key", or
+// kBlockHashNoEntry if no user key hashes there, or kBlockHashCollision
+// if user keys from different intervals do.
 
 #include "table/block_builder.h"
 
@@ -32,6 +42,7 @@
 #include <assert.h>
 #include "leveldb/comparator.h"
 #include "leveldb/table_builder.h"
+#include "table/format.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -40,7 +51,8 @@ BlockBuilder::BlockBuilder(const Options* options)
     : options_(options),
       restarts_(),
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      hash_index_ok_(true) {
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);       // First restart point is at offset 0
 }
@@ -52,11 +64,18 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_entries_.clear();
+  hash_index_ok_ = true;
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
+  size_t hash_index = 0;
+  if (options_->data_block_hash_index && hash_index_ok_) {
+    hash_index = hash_entries_.size() * 4 / 3 + 1 + sizeof(uint16_t);
+  }
   return (buffer_.size() +                        // Raw data buffer
           restarts_.size() * sizeof(uint32_t) +   // Restart array
+          hash_index +                            // Hash index
           sizeof(uint32_t));                      // Restart array length
 }
 
@@ -65,11 +84,44 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  uint32_t num_restarts = restarts_.size();
+  if (options_->data_block_hash_index && AppendHashIndex()) {
+    num_restarts |= kBlockHashIndexFlag;
+  }
+  PutFixed32(&buffer_, num_restarts);
   finished_ = true;
   return Slice(buffer_);
 }
 
+bool BlockBuilder::AppendHashIndex() {
+  if (!hash_index_ok_ || hash_entries_.empty() ||
+      restarts_.size() > kBlockHashMaxRestarts) {
+    return false;
+  }
+
+  // Aim at buckets about 3/4 full; an odd count spreads the hashes better.
+  size_t num_buckets = hash_entries_.size() * 4 / 3 + 1;
+  if (num_buckets > 0xffff) {
+    num_buckets = 0xffff;
+  }
+  num_buckets |= 1;
+
+  std::string buckets(num_buckets, static_cast<char>(kBlockHashNoEntry));
+  for (size_t i = 0; i < hash_entries_.size(); i++) {
+    char& bucket = buckets[hash_entries_[i].first % num_buckets];
+    const char restart = static_cast<char>(hash_entries_[i].second);
+    if (bucket == static_cast<char>(kBlockHashNoEntry)) {
+      bucket = restart;
+    } else if (bucket != restart) {
+      bucket = static_cast<char>(kBlockHashCollision);
+    }
+  }
+  buffer_.append(buckets);
+  buffer_.push_back(static_cast<char>(num_buckets & 0xff));
+  buffer_.push_back(static_cast<char>(num_buckets >> 8));
+  return true;
+}
+
 void BlockBuilder::Add(const Slice& key, const Slice& value) {
   Slice last_key_piece(last_key_);
   assert(!finished_);
@@ -90,6 +142,24 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (options_->data_block_hash_index && hash_index_ok_) {
+    if (key.size() < 8) {
+      hash_index_ok_ = false;  // Not an internal key
+    } else {
+      // A user key with several sequence numbers is recorded once, unless
+      // its entries straddle two restart intervals.
+      const uint32_t restart = restarts_.size() - 1;
+      Slice user_key(key.data(), key.size() - 8);
+      if (hash_entries_.empty() || last_key_piece.size() < 8 ||
+          Slice(last_key_piece.data(), last_key_piece.size() - 8) !=
+              user_key ||
+          hash_entries_.back().second != restart) {
+        hash_entries_.push_back(
+            std::make_pair(BlockHashIndexHash(key), restart));
+      }
+    }
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
@@ -40,6 +40,10 @@ class BlockBuilder {
   }
 
  private:
+  // Append the hash index over hash_entries_ if the block can carry one.
+  // Returns true if it was appended.
+  bool AppendHashIndex();
+
   const Options*        options_;
   std::string           buffer_;      // Destination buffer
   std::vector<uint32_t> restarts_;    // Restart points
@@ -47,6 +51,11 @@ class BlockBuilder {
   bool                  finished_;    // Has Finish() been called?
   std::string           last_key_;
 
+  // (user key hash, restart index) of each distinct user key, while
+  // hash_index_ok_ says the keys seen so far allow a hash index.
+  std::vector<std::pair<uint32_t, uint32_t> > hash_entries_;
+  bool                  hash_index_ok_;
+
   // No copying allowed
   BlockBuilder(const BlockBuilder&);
   void operator=(const BlockBuilder&);
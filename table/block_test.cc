@@ -0,0 +1,229 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/block.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "util/coding.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+static std::string IKey(const std::string& user_key, SequenceNumber seq) {
+  std::string encoded;
+  AppendInternalKey(&encoded, ParsedInternalKey(user_key, seq, kTypeValue));
+  return encoded;
+}
+
+static std::string LookupKey(const std::string& user_key) {
+  return IKey(user_key, kMaxSequenceNumber);
+}
+
+static std::string UserKey(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "key%05d", i);
+  return std::string(buf);
+}
+
+class BlockTest {
+ public:
+  InternalKeyComparator icmp_;
+  Options options_;
+  std::string contents_;
+  Block* block_;
+
+  BlockTest() : icmp_(BytewiseComparator()), block_(NULL) {
+    options_.comparator = &icmp_;
+    options_.block_restart_interval = 4;
+    options_.data_block_hash_index = true;
+  }
+
+  ~BlockTest() {
+    delete block_;
+  }
+
+  // Builds the block from "keys", which must be sorted internal keys
+  void Build(const std::vector<std::string>& keys) {
+    BlockBuilder builder(&options_);
+    for (size_t i = 0; i < keys.size(); i++) {
+      builder.Add(keys[i], "v" + keys[i].substr(0, keys[i].size() - 8));
+    }
+    contents_ = builder.Finish().ToString();
+    BlockContents contents;
+    contents.data = contents_;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    delete block_;
+    block_ = new Block(contents);
+  }
+
+  // Builds the block from one entry per user key 0..n-1
+  void BuildKeys(int n) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < n; i++) {
+      keys.push_back(IKey(UserKey(i), 100));
+    }
+    Build(keys);
+  }
+
+  bool HasHashIndex() {
+    return (DecodeFixed32(contents_.data() + contents_.size() - 4) &
+            kBlockHashIndexFlag) != 0;
+  }
+
+  uint32_t NumRestarts() {
+    return DecodeFixed32(contents_.data() + contents_.size() - 4) &
+           ~kBlockHashIndexFlag;
+  }
+
+  // The bucket "user_key" hashes to; see block_builder.cc for the layout
+  uint8_t Bucket(const std::string& user_key) {
+    ASSERT_TRUE(HasHashIndex());
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(
+        contents_.data() + contents_.size() - 6);
+    const uint32_t num_buckets = p[0] | (static_cast<uint32_t>(p[1]) << 8);
+    const char* buckets =
+        contents_.data() + contents_.size() - 6 - num_buckets;
+    return static_cast<uint8_t>(
+        buckets[BlockHashIndexHash(LookupKey(user_key)) % num_buckets]);
+  }
+
+  // Returns the key the point lookup iterator finds for user_key, or
+  // "(invalid)"
+  std::string PointLookup(const std::string& user_key) {
+    Iterator* iter = block_->NewPointLookupIterator(&icmp_);
+    iter->Seek(LookupKey(user_key));
+    std::string result = "(invalid)";
+    if (iter->Valid()) {
+      result = iter->key().ToString();
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+    return result;
+  }
+};
+
+TEST(BlockTest, EmptyBucket) {
+  BuildKeys(20);
+  ASSERT_TRUE(HasHashIndex());
+
+  // Find a missing user key whose bucket no key hashes to
+  std::string missing;
+  for (int i = 0; i < 1000 && missing.empty(); i++) {
+    char buf[100];
+    snprintf(buf, sizeof(buf), "key%05d.missing", i);
+    if (Bucket(buf) == kBlockHashNoEntry) {
+      missing = buf;
+    }
+  }
+  ASSERT_TRUE(!missing.empty());
+  ASSERT_EQ("(invalid)", PointLookup(missing));
+}
+
+TEST(BlockTest, SingleIntervalHit) {
+  BuildKeys(40);
+  ASSERT_TRUE(HasHashIndex());
+  int hits = 0;
+  for (int i = 0; i < 40; i++) {
+    const uint8_t bucket = Bucket(UserKey(i));
+    if (bucket != kBlockHashCollision) {
+      ASSERT_EQ(i / options_.block_restart_interval, bucket);
+      hits++;
+    }
+    ASSERT_EQ(IKey(UserKey(i), 100), PointLookup(UserKey(i)));
+  }
+  ASSERT_GT(hits, 0);
+}
+
+TEST(BlockTest, UserKeyStraddlingRestarts) {
+  // "b" has entries in the first and the second restart interval
+  std::vector<std::string> keys;
+  keys.push_back(IKey("a", 100));
+  keys.push_back(IKey("a0", 100));
+  keys.push_back(IKey("a1", 100));
+  keys.push_back(IKey("b", 9));
+  keys.push_back(IKey("b", 8));
+  keys.push_back(IKey("b", 7));
+  keys.push_back(IKey("c", 100));
+  Build(keys);
+  ASSERT_EQ(2, NumRestarts());
+  ASSERT_EQ(kBlockHashCollision, Bucket("b"));
+
+  // The binary search finds the newest entry in the first interval
+  ASSERT_EQ(IKey("b", 9), PointLookup("b"));
+  Iterator* iter = block_->NewPointLookupIterator(&icmp_);
+  iter->Seek(IKey("b", 8));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(IKey("b", 8), iter->key().ToString());
+  delete iter;
+}
+
+TEST(BlockTest, TooManyRestarts) {
+  options_.block_restart_interval = 1;
+  BuildKeys(kBlockHashMaxRestarts);
+  ASSERT_TRUE(HasHashIndex());
+  ASSERT_EQ(kBlockHashMaxRestarts, NumRestarts());
+
+  // One more restart point would not fit below the markers
+  BuildKeys(kBlockHashMaxRestarts + 1);
+  ASSERT_TRUE(!HasHashIndex());
+  ASSERT_EQ(kBlockHashMaxRestarts + 1, NumRestarts());
+  for (int i = 0; i <= static_cast<int>(kBlockHashMaxRestarts); i++) {
+    ASSERT_EQ(IKey(UserKey(i), 100), PointLookup(UserKey(i)));
+  }
+}
+
+TEST(BlockTest, OldFormat) {
+  options_.data_block_hash_index = false;
+  BuildKeys(20);
+  ASSERT_TRUE(!HasHashIndex());
+  ASSERT_EQ(5, NumRestarts());
+
+  // Without an index a point lookup seeks as before
+  ASSERT_EQ(IKey(UserKey(7), 100), PointLookup(UserKey(7)));
+  ASSERT_EQ(IKey(UserKey(8), 100), PointLookup(UserKey(7) + ".missing"));
+  ASSERT_EQ("(invalid)", PointLookup("zzz"));
+}
+
+TEST(BlockTest, IndexedBlockScansNormally) {
+  const int kNum = 30;
+  BuildKeys(kNum);
+  ASSERT_TRUE(HasHashIndex());
+  Iterator* iter = block_->NewIterator(&icmp_);
+
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(IKey(UserKey(i), 100), iter->key().ToString());
+    ASSERT_EQ("v" + UserKey(i), iter->value().ToString());
+  }
+  ASSERT_EQ(kNum, i);
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    i--;
+    ASSERT_EQ(IKey(UserKey(i), 100), iter->key().ToString());
+  }
+  ASSERT_EQ(0, i);
+
+  // A missing key leaves the plain iterator at the next larger key
+  iter->Seek(LookupKey(UserKey(12) + ".missing"));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(IKey(UserKey(13), 100), iter->key().ToString());
+  iter->Seek(LookupKey("zzz"));
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_OK(iter->status());
+  delete iter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
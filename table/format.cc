@@ -9,6 +9,7 @@
 #include "table/block.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -62,10 +63,47 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
+uint32_t BlockHashIndexHash(const Slice& key) {
+  assert(key.size() >= 8);
+  return Hash(key.data(), key.size() - 8, 0x9f1b3c57);
+}
+
+Status VerifyBlockChecksums(const Slice& contents,
+                            const BlockHandle* handles,
+                            size_t count) {
+  static const int kBatch = 32;
+  const char* data[kBatch];
+  size_t n[kBatch];
+  uint32_t actual[kBatch];
+  size_t done = 0;
+  while (done < count) {
+    int batch = 0;
+    for (; batch < kBatch && done + batch < count; batch++) {
+      const BlockHandle& handle = handles[done + batch];
+      if (handle.offset() > contents.size() ||
+          handle.size() + kBlockTrailerSize >
+              contents.size() - handle.offset()) {
+        return Status::Corruption("truncated block read");
+      }
+      data[batch] = contents.data() + handle.offset();
+      n[batch] = static_cast<size_t>(handle.size()) + 1;  // With the type
+    }
+    crc32c::ValueMulti(data, n, batch, actual);
+    for (int i = 0; i < batch; i++) {
+      if (crc32c::Unmask(DecodeFixed32(data[i] + n[i])) != actual[i]) {
+        return Status::Corruption("block checksum mismatch");
+      }
+    }
+    done += batch;
+  }
+  return Status::OK();
+}
+
 Status ReadBlock(RandomAccessFile* file,
                  const ReadOptions& options,
                  const BlockHandle& handle,
-                 BlockContents* result) {
+                 BlockContents* result,
+                 const Slice& compression_dict) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
@@ -133,6 +171,34 @@ Status ReadBlock(RandomAccessFile* file,
       result->cachable = true;
       break;
     }
+    case kLZ4Compression:
+    case kZstdCompression: {
+      Slice input(data, n);
+      uint32_t ulength = 0;
+      if (!GetVarint32(&input, &ulength)) {
+        delete[] buf;
+        return Status::Corruption("corrupted compressed block contents");
+      }
+      char* ubuf = new char[ulength];
+      bool ok;
+      if (data[n] == kLZ4Compression) {
+        ok = port::LZ4_Uncompress(input.data(), input.size(), ubuf, ulength);
+      } else {
+        ok = port::Zstd_Uncompress(input.data(), input.size(),
+                                   compression_dict.data(),
+                                   compression_dict.size(), ubuf, ulength);
+      }
+      if (!ok) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("corrupted compressed block contents");
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
     default:
       delete[] buf;
       return Status::Corruption("bad block type");
@@ -83,18 +83,51 @@ static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+// Data block hash index, see block_builder.cc.  The flag is set in the
+// num_restarts word of blocks that carry one; a bucket holds the restart
+// interval of the keys hashing to it, or one of the two markers.  Restart
+// indices 0..253 fit below the markers, so blocks with up to
+// kBlockHashMaxRestarts restart points get an index and larger blocks keep
+// the plain format.
+static const uint32_t kBlockHashIndexFlag = 1u << 31;
+static const uint8_t kBlockHashNoEntry = 255;
+static const uint8_t kBlockHashCollision = 254;
+static const uint32_t kBlockHashMaxRestarts = 254;
+
+// Hash of "key" in the data block hash index.  Only the user key is
+// hashed, i.e. "key" without its 8 byte internal key trailer, so that a
+// lookup key finds the entries of any sequence number.
+extern uint32_t BlockHashIndexHash(const Slice& key);
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
   bool heap_allocated;  // True iff caller should delete[] data.data()
 };
 
+// Metaindex key of the Zstandard dictionary the data blocks were
+// compressed with, if any.
+static const char kCompressionDictionaryKey[] = "compression.dictionary";
+
+// Metaindex key prefix, followed by SliceTransform::Name(), of the empty
+// entry marking a table whose filter also holds the key prefixes
+static const char kPrefixFilterKeyPrefix[] = "prefix.";
+
 // Read the block identified by "handle" from "file".  On failure
-// return non-OK.  On success fill *result and return OK.
+// return non-OK.  On success fill *result and return OK.  A block
+// compressed with a dictionary needs it in "compression_dict".
 extern Status ReadBlock(RandomAccessFile* file,
                         const ReadOptions& options,
                         const BlockHandle& handle,
-                        BlockContents* result);
+                        BlockContents* result,
+                        const Slice& compression_dict = Slice());
+
+// Verify the checksums of the "count" blocks at "handles" in "contents",
+// a whole table held in memory.  The CRCs of several blocks are computed
+// together, see crc32c::ValueMulti().
+extern Status VerifyBlockChecksums(const Slice& contents,
+                                   const BlockHandle* handles,
+                                   size_t count);
 
 // Implementation details follow.  Clients should ignore,
 
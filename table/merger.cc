@@ -4,6 +4,9 @@
 
 #include "table/merger.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "leveldb/comparator.h"
 #include "leveldb/iterator.h"
 #include "table/iterator_wrapper.h"
@@ -11,6 +14,11 @@
 namespace leveldb {
 
 namespace {
+
+// Below this many children a linear scan for the smallest key is as cheap
+// as replaying a path of the loser tree.
+static const int kLoserTreeMinChildren = 8;
+
 class MergingIterator : public Iterator {
  public:
   MergingIterator(const Comparator* comparator, Iterator** children, int n)
@@ -22,6 +30,10 @@ class MergingIterator : public Iterator {
     for (int i = 0; i < n; i++) {
       children_[i].Set(children[i]);
     }
+    if (n >= kLoserTreeMinChildren) {
+      losers_.resize(n);
+      winners_.resize(n);
+    }
   }
 
   virtual ~MergingIterator() {
@@ -36,24 +48,24 @@ class MergingIterator : public Iterator {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToFirst();
     }
-    FindSmallest();
     direction_ = kForward;
+    FindSmallest();
   }
 
   virtual void SeekToLast() {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToLast();
     }
-    FindLargest();
     direction_ = kReverse;
+    FindLargest();
   }
 
   virtual void Seek(const Slice& target) {
     for (int i = 0; i < n_; i++) {
       children_[i].Seek(target);
     }
-    FindSmallest();
     direction_ = kForward;
+    FindSmallest();
   }
 
   virtual void Next() {
@@ -76,10 +88,17 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kForward;
+      current_->Next();
+      FindSmallest();
+      return;
     }
 
     current_->Next();
-    FindSmallest();
+    if (losers_.empty()) {
+      FindSmallest();
+    } else {
+      ReplayCurrent();
+    }
   }
 
   virtual void Prev() {
@@ -105,10 +124,17 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kReverse;
+      current_->Prev();
+      FindLargest();
+      return;
     }
 
     current_->Prev();
-    FindLargest();
+    if (losers_.empty()) {
+      FindLargest();
+    } else {
+      ReplayCurrent();
+    }
   }
 
   virtual Slice key() const {
@@ -133,16 +159,26 @@ class MergingIterator : public Iterator {
   }
 
  private:
+  // Set current_ after all children moved
   void FindSmallest();
   void FindLargest();
 
-  // We might want to use a heap in case there are lots of children.
-  // For now we use a simple array since we expect a very small number
-  // of children in leveldb.
+  // Loser tree, used for n_ >= kLoserTreeMinChildren: the compactions of
+  // gear levels merge a table per level 0 file and per container.  Leaf i
+  // (child i) is node n_ + i and node p has children 2p and 2p+1, so
+  // nodes 1..n_-1 are internal; losers_[p] holds the child that lost the
+  // match at node p and losers_[0] the overall winner.  A child that moves
+  // only replays the matches on its path to the root.
+  bool Beats(int a, int b) const;
+  void RebuildTree();
+  void ReplayCurrent();
+
   const Comparator* comparator_;
   IteratorWrapper* children_;
   int n_;
   IteratorWrapper* current_;
+  std::vector<int> losers_;  // Empty if the children are scanned linearly
+  std::vector<int> winners_;  // Scratch space of RebuildTree()
 
   // Which direction is the iterator moving?
   enum Direction {
@@ -152,7 +188,60 @@ class MergingIterator : public Iterator {
   Direction direction_;
 };
 
+// Returns true if child a comes out before child b in the current
+// direction.  Exhausted children lose to all others; ties go to the child
+// the linear scans would pick.
+bool MergingIterator::Beats(int a, int b) const {
+  if (!children_[a].Valid()) {
+    return false;
+  }
+  if (!children_[b].Valid()) {
+    return true;
+  }
+  int r = comparator_->Compare(children_[a].key(), children_[b].key());
+  if (direction_ == kForward) {
+    return r < 0 || (r == 0 && a < b);
+  } else {
+    return r > 0 || (r == 0 && a > b);
+  }
+}
+
+void MergingIterator::RebuildTree() {
+  // winners_[p] is the winner of the subtree at internal node p
+  std::vector<int>& winners = winners_;
+  for (int p = n_ - 1; p >= 1; p--) {
+    int left = 2 * p;
+    int right = 2 * p + 1;
+    int a = (left >= n_) ? left - n_ : winners[left];
+    int b = (right >= n_) ? right - n_ : winners[right];
+    if (Beats(b, a)) {
+      winners[p] = b;
+      losers_[p] = a;
+    } else {
+      winners[p] = a;
+      losers_[p] = b;
+    }
+  }
+  losers_[0] = winners[1];
+  current_ = children_[losers_[0]].Valid() ? &children_[losers_[0]] : NULL;
+}
+
+void MergingIterator::ReplayCurrent() {
+  int winner = current_ - children_;
+  for (int p = (winner + n_) / 2; p >= 1; p /= 2) {
+    if (Beats(losers_[p], winner)) {
+      std::swap(winner, losers_[p]);
+    }
+  }
+  losers_[0] = winner;
+  current_ = children_[winner].Valid() ? &children_[winner] : NULL;
+}
+
 void MergingIterator::FindSmallest() {
+  if (!losers_.empty()) {
+    RebuildTree();
+    return;
+  }
   IteratorWrapper* smallest = NULL;
   for (int i = 0; i < n_; i++) {
     IteratorWrapper* child = &children_[i];
@@ -168,6 +257,10 @@ void MergingIterator::FindSmallest() {
 }
 
 void MergingIterator::FindLargest() {
+  if (!losers_.empty()) {
+    RebuildTree();
+    return;
+  }
   IteratorWrapper* largest = NULL;
   for (int i = n_-1; i >= 0; i--) {
     IteratorWrapper* child = &children_[i];
@@ -0,0 +1,214 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/merger.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+typedef std::vector<std::pair<std::string, std::string> > Entries;
+
+// An iterator over a sorted vector of entries
+class VectorIterator : public Iterator {
+ public:
+  explicit VectorIterator(const Entries* entries)
+      : entries_(entries), index_(entries->size()) { }
+
+  virtual bool Valid() const { return index_ < entries_->size(); }
+  virtual void SeekToFirst() { index_ = 0; }
+  virtual void SeekToLast() {
+    index_ = entries_->empty() ? 0 : entries_->size() - 1;
+  }
+  virtual void Seek(const Slice& target) {
+    index_ = 0;
+    while (index_ < entries_->size() &&
+           Slice((*entries_)[index_].first).compare(target) < 0) {
+      index_++;
+    }
+  }
+  virtual void Next() { assert(Valid()); index_++; }
+  virtual void Prev() {
+    assert(Valid());
+    index_ = (index_ == 0) ? entries_->size() : index_ - 1;
+  }
+  virtual Slice key() const { return (*entries_)[index_].first; }
+  virtual Slice value() const { return (*entries_)[index_].second; }
+  virtual Status status() const { return Status::OK(); }
+
+ private:
+  const Entries* entries_;
+  size_t index_;
+};
+
+static std::string Key(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+class MergerTest {
+ public:
+  std::vector<Entries> children_;
+  Entries expected_;   // Every entry, in merged order
+
+  // Spread the keys 2, 4, .., 2 * num_keys over "n" children, leaving the
+  // children listed in "empty" without any.  Odd keys are missing from
+  // every child.  The value of an entry names the child holding it.
+  void Build(int n, const std::vector<int>& empty, int num_keys) {
+    Random rnd(301 + n);
+    children_.assign(n, Entries());
+    std::vector<int> filled;
+    for (int c = 0; c < n; c++) {
+      if (std::find(empty.begin(), empty.end(), c) == empty.end()) {
+        filled.push_back(c);
+      }
+    }
+    expected_.clear();
+    for (int i = 1; i <= num_keys; i++) {
+      const int c = filled[rnd.Uniform(filled.size())];
+      children_[c].push_back(std::make_pair(Key(2 * i), Key(c)));
+      expected_.push_back(children_[c].back());
+    }
+  }
+
+  Iterator* NewIterator() {
+    std::vector<Iterator*> list;
+    for (size_t c = 0; c < children_.size(); c++) {
+      list.push_back(new VectorIterator(&children_[c]));
+    }
+    return NewMergingIterator(BytewiseComparator(), &list[0], list.size());
+  }
+
+  // Index in expected_ of the first entry at or after "target"
+  int LowerBound(const std::string& target) {
+    int i = 0;
+    while (i < static_cast<int>(expected_.size()) &&
+           expected_[i].first < target) {
+      i++;
+    }
+    return i;
+  }
+
+  // Check that "iter" is at expected_[pos], or invalid if out of range
+  void CheckAt(Iterator* iter, int pos) {
+    if (pos < 0 || pos >= static_cast<int>(expected_.size())) {
+      ASSERT_TRUE(!iter->Valid());
+    } else {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(expected_[pos].first, iter->key().ToString());
+      ASSERT_EQ(expected_[pos].second, iter->value().ToString());
+    }
+  }
+
+  void CheckScans() {
+    Iterator* iter = NewIterator();
+    int pos = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), pos++) {
+      CheckAt(iter, pos);
+    }
+    ASSERT_EQ(expected_.size(), pos);
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      CheckAt(iter, --pos);
+    }
+    ASSERT_EQ(0, pos);
+    ASSERT_OK(iter->status());
+    delete iter;
+  }
+
+  // Seek to every key and to the gaps around it, then walk from there
+  // in a random mix of directions.
+  void CheckSeeksAndDirectionSwitches() {
+    Random rnd(17);
+    Iterator* iter = NewIterator();
+    const int num_keys = static_cast<int>(expected_.size());
+    for (int k = 0; k <= 2 * num_keys + 2; k++) {
+      const std::string target = Key(k);
+      iter->Seek(target);
+      int pos = LowerBound(target);
+      CheckAt(iter, pos);
+      for (int step = 0; step < 20 && iter->Valid(); step++) {
+        if (rnd.OneIn(2)) {
+          iter->Next();
+          pos++;
+        } else {
+          iter->Prev();
+          pos--;
+        }
+        CheckAt(iter, pos);
+      }
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+  }
+};
+
+TEST(MergerTest, PowerOfTwoChildren) {
+  Build(8, std::vector<int>(), 500);
+  CheckScans();
+  CheckSeeksAndDirectionSwitches();
+}
+
+TEST(MergerTest, OtherChildCounts) {
+  for (int n = 9; n <= 13; n++) {
+    Build(n, std::vector<int>(), 300);
+    CheckScans();
+    CheckSeeksAndDirectionSwitches();
+  }
+}
+
+TEST(MergerTest, EmptyChildren) {
+  // Empty children at both ends and inside the tree
+  std::vector<int> empty;
+  empty.push_back(0);
+  empty.push_back(3);
+  empty.push_back(4);
+  empty.push_back(10);
+  Build(11, empty, 300);
+  CheckScans();
+  CheckSeeksAndDirectionSwitches();
+
+  // A single child left with entries
+  empty.clear();
+  for (int c = 0; c < 9; c++) {
+    if (c != 5) empty.push_back(c);
+  }
+  Build(9, empty, 50);
+  CheckScans();
+  CheckSeeksAndDirectionSwitches();
+
+  // No entries at all
+  Build(9, std::vector<int>(), 0);
+  CheckScans();
+  Iterator* iter = NewIterator();
+  iter->Seek(Key(1));
+  ASSERT_TRUE(!iter->Valid());
+  delete iter;
+}
+
+TEST(MergerTest, EqualKeys) {
+  // Equal keys come out in child order forwards and the reverse backwards
+  children_.assign(10, Entries());
+  expected_.clear();
+  for (int c = 0; c < 10; c += 3) {
+    children_[c].push_back(std::make_pair(Key(1), Key(c)));
+    expected_.push_back(children_[c].back());
+  }
+  CheckScans();
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
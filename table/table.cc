@@ -4,19 +4,30 @@
 
 #include "leveldb/table.h"
 
+#include <atomic>
+#include <vector>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
+#include "util/perf_context_imp.h"
 
 namespace leveldb {
 
+enum ChecksumState {
+  kChecksumsUnknown,
+  kChecksumsVerified,
+  kChecksumsUnverifiable  // Not in memory, or some block is corrupt
+};
+
 struct Table::Rep {
   ~Rep() {
     delete filter;
@@ -30,9 +41,13 @@ struct Table::Rep {
   uint64_t cache_id;
   FilterBlockReader* filter;
   const char* filter_data;
+  bool prefix_filtered;  // filter also holds the options.prefix_extractor prefixes
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
+  std::string compression_dict;  // Zstandard dictionary of the data blocks
+  uint64_t file_size;
+  std::atomic<int> checksum_state;  // ChecksumState of the data blocks
 };
 
 Status Table::Open(const Options& options,
@@ -76,6 +91,9 @@ Status Table::Open(const Options& options,
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = NULL;
     rep->filter = NULL;
+    rep->prefix_filtered = false;
+    rep->file_size = size;
+    rep->checksum_state.store(kChecksumsUnknown);
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
   }
@@ -84,10 +102,6 @@ Status Table::Open(const Options& options,
 }
 
 void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == NULL) {
-    return;  // Do not need any metadata
-  }
-
   // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
   // it is an empty block.
   ReadOptions opt;
@@ -102,11 +116,23 @@ void Table::ReadMeta(const Footer& footer) {
   Block* meta = new Block(contents);
 
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+  iter->Seek(kCompressionDictionaryKey);
+  if (iter->Valid() && iter->key() == Slice(kCompressionDictionaryKey)) {
+    ReadCompressionDictionary(iter->value());
+  }
+  if (rep_->options.filter_policy != NULL) {
+    std::string key = "filter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value());
+    }
+    if (rep_->filter != NULL && rep_->options.prefix_extractor != NULL) {
+      key = kPrefixFilterKeyPrefix;
+      key.append(rep_->options.prefix_extractor->Name());
+      iter->Seek(key);
+      rep_->prefix_filtered = iter->Valid() && iter->key() == Slice(key);
+    }
   }
   delete iter;
   delete meta;
@@ -135,6 +161,26 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
   rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
 }
 
+void Table::ReadCompressionDictionary(const Slice& dict_handle_value) {
+  Slice v = dict_handle_value;
+  BlockHandle dict_handle;
+  if (!dict_handle.DecodeFrom(&v).ok()) {
+    return;
+  }
+  ReadOptions opt;
+  if (rep_->options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+  BlockContents block;
+  if (!ReadBlock(rep_->file, opt, dict_handle, &block).ok()) {
+    return;  // Its data blocks will fail to decompress
+  }
+  rep_->compression_dict.assign(block.data.data(), block.data.size());
+  if (block.heap_allocated) {
+    delete[] block.data.data();
+  }
+}
+
 Table::~Table() {
   delete rep_;
 }
@@ -154,12 +200,59 @@ static void ReleaseBlock(void* arg, void* h) {
   cache->Release(handle);
 }
 
+bool Table::VerifyChecksums() const {
+  int state = rep_->checksum_state.load(std::memory_order_acquire);
+  if (state != kChecksumsUnknown) {
+    return state == kChecksumsVerified;
+  }
+
+  // Several readers may get here at once; they all reach the same answer.
+  bool verified = false;
+  const char* buf = rep_->file->Getbuf();
+  if (buf != NULL) {
+    std::vector<BlockHandle> handles;
+    bool decoded = true;
+    Iterator* iter = rep_->index_block->NewIterator(rep_->options.comparator);
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      Slice input = iter->value();
+      BlockHandle handle;
+      if (!handle.DecodeFrom(&input).ok()) {
+        decoded = false;
+        break;
+      }
+      handles.push_back(handle);
+    }
+    if (decoded && iter->status().ok()) {
+      verified = VerifyBlockChecksums(Slice(buf, rep_->file_size),
+                                      handles.data(), handles.size()).ok();
+    }
+    delete iter;
+  }
+  rep_->checksum_state.store(
+      verified ? kChecksumsVerified : kChecksumsUnverifiable,
+      std::memory_order_release);
+  return verified;
+}
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg,
                              const ReadOptions& options,
                              const Slice& index_value) {
-  Table* table = reinterpret_cast<Table*>(arg);
+  return NewBlockIterator(reinterpret_cast<Table*>(arg), options, index_value,
+                          false);
+}
+
+// Like BlockReader(), but for a point lookup: the block iterator may use
+// the block's hash index.
+Iterator* Table::NewBlockIterator(Table* table,
+                                  const ReadOptions& caller_options,
+                                  const Slice& index_value,
+                                  bool point_lookup) {
+  ReadOptions options = caller_options;
+  if (options.verify_checksums && table->VerifyChecksums()) {
+    options.verify_checksums = false;  // Already checked with the whole table
+  }
   Cache* block_cache = table->rep_->options.block_cache;
   Block* block = NULL;
   Cache::Handle* cache_handle = NULL;
@@ -179,9 +272,12 @@ Iterator* Table::BlockReader(void* arg,
       Slice key(cache_key_buffer, sizeof(cache_key_buffer));
       cache_handle = block_cache->Lookup(key);
       if (cache_handle != NULL) {
+        PERF_COUNTER_ADD(block_cache_hits, 1);
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        PERF_COUNTER_ADD(block_cache_misses, 1);
+        s = ReadBlock(table->rep_->file, options, handle, &contents,
+                      table->rep_->compression_dict);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
@@ -191,7 +287,9 @@ Iterator* Table::BlockReader(void* arg,
         }
       }
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      PERF_COUNTER_ADD(block_cache_misses, 1);
+      s = ReadBlock(table->rep_->file, options, handle, &contents,
+                    table->rep_->compression_dict);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -200,7 +298,11 @@ Iterator* Table::BlockReader(void* arg,
 
   Iterator* iter;
   if (block != NULL) {
-    iter = block->NewIterator(table->rep_->options.comparator);
+    if (point_lookup) {
+      iter = block->NewPointLookupIterator(table->rep_->options.comparator);
+    } else {
+      iter = block->NewIterator(table->rep_->options.comparator);
+    }
     if (cache_handle == NULL) {
       iter->RegisterCleanup(&DeleteBlock, block, NULL);
     } else {
@@ -218,6 +320,33 @@ Iterator* Table::NewIterator(const ReadOptions& options) const {
       &Table::BlockReader, const_cast<Table*>(this), options);
 }
 
+bool Table::PrefixMayMatch(const Slice& target, const Slice& filter_key) {
+  if (!rep_->prefix_filtered) {
+    return true;
+  }
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  iiter->Seek(target);
+  bool may_match;
+  if (!iiter->Valid()) {
+    // Every key is before target, unless the index is corrupt
+    may_match = !iiter->status().ok();
+  } else {
+    // The prefix keys >= target start in this block, if any: a separator
+    // past target that still has the prefix implies the block holds it.
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    may_match = !handle.DecodeFrom(&handle_value).ok() ||
+                rep_->filter->KeyMayMatch(handle.offset(), filter_key);
+  }
+  delete iiter;
+  if (may_match) {
+    PERF_COUNTER_ADD(prefix_filter_hits, 1);
+  } else {
+    PERF_COUNTER_ADD(prefix_filter_misses, 1);
+  }
+  return may_match;
+}
+
 Status Table::InternalGet(const ReadOptions& options, const Slice& k,
                           void* arg,
                           void (*saver)(void*, const Slice&, const Slice&)) {
@@ -232,8 +361,13 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k,
         handle.DecodeFrom(&handle_value).ok() &&
         !filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
+      PERF_COUNTER_ADD(filter_misses, 1);
     } else {
-      Iterator* block_iter = BlockReader(this, options, iiter->value());
+      if (filter != NULL) {
+        PERF_COUNTER_ADD(filter_hits, 1);
+      }
+      Iterator* block_iter = NewBlockIterator(this, options, iiter->value(),
+                                              true);
       block_iter->Seek(k);
       if (block_iter->Valid()) {
         (*saver)(arg, block_iter->key(), block_iter->value());
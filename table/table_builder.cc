@@ -5,18 +5,170 @@
 #include "leveldb/table_builder.h"
 
 #include <assert.h>
+#include <deque>
+#include <vector>
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
+#include "port/port.h"
 #include "table/block_builder.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
+namespace {
+
+// Compress "raw" with "type" into *compressed and return the type the
+// block is stored with: kNoCompression if the codec is not supported or
+// saves less than 12.5%.
+CompressionType CompressBlock(CompressionType type, const Slice& dict,
+                              const Slice& raw, std::string* compressed) {
+  switch (type) {
+    case kNoCompression:
+      return kNoCompression;
+
+    case kSnappyCompression:
+      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        return kSnappyCompression;
+      }
+      return kNoCompression;
+
+    case kLZ4Compression:
+    case kZstdCompression: {
+      // Neither codec records the uncompressed length, so it goes first
+      PutVarint32(compressed, raw.size());
+      bool ok;
+      if (type == kLZ4Compression) {
+        ok = port::LZ4_Compress(raw.data(), raw.size(), compressed);
+      } else {
+        ok = port::Zstd_Compress(raw.data(), raw.size(), dict.data(),
+                                 dict.size(), compressed);
+      }
+      if (ok && compressed->size() < raw.size() - (raw.size() / 8u)) {
+        return type;
+      }
+      return kNoCompression;
+    }
+  }
+  return kNoCompression;
+}
+
+void EncodeBlockTrailer(const Slice& contents, CompressionType type,
+                        char* trailer) {
+  trailer[0] = type;
+  uint32_t crc = crc32c::Value(contents.data(), contents.size());
+  crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+  EncodeFixed32(trailer+1, crc32c::Mask(crc));
+}
+
+// A data block handed to the compression workers.  The builder writes
+// the blocks in the order they were cut, whatever order they finish in.
+struct PendingBlock {
+  // Filled in by the builder
+  std::string raw;
+  CompressionType requested;
+  Slice dict;
+  Env* env;
+  std::string first_key;
+  std::string last_key;
+  std::string filter_keys;   // Length-prefixed keys of the block
+
+  // Filled in by the worker
+  std::string compressed;
+  CompressionType type;
+  char trailer[kBlockTrailerSize];
+  uint64_t micros;
+  bool done;
+
+  Slice contents() const {
+    return type == kNoCompression ? Slice(raw) : Slice(compressed);
+  }
+};
+
+// Worker threads shared by every builder that compresses in parallel.
+// They live until the process exits, like the Env background thread.
+class CompressionPool {
+ public:
+  CompressionPool() : work_cv_(&mu_), done_cv_(&mu_), threads_(0) { }
+
+  // Start workers until there are at least "threads".
+  void Reserve(Env* env, int threads) {
+    MutexLock l(&mu_);
+    while (threads_ < threads) {
+      env->StartThread(&CompressionPool::Worker, this);
+      threads_++;
+    }
+  }
+
+  void Schedule(PendingBlock* block) {
+    MutexLock l(&mu_);
+    queue_.push_back(block);
+    work_cv_.Signal();
+  }
+
+  bool Done(PendingBlock* block) {
+    MutexLock l(&mu_);
+    return block->done;
+  }
+
+  void WaitFor(PendingBlock* block) {
+    MutexLock l(&mu_);
+    while (!block->done) {
+      done_cv_.Wait();
+    }
+  }
+
+ private:
+  static void Worker(void* arg) {
+    reinterpret_cast<CompressionPool*>(arg)->Run();
+  }
+
+  void Run() {
+    while (true) {
+      mu_.Lock();
+      while (queue_.empty()) {
+        work_cv_.Wait();
+      }
+      PendingBlock* block = queue_.front();
+      queue_.pop_front();
+      mu_.Unlock();
+
+      const uint64_t start_micros = block->env->NowMicros();
+      block->type = CompressBlock(block->requested, block->dict, block->raw,
+                                  &block->compressed);
+      EncodeBlockTrailer(block->contents(), block->type, block->trailer);
+      block->micros = block->env->NowMicros() - start_micros;
+
+      mu_.Lock();
+      block->done = true;
+      done_cv_.SignalAll();
+      mu_.Unlock();
+    }
+  }
+
+  port::Mutex mu_;
+  port::CondVar work_cv_;
+  port::CondVar done_cv_;
+  std::deque<PendingBlock*> queue_;
+  int threads_;
+};
+
+CompressionPool* compression_pool = NULL;
+port::OnceType compression_pool_once = LEVELDB_ONCE_INIT;
+
+void InitCompressionPool() {
+  compression_pool = new CompressionPool;
+}
+
+}  // namespace
+
 struct TableBuilder::Rep {
   Options options;
   Options index_block_options;
@@ -44,6 +196,29 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
 
+  // Zstandard dictionary of the data blocks, and the data blocks sampled
+  // to train one when there is none.
+  std::string compression_dict;
+  std::string dict_samples;
+  std::vector<size_t> dict_sample_lengths;
+
+  uint64_t raw_data_bytes;
+  uint64_t stored_data_bytes;
+  uint64_t compress_micros;
+
+  // With options.compression_threads > 0, data blocks are compressed by
+  // the pool and written here once every block before them is done.  The
+  // filter keys and the index entry of a block wait with it, since both
+  // depend on its offset.
+  CompressionPool* pool;
+  std::deque<PendingBlock*> pending_blocks;
+  uint64_t pending_bytes;              // Upper bound of their size on disk
+  std::string block_first_key;         // First key of data_block
+  std::string block_filter_keys;       // Filter keys of data_block
+  bool has_written_block;
+  std::string written_last_key;        // Last key of the last block written
+  BlockHandle written_handle;
+
   Rep(const Options& opt, WritableFile* f)
       : options(opt),
         index_block_options(opt),
@@ -55,8 +230,114 @@ struct TableBuilder::Rep {
         closed(false),
         filter_block(opt.filter_policy == NULL ? NULL
                      : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+        pending_index_entry(false),
+        raw_data_bytes(0),
+        stored_data_bytes(0),
+        compress_micros(0),
+        pool(NULL),
+        pending_bytes(0),
+        has_written_block(false) {
     index_block_options.block_restart_interval = 1;
+    index_block_options.data_block_hash_index = false;
+    if (opt.compression_threads > 0) {
+      port::InitOnce(&compression_pool_once, InitCompressionPool);
+      compression_pool->Reserve(opt.env, opt.compression_threads);
+      pool = compression_pool;
+    }
+  }
+
+  void SampleForDictionary(const Slice& raw) {
+    if (options.compression == kZstdCompression && compression_dict.empty() &&
+        options.zstd_max_dict_bytes > 0 &&
+        dict_samples.size() <
+            100 * static_cast<size_t>(options.zstd_max_dict_bytes)) {
+      dict_samples.append(raw.data(), raw.size());
+      dict_sample_lengths.push_back(raw.size());
+    }
+  }
+
+  void AppendBlock(const Slice& contents, const char* trailer,
+                   BlockHandle* handle) {
+    handle->set_offset(offset);
+    handle->set_size(contents.size());
+    status = file->Append(contents);
+    if (status.ok()) {
+      status = file->Append(Slice(trailer, kBlockTrailerSize));
+      if (status.ok()) {
+        offset += contents.size() + kBlockTrailerSize;
+      }
+    }
+  }
+
+  // Hand data_block to the pool.
+  void ScheduleBlock() {
+    Slice raw = data_block.Finish();
+    SampleForDictionary(raw);
+    PendingBlock* block = new PendingBlock;
+    block->raw.assign(raw.data(), raw.size());
+    block->requested = options.compression;
+    block->dict = compression_dict;
+    block->env = options.env;
+    block->first_key.swap(block_first_key);
+    block->last_key = last_key;
+    block->filter_keys.swap(block_filter_keys);
+    block->done = false;
+    data_block.Reset();
+    pending_blocks.push_back(block);
+    pending_bytes += block->raw.size() + kBlockTrailerSize;
+    pool->Schedule(block);
+
+    // Bound the memory held by blocks in flight
+    const size_t max_pending = 2 * options.compression_threads + 2;
+    WriteFinishedBlocks(pending_blocks.size() > max_pending ? 1 : 0);
+  }
+
+  // Write the finished blocks at the head of pending_blocks, waiting for
+  // at least "min_blocks" of them (all of them if negative).
+  void WriteFinishedBlocks(int min_blocks) {
+    while (!pending_blocks.empty()) {
+      PendingBlock* block = pending_blocks.front();
+      if (min_blocks != 0) {
+        pool->WaitFor(block);
+        if (min_blocks > 0) min_blocks--;
+      } else if (!pool->Done(block)) {
+        break;
+      }
+      pending_blocks.pop_front();
+      pending_bytes -= block->raw.size() + kBlockTrailerSize;
+      if (status.ok()) {
+        WritePendingBlock(block);
+      }
+      delete block;
+    }
+  }
+
+  void WritePendingBlock(PendingBlock* block) {
+    if (has_written_block) {
+      options.comparator->FindShortestSeparator(&written_last_key,
+                                                block->first_key);
+      std::string handle_encoding;
+      written_handle.EncodeTo(&handle_encoding);
+      index_block.Add(written_last_key, Slice(handle_encoding));
+    }
+    if (filter_block != NULL) {
+      filter_block->StartBlock(offset);
+      Slice keys = block->filter_keys;
+      Slice key;
+      while (GetLengthPrefixedSlice(&keys, &key)) {
+        filter_block->AddKey(key);
+      }
+    }
+    Slice contents = block->contents();
+    AppendBlock(contents, block->trailer, &written_handle);
+    raw_data_bytes += block->raw.size();
+    stored_data_bytes += contents.size();
+    compress_micros += block->micros;
+    has_written_block = true;
+    written_last_key.swap(block->last_key);
+    if (status.ok()) {
+      status = file->Flush();
+    }
   }
 };
 
@@ -86,6 +367,7 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   rep_->options = options;
   rep_->index_block_options = options;
   rep_->index_block_options.block_restart_interval = 1;
+  rep_->index_block_options.data_block_hash_index = false;
   return Status::OK();
 }
 
@@ -106,7 +388,14 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
     r->pending_index_entry = false;
   }
 
-  if (r->filter_block != NULL) {
+  if (r->pool != NULL) {
+    if (r->data_block.empty()) {
+      r->block_first_key.assign(key.data(), key.size());
+    }
+    if (r->filter_block != NULL) {
+      PutLengthPrefixedSlice(&r->block_filter_keys, key);
+    }
+  } else if (r->filter_block != NULL) {
     r->filter_block->AddKey(key);
   }
 
@@ -126,6 +415,10 @@ void TableBuilder::Flush() {
   if (!ok()) return;
   if (r->data_block.empty()) return;
   assert(!r->pending_index_entry);
+  if (r->pool != NULL) {
+    r->ScheduleBlock();
+    return;
+  }
   WriteBlock(&r->data_block, &r->pending_handle);
   if (ok()) {
     r->pending_index_entry = true;
@@ -145,26 +438,24 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   Rep* r = rep_;
   Slice raw = block->Finish();
 
-  Slice block_contents;
-  CompressionType type = r->options.compression;
-  // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-    case kNoCompression:
-      block_contents = raw;
-      break;
-
-    case kSnappyCompression: {
-      std::string* compressed = &r->compressed_output;
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        // Snappy not supported, or compressed less than 12.5%, so just
-        // store uncompressed form
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
+  const bool is_data = (block == &r->data_block);
+  const uint64_t start_micros =
+      (is_data && r->options.compression != kNoCompression)
+          ? r->options.env->NowMicros() : 0;
+  if (is_data) {
+    r->SampleForDictionary(raw);
+  }
+  // Only data blocks use the dictionary: the index block is read before it
+  Slice dict = is_data ? Slice(r->compression_dict) : Slice();
+  CompressionType type = CompressBlock(r->options.compression, dict, raw,
+                                       &r->compressed_output);
+  Slice block_contents =
+      (type == kNoCompression) ? raw : Slice(r->compressed_output);
+  if (is_data) {
+    r->raw_data_bytes += raw.size();
+    r->stored_data_bytes += block_contents.size();
+    if (start_micros != 0) {
+      r->compress_micros += r->options.env->NowMicros() - start_micros;
     }
   }
   WriteRawBlock(block_contents, type, handle);
@@ -175,21 +466,9 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
 void TableBuilder::WriteRawBlock(const Slice& block_contents,
                                  CompressionType type,
                                  BlockHandle* handle) {
-  Rep* r = rep_;
-  handle->set_offset(r->offset);
-  handle->set_size(block_contents.size());
-  r->status = r->file->Append(block_contents);
-  if (r->status.ok()) {
-    char trailer[kBlockTrailerSize];
-    trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
-    EncodeFixed32(trailer+1, crc32c::Mask(crc));
-    r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
-    if (r->status.ok()) {
-      r->offset += block_contents.size() + kBlockTrailerSize;
-    }
-  }
+  char trailer[kBlockTrailerSize];
+  EncodeBlockTrailer(block_contents, type, trailer);
+  rep_->AppendBlock(block_contents, trailer, handle);
 }
 
 Status TableBuilder::status() const {
@@ -201,8 +480,25 @@ Status TableBuilder::Finish() {
   Flush();
   assert(!r->closed);
   r->closed = true;
+  if (r->pool != NULL) {
+    r->WriteFinishedBlocks(-1);
+    r->last_key.swap(r->written_last_key);
+    r->pending_handle = r->written_handle;
+    r->pending_index_entry = r->has_written_block;
+    if (ok() && r->filter_block != NULL) {
+      r->filter_block->StartBlock(r->offset);
+    }
+  }
 
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
+  BlockHandle dict_block_handle;
+
+  // Write compression dictionary block
+  const bool has_dict = !r->compression_dict.empty() &&
+                        r->options.compression == kZstdCompression;
+  if (ok() && has_dict) {
+    WriteRawBlock(r->compression_dict, kNoCompression, &dict_block_handle);
+  }
 
   // Write filter block
   if (ok() && r->filter_block != NULL) {
@@ -212,7 +508,16 @@ Status TableBuilder::Finish() {
 
   // Write metaindex block
   if (ok()) {
-    BlockBuilder meta_index_block(&r->options);
+    // Only the data blocks are searched by point lookups
+    Options meta_index_options = r->options;
+    meta_index_options.data_block_hash_index = false;
+    BlockBuilder meta_index_block(&meta_index_options);
+    if (has_dict) {
+      // Keys are added in order: "compression." sorts before "filter."
+      std::string handle_encoding;
+      dict_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(kCompressionDictionaryKey, handle_encoding);
+    }
     if (r->filter_block != NULL) {
       // Add mapping from "filter.Name" to location of filter data
       std::string key = "filter.";
@@ -220,6 +525,13 @@ Status TableBuilder::Finish() {
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
+
+      if (r->options.prefix_extractor != NULL) {
+        // "prefix.Name" sorts after "filter.Name"
+        std::string prefix_key = kPrefixFilterKeyPrefix;
+        prefix_key.append(r->options.prefix_extractor->Name());
+        meta_index_block.Add(prefix_key, Slice());
+      }
     }
 
     // TODO(postrelease): Add stats and other meta blocks
@@ -257,6 +569,13 @@ void TableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  // The workers may still be compressing blocks in flight
+  while (!r->pending_blocks.empty()) {
+    r->pool->WaitFor(r->pending_blocks.front());
+    delete r->pending_blocks.front();
+    r->pending_blocks.pop_front();
+  }
+  r->pending_bytes = 0;
 }
 
 uint64_t TableBuilder::NumEntries() const {
@@ -264,7 +583,34 @@ uint64_t TableBuilder::NumEntries() const {
 }
 
 uint64_t TableBuilder::FileSize() const {
-  return rep_->offset;
+  return rep_->offset + rep_->pending_bytes;
+}
+
+void TableBuilder::SetCompressionDictionary(const Slice& dict) {
+  assert(rep_->num_entries == 0);
+  rep_->compression_dict.assign(dict.data(), dict.size());
+}
+
+bool TableBuilder::TrainCompressionDictionary(std::string* dict) const {
+  const Rep* r = rep_;
+  if (r->options.compression != kZstdCompression ||
+      !r->compression_dict.empty() || r->options.zstd_max_dict_bytes <= 0) {
+    return false;
+  }
+  return port::Zstd_TrainDictionary(r->dict_samples, r->dict_sample_lengths,
+                                    r->options.zstd_max_dict_bytes, dict);
+}
+
+uint64_t TableBuilder::RawDataSize() const {
+  return rep_->raw_data_bytes;
+}
+
+uint64_t TableBuilder::StoredDataSize() const {
+  return rep_->stored_data_bytes;
+}
+
+uint64_t TableBuilder::CompressionMicros() const {
+  return rep_->compress_micros;
 }
 
 }  // namespace leveldb
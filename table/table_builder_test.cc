@@ -0,0 +1,262 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/table_builder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "leveldb/table.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class StringSink: public WritableFile {
+ public:
+  ~StringSink() { }
+
+  const std::string& contents() const { return contents_; }
+
+  virtual Status Close() { return Status::OK(); }
+  virtual Status Flush() { return Status::OK(); }
+  virtual Status Sync() { return Status::OK(); }
+  virtual Status Setlevel(int level = 0) { return Status::OK(); }
+  virtual const char* Getbuf() { return NULL; }
+
+  virtual Status Append(const Slice& data) {
+    contents_.append(data.data(), data.size());
+    return Status::OK();
+  }
+
+ private:
+  std::string contents_;
+};
+
+class StringSource: public RandomAccessFile {
+ public:
+  StringSource(const Slice& contents)
+      : contents_(contents.data(), contents.size()) {
+  }
+
+  virtual ~StringSource() { }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    if (offset > contents_.size()) {
+      return Status::InvalidArgument("invalid Read offset");
+    }
+    if (offset + n > contents_.size()) {
+      n = contents_.size() - offset;
+    }
+    memcpy(scratch, &contents_[offset], n);
+    *result = Slice(scratch, n);
+    return Status::OK();
+  }
+
+ private:
+  std::string contents_;
+};
+
+static std::string Key(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+// A compressible value that differs per key
+static std::string Value(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "value%d ", i % 17);
+  std::string result;
+  while (result.size() < 100) {
+    result.append(buf);
+  }
+  return result;
+}
+
+class TableBuilderTest {
+ public:
+  const FilterPolicy* policy_;
+  Options options_;
+
+  TableBuilderTest() : policy_(NewBloomFilterPolicy(10)) {
+    // Small blocks so that many of them are in flight at once
+    options_.block_size = 256;
+    options_.filter_policy = policy_;
+  }
+
+  ~TableBuilderTest() {
+    delete policy_;
+  }
+
+  // Build a table of "n" entries with "threads" compression threads.
+  // Stores FileSize() after each Add() in *sizes if it is not NULL.
+  std::string Build(int threads, int n, std::vector<uint64_t>* sizes) {
+    Options options = options_;
+    options.compression_threads = threads;
+    StringSink sink;
+    TableBuilder builder(options, &sink);
+    for (int i = 0; i < n; i++) {
+      builder.Add(Key(i), Value(i));
+      if (sizes != NULL) {
+        sizes->push_back(builder.FileSize());
+      }
+    }
+    ASSERT_OK(builder.Finish());
+    ASSERT_EQ(sink.contents().size(), builder.FileSize());
+    return sink.contents();
+  }
+
+  // Open the table in "contents" and scan it, checking that it holds the
+  // first "n" entries unless the scan fails.  Returns the scan's status;
+  // the iterator skips a corrupt block and reports it at the end.
+  Status Scan(const std::string& contents, int n) {
+    StringSource source(contents);
+    Table* table = NULL;
+    Status s = Table::Open(options_, &source, contents.size(), &table);
+    if (!s.ok()) {
+      return s;
+    }
+    Iterator* iter = table->NewIterator(ReadOptions());
+    int i = 0;
+    bool matches = true;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      matches = matches && iter->key() == Slice(Key(i)) &&
+                iter->value() == Slice(Value(i));
+    }
+    s = iter->status();
+    if (s.ok()) {
+      ASSERT_TRUE(matches);
+      ASSERT_EQ(n, i);
+    }
+    delete iter;
+    delete table;
+    return s;
+  }
+
+  // Round trip a table through "type", compressed inline and in parallel
+  void CheckRoundTrip(CompressionType type) {
+    const int kNum = 2000;
+    options_.compression = kNoCompression;
+    const std::string raw = Build(0, kNum, NULL);
+    options_.compression = type;
+    const std::string compressed = Build(0, kNum, NULL);
+    ASSERT_LT(compressed.size(), raw.size());
+    ASSERT_TRUE(compressed == Build(4, kNum, NULL));
+    ASSERT_OK(Scan(compressed, kNum));
+  }
+
+  // A block whose uncompressed length prefix is not a valid varint32
+  void CheckCorruptLengthPrefix(CompressionType type) {
+    options_.compression = type;
+    std::string contents = Build(0, 100, NULL);
+    ASSERT_OK(Scan(contents, 100));
+
+    // The first data block, and so its length prefix, starts the file
+    memset(&contents[0], 0xff, 5);
+    ASSERT_TRUE(Scan(contents, 100).IsCorruption());
+  }
+};
+
+TEST(TableBuilderTest, ParallelMatchesSerial) {
+  const int kNum = 5000;
+  std::vector<uint64_t> serial_sizes, parallel_sizes;
+  const std::string serial = Build(0, kNum, &serial_sizes);
+  const std::string parallel = Build(4, kNum, &parallel_sizes);
+  ASSERT_EQ(serial.size(), parallel.size());
+  ASSERT_TRUE(serial == parallel);
+
+  // Blocks in flight count at their uncompressed size, which zone-fit
+  // cutting relies on: the estimate never falls below what is written.
+  ASSERT_EQ(serial_sizes.size(), parallel_sizes.size());
+  for (size_t i = 0; i < serial_sizes.size(); i++) {
+    ASSERT_GE(parallel_sizes[i], serial_sizes[i]);
+  }
+
+  // And the table reads back, filter included
+  ASSERT_OK(Scan(parallel, kNum));
+}
+
+TEST(TableBuilderTest, AbandonWithBlocksInFlight) {
+  Options options = options_;
+  options.compression_threads = 4;
+  StringSink sink;
+  TableBuilder* builder = new TableBuilder(options, &sink);
+  for (int i = 0; i < 5000; i++) {
+    builder->Add(Key(i), Value(i));
+  }
+  const uint64_t estimate = builder->FileSize();
+  builder->Abandon();
+
+  // Only the blocks written before Abandon() reach the file
+  ASSERT_LE(sink.contents().size(), estimate);
+  ASSERT_EQ(sink.contents().size(), builder->FileSize());
+  delete builder;
+
+  // The shared workers keep serving later builders
+  ASSERT_TRUE(Build(0, 1000, NULL) == Build(4, 1000, NULL));
+}
+
+#ifdef HAVE_LZ4
+TEST(TableBuilderTest, LZ4RoundTrip) {
+  CheckRoundTrip(kLZ4Compression);
+}
+
+TEST(TableBuilderTest, LZ4CorruptLengthPrefix) {
+  CheckCorruptLengthPrefix(kLZ4Compression);
+}
+#endif  // defined(HAVE_LZ4)
+
+#ifdef HAVE_ZSTD
+TEST(TableBuilderTest, ZstdRoundTrip) {
+  CheckRoundTrip(kZstdCompression);
+}
+
+TEST(TableBuilderTest, ZstdCorruptLengthPrefix) {
+  CheckCorruptLengthPrefix(kZstdCompression);
+}
+
+TEST(TableBuilderTest, ZstdDictionary) {
+  const int kNum = 5000;
+  options_.block_size = 1024;
+  options_.compression = kZstdCompression;
+  options_.zstd_max_dict_bytes = 4096;
+
+  // Train on a first table, as a compaction does with its first output
+  StringSink first_sink;
+  TableBuilder first(options_, &first_sink);
+  for (int i = 0; i < kNum; i++) {
+    first.Add(Key(i), Value(i));
+  }
+  ASSERT_OK(first.Finish());
+  std::string dict;
+  ASSERT_TRUE(first.TrainCompressionDictionary(&dict));
+  ASSERT_TRUE(!dict.empty());
+  ASSERT_LE(dict.size(), 4096);
+
+  // The next table stores the dictionary in its compression.dictionary
+  // meta block, and a reader needs it to decompress the data blocks
+  StringSink sink;
+  TableBuilder builder(options_, &sink);
+  builder.SetCompressionDictionary(dict);
+  ASSERT_TRUE(!builder.TrainCompressionDictionary(&dict));
+  for (int i = 0; i < kNum; i++) {
+    builder.Add(Key(i), Value(i));
+  }
+  ASSERT_OK(builder.Finish());
+  ASSERT_LT(builder.StoredDataSize(), first.StoredDataSize());
+  ASSERT_OK(Scan(sink.contents(), kNum));
+}
+#endif  // defined(HAVE_ZSTD)
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -4,9 +4,16 @@
 
 #include "leveldb/filter_policy.h"
 
+#include <vector>
+
 #include "leveldb/slice.h"
 #include "util/hash.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define LEVELDB_BLOOM_AVX2 1
+#endif
+
 namespace leveldb {
 
 namespace {
@@ -86,10 +93,207 @@ class BloomFilterPolicy : public FilterPolicy {
     return true;
   }
 };
+
+// A filter of the blocked policy is an array of 64-byte blocks, each
+// sixteen little-endian 32-bit words, followed by one byte holding k.  A
+// key sets k bits, all in the block picked by its hash: probe i sets bit
+// (p >> 23) & 31 of word p >> 28, where p = h * kBlockedSalt[i].  Filters
+// of fewer than 512 bits are a single shorter block of whole words, in
+// which probe i uses word (p * num_words) >> 32 and bit (p >> 18) & 31.
+static const size_t kBlockedBytes = 64;
+static const size_t kBlockedMaxProbes = 16;
+static const uint32_t kBlockedSalt[kBlockedMaxProbes] = {
+  0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+  0x9e3779b1U, 0x85ebca77U, 0xc2b2ae3dU, 0x27d4eb2fU,
+  0x165667b1U, 0xd3a2646dU, 0xfd7046c5U, 0xb55a4f09U,
+};
+
+static uint32_t BlockedBloomHash(const Slice& key) {
+  return Hash(key.data(), key.size(), 0x7a2d3f61);
+}
+
+// The block is chosen by the high bits of the hash; the probes within it
+// use the hash rotated by 16 so that they depend mostly on the others.
+static inline size_t BlockedBlockIndex(uint32_t h, size_t num_blocks) {
+  return static_cast<size_t>((static_cast<uint64_t>(h) * num_blocks) >> 32);
+}
+
+static inline uint32_t BlockedProbeHash(uint32_t h) {
+  return (h >> 16) | (h << 16);
+}
+
+static inline void BlockedSetBit(char* array, uint32_t word, uint32_t bit) {
+  array[word * 4 + (bit >> 3)] |= static_cast<char>(1 << (bit & 7));
+}
+
+static inline bool BlockedTestBit(const char* array, uint32_t word,
+                                  uint32_t bit) {
+  return (array[word * 4 + (bit >> 3)] & (1 << (bit & 7))) != 0;
+}
+
+static bool BlockMayMatch(const char* block, uint32_t h, size_t k) {
+  for (size_t i = 0; i < k; i++) {
+    const uint32_t p = h * kBlockedSalt[i];
+    if (!BlockedTestBit(block, p >> 28, (p >> 23) & 31)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if defined(LEVELDB_BLOOM_AVX2)
+// Eight probes per step: each lane picks its word out of the two halves
+// of the block with a permute and tests its bit, lanes past k test none.
+__attribute__((target("avx2")))
+static bool BlockMayMatchAVX2(const char* block, uint32_t h, size_t k) {
+  const __m256i lo =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  const __m256i hi =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+  const __m256i hash = _mm256_set1_epi32(h);
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (size_t base = 0; base < k; base += 8) {
+    const __m256i p = _mm256_mullo_epi32(
+        hash, _mm256_loadu_si256(
+                  reinterpret_cast<const __m256i*>(kBlockedSalt + base)));
+    const __m256i word = _mm256_srli_epi32(p, 28);
+    const __m256i bit =
+        _mm256_and_si256(_mm256_srli_epi32(p, 23), _mm256_set1_epi32(31));
+    const __m256i words = _mm256_blendv_epi8(
+        _mm256_permutevar8x32_epi32(lo, word),
+        _mm256_permutevar8x32_epi32(hi, word),
+        _mm256_cmpgt_epi32(word, _mm256_set1_epi32(7)));
+    const __m256i active = _mm256_cmpgt_epi32(
+        _mm256_set1_epi32(static_cast<int>(k - base)), lane);
+    const __m256i mask = _mm256_and_si256(
+        _mm256_sllv_epi32(_mm256_set1_epi32(1), bit), active);
+    if (!_mm256_testc_si256(words, mask)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool CanUseAVX2() {
+  return __builtin_cpu_supports("avx2");
+}
+#endif  // defined(LEVELDB_BLOOM_AVX2)
+
+class BlockedBloomFilterPolicy : public FilterPolicy {
+ private:
+  size_t bits_per_key_;
+  size_t k_;
+  bool avx2_;
+
+ public:
+  explicit BlockedBloomFilterPolicy(int bits_per_key)
+      : bits_per_key_(bits_per_key),
+        avx2_(false) {
+    k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
+    if (k_ < 1) k_ = 1;
+    if (k_ > kBlockedMaxProbes) k_ = kBlockedMaxProbes;
+#if defined(LEVELDB_BLOOM_AVX2)
+    avx2_ = CanUseAVX2();
+#endif
+  }
+
+  // The filters record k, so policies with different bits_per_key read
+  // each other's filters and share one name.
+  virtual const char* Name() const {
+    return "leveldb.BuiltinBlockedBloomFilter";
+  }
+
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    size_t bits = n * bits_per_key_;
+    size_t bytes;
+    size_t num_blocks = 0;
+    if (bits >= 8 * kBlockedBytes) {
+      num_blocks = (bits + 8 * kBlockedBytes - 1) / (8 * kBlockedBytes);
+      bytes = num_blocks * kBlockedBytes;
+    } else {
+      bytes = (bits + 31) / 32 * 4;
+      if (bytes < 8) bytes = 8;
+      if (bytes == kBlockedBytes) num_blocks = 1;  // Not a short filter
+    }
+
+    // Hash the whole key list first, so that the loop setting the bits
+    // does nothing but arithmetic and stores into the filter.
+    std::vector<uint32_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = BlockedBloomHash(keys[i]);
+    }
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + bytes, 0);
+    dst->push_back(static_cast<char>(k_));  // Remember # of probes in filter
+    char* array = &(*dst)[init_size];
+    if (num_blocks > 0) {
+      for (int i = 0; i < n; i++) {
+        char* block =
+            array + BlockedBlockIndex(hashes[i], num_blocks) * kBlockedBytes;
+        const uint32_t h = BlockedProbeHash(hashes[i]);
+        for (size_t j = 0; j < k_; j++) {
+          const uint32_t p = h * kBlockedSalt[j];
+          BlockedSetBit(block, p >> 28, (p >> 23) & 31);
+        }
+      }
+    } else {
+      const uint64_t num_words = bytes / 4;
+      for (int i = 0; i < n; i++) {
+        const uint32_t h = BlockedProbeHash(hashes[i]);
+        for (size_t j = 0; j < k_; j++) {
+          const uint32_t p = h * kBlockedSalt[j];
+          BlockedSetBit(array, (p * num_words) >> 32, (p >> 18) & 31);
+        }
+      }
+    }
+  }
+
+  virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const {
+    const size_t len = filter.size();
+    if (len < 2) return false;
+
+    const char* array = filter.data();
+    const size_t bytes = len - 1;
+    const size_t k = static_cast<unsigned char>(array[bytes]);
+    if (k > kBlockedMaxProbes || bytes % 4 != 0) {
+      // Reserved for potentially new encodings.  Consider it a match.
+      return true;
+    }
+
+    const uint32_t hash = BlockedBloomHash(key);
+    const uint32_t h = BlockedProbeHash(hash);
+    if (bytes % kBlockedBytes == 0) {
+      const char* block =
+          array + BlockedBlockIndex(hash, bytes / kBlockedBytes) *
+                      kBlockedBytes;
+#if defined(LEVELDB_BLOOM_AVX2)
+      if (avx2_) {
+        return BlockMayMatchAVX2(block, h, k);
+      }
+#endif
+      return BlockMayMatch(block, h, k);
+    }
+
+    const uint64_t num_words = bytes / 4;
+    for (size_t j = 0; j < k; j++) {
+      const uint32_t p = h * kBlockedSalt[j];
+      if (!BlockedTestBit(array, (p * num_words) >> 32, (p >> 18) & 31)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
 }
 
 const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
   return new BloomFilterPolicy(bits_per_key);
 }
 
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key);
+}
+
 }  // namespace leveldb
@@ -26,6 +26,7 @@ class BloomTest {
 
  public:
   BloomTest() : policy_(NewBloomFilterPolicy(10)) { }
+  explicit BloomTest(const FilterPolicy* policy) : policy_(policy) { }
 
   ~BloomTest() {
     delete policy_;
@@ -84,21 +85,12 @@ class BloomTest {
     }
     return result / 10000.0;
   }
-};
-
-TEST(BloomTest, EmptyFilter) {
-  ASSERT_TRUE(! Matches("hello"));
-  ASSERT_TRUE(! Matches("world"));
-}
 
-TEST(BloomTest, Small) {
-  Add("hello");
-  Add("world");
-  ASSERT_TRUE(Matches("hello"));
-  ASSERT_TRUE(Matches("world"));
-  ASSERT_TRUE(! Matches("x"));
-  ASSERT_TRUE(! Matches("foo"));
-}
+  // Checks filters of many sizes; "max_rate" bounds every false positive
+  // rate and few filters may exceed "good_rate".  A filter may be up to
+  // "slack" bytes larger than 10 bits per key.
+  void CheckVaryingLengths(double max_rate, double good_rate, size_t slack);
+};
 
 static int NextLength(int length) {
   if (length < 10) {
@@ -113,7 +105,8 @@ static int NextLength(int length) {
   return length;
 }
 
-TEST(BloomTest, VaryingLengths) {
+void BloomTest::CheckVaryingLengths(double max_rate, double good_rate,
+                                    size_t slack) {
   char buffer[sizeof(int)];
 
   // Count number of filters that significantly exceed the false positive rate
@@ -127,7 +120,7 @@ TEST(BloomTest, VaryingLengths) {
     }
     Build();
 
-    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 40))
+    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + slack))
         << length;
 
     // All added keys must match
@@ -142,8 +135,8 @@ TEST(BloomTest, VaryingLengths) {
       fprintf(stderr, "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
               rate*100.0, length, static_cast<int>(FilterSize()));
     }
-    ASSERT_LE(rate, 0.02);   // Must not be over 2%
-    if (rate > 0.0125) mediocre_filters++;  // Allowed, but not too often
+    ASSERT_LE(rate, max_rate);
+    if (rate > good_rate) mediocre_filters++;  // Allowed, but not too often
     else good_filters++;
   }
   if (kVerbose >= 1) {
@@ -153,8 +146,77 @@ TEST(BloomTest, VaryingLengths) {
   ASSERT_LE(mediocre_filters, good_filters/5);
 }
 
+class BlockedBloomTest : public BloomTest {
+ public:
+  BlockedBloomTest() : BloomTest(NewBlockedBloomFilterPolicy(10)) { }
+};
+
+TEST(BloomTest, EmptyFilter) {
+  ASSERT_TRUE(! Matches("hello"));
+  ASSERT_TRUE(! Matches("world"));
+}
+
+TEST(BloomTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(! Matches("x"));
+  ASSERT_TRUE(! Matches("foo"));
+}
+
+TEST(BloomTest, VaryingLengths) {
+  CheckVaryingLengths(0.02, 0.0125, 40);  // Must not be over 2%
+}
+
 // Different bits-per-byte
 
+TEST(BlockedBloomTest, BlockedEmptyFilter) {
+  ASSERT_TRUE(! Matches("hello"));
+  ASSERT_TRUE(! Matches("world"));
+}
+
+TEST(BlockedBloomTest, BlockedSmall) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(! Matches("x"));
+  ASSERT_TRUE(! Matches("foo"));
+}
+
+TEST(BlockedBloomTest, BlockedVaryingLengths) {
+  // Keeping each key in one block costs some accuracy, and the size is
+  // rounded up to whole blocks
+  CheckVaryingLengths(0.025, 0.015, 65);
+}
+
+TEST(BlockedBloomTest, MixedBitsPerKey) {
+  // A filter built with more bits per key is read by any instance
+  const FilterPolicy* wide = NewBlockedBloomFilterPolicy(20);
+  char buffer[sizeof(int)];
+  std::vector<std::string> keys;
+  std::vector<Slice> key_slices;
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back(Key(i, buffer).ToString());
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    key_slices.push_back(Slice(keys[i]));
+  }
+  std::string filter;
+  wide->CreateFilter(&key_slices[0], static_cast<int>(key_slices.size()),
+                     &filter);
+  int false_positives = 0;
+  for (int i = 0; i < 10000; i++) {
+    ASSERT_TRUE(wide->KeyMayMatch(Key(i % 1000, buffer), filter));
+    if (wide->KeyMayMatch(Key(i + 1000000000, buffer), filter)) {
+      false_positives++;
+    }
+  }
+  ASSERT_LE(false_positives, 20);  // Under 0.2%
+  delete wide;
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
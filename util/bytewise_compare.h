@@ -0,0 +1,61 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Inline three-way comparison of byte strings, the order of
+// BytewiseComparator(), for the loops that compare keys of the default
+// comparator without going through the virtual Comparator::Compare().
+
+#ifndef STORAGE_LEVELDB_UTIL_BYTEWISE_COMPARE_H_
+#define STORAGE_LEVELDB_UTIL_BYTEWISE_COMPARE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "leveldb/slice.h"
+#include "port/port.h"
+
+namespace leveldb {
+
+// Keys at least this long share prefixes long enough for memcmp(), which
+// is vectorized, to beat the word loop below despite the call.
+static const size_t kBytewiseInlineLimit = 64;
+
+// Returns <0, 0 or >0 like a.compare(b).
+inline int BytewiseCompare(const Slice& a, const Slice& b) {
+  const size_t min_len = (a.size() < b.size()) ? a.size() : b.size();
+  if (min_len >= kBytewiseInlineLimit) {
+    return a.compare(b);
+  }
+  const char* pa = a.data();
+  const char* pb = b.data();
+  size_t i = 0;
+  // Skip the common prefix eight bytes at a time; the lowest differing
+  // byte of the loaded words is the first differing byte of the strings.
+  for (; i + 8 <= min_len; i += 8) {
+    uint64_t wa, wb;
+    memcpy(&wa, pa + i, sizeof(wa));
+    memcpy(&wb, pb + i, sizeof(wb));
+    if (wa != wb) {
+      if (port::kLittleEndian) {
+        const int shift = __builtin_ctzll(wa ^ wb) & ~7;
+        return (((wa >> shift) & 0xff) < ((wb >> shift) & 0xff)) ? -1 : +1;
+      }
+      return (wa < wb) ? -1 : +1;
+    }
+  }
+  for (; i < min_len; i++) {
+    if (pa[i] != pb[i]) {
+      return (static_cast<unsigned char>(pa[i]) <
+              static_cast<unsigned char>(pb[i])) ? -1 : +1;
+    }
+  }
+  if (a.size() < b.size()) {
+    return -1;
+  }
+  return (a.size() > b.size()) ? +1 : 0;
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_BYTEWISE_COMPARE_H_
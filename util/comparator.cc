@@ -7,6 +7,7 @@
 #include "leveldb/comparator.h"
 #include "leveldb/slice.h"
 #include "port/port.h"
+#include "util/bytewise_compare.h"
 #include "util/logging.h"
 
 namespace leveldb {
@@ -23,7 +24,7 @@ class BytewiseComparatorImpl : public Comparator {
   }
 
   virtual int Compare(const Slice& a, const Slice& b) const {
-    return a.compare(b);
+    return BytewiseCompare(a, b);
   }
 
   virtual void FindShortestSeparator(
@@ -376,5 +376,16 @@ uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
   return l ^ kCRC32Xor;
 }
 
+void ValueMulti(const char* const* data, const size_t* n, int count,
+                uint32_t* result) {
+  static bool accelerate = CanAccelerateCRC32C();
+  if (accelerate && port::AcceleratedCRC32CMulti(data, n, count, result)) {
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    result[i] = Value(data[i], n[i]);
+  }
+}
+
 }  // namespace crc32c
 }  // namespace leveldb
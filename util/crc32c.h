@@ -21,6 +21,12 @@ inline uint32_t Value(const char* data, size_t n) {
   return Extend(0, data, n);
 }
 
+// Set result[i] to the crc32c of data[i][0,n[i]-1] for every i < count.
+// With hardware CRC instructions several buffers are processed at once,
+// which is much faster than calling Value() on each of them in turn.
+extern void ValueMulti(const char* const* data, const size_t* n, int count,
+                       uint32_t* result);
+
 static const uint32_t kMaskDelta = 0xa282ead8ul;
 
 // Return a masked representation of crc.
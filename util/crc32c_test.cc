@@ -56,6 +56,39 @@ TEST(CRC, Extend) {
             Extend(Value("hello ", 6), "world", 5));
 }
 
+TEST(CRC, Multi) {
+  // Buffers of different lengths and alignments, so that the interleaved
+  // part and the per-buffer tails are both exercised.
+  std::string storage(8192, '\0');
+  for (size_t i = 0; i < storage.size(); i++) {
+    storage[i] = static_cast<char>(i * 7 + (i >> 8));
+  }
+  const int kCount = 11;
+  const char* data[kCount];
+  size_t n[kCount];
+  uint32_t result[kCount];
+  for (int i = 0; i < kCount; i++) {
+    data[i] = storage.data() + i * 3;
+    n[i] = (i == 5) ? 0 : 700 + i * 61;
+  }
+  ValueMulti(data, n, kCount, result);
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_EQ(Value(data[i], n[i]), result[i]);
+  }
+
+  // Every buffer of the rfc3720 zero vector at once.
+  char zeros[32];
+  memset(zeros, 0, sizeof(zeros));
+  for (int i = 0; i < kCount; i++) {
+    data[i] = zeros;
+    n[i] = sizeof(zeros);
+  }
+  ValueMulti(data, n, kCount, result);
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_EQ(0x8a9136aa, result[i]);
+  }
+}
+
 TEST(CRC, Mask) {
   uint32_t crc = Value("foo", 3);
   ASSERT_NE(crc, Mask(crc));
@@ -19,6 +19,7 @@
 #include <deque>
 #include <limits>
 #include <set>
+#include "db/filename.h"
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
 #include "port/port.h"
@@ -69,15 +70,175 @@ static uint64_t Parsefname(std::string fname){
   return result;
 }
 
+// The WAL and MANIFEST files of the DB registered with the zone manager go
+// to the drive's conventional zones when it has them.  A file already there
+// stays there, so that it can be read, renamed and deleted after the DB that
+// wrote it is closed (e.g. by RepairDB() and DestroyDB()).
+static bool isHMLogName(const std::string& fname){
+  HMManager* hm_manager = Singleton::Gethmmanager();
+  if (!hm_manager->log_zone_enabled()) {
+    return false;
+  }
+  if (hm_manager->log_exists(fname)) {
+    return true;
+  }
+  size_t pos = fname.find_last_of('/');
+  if (pos == std::string::npos) {
+    return false;
+  }
+  uint64_t number;
+  FileType type;
+  if (!ParseFileName(fname.substr(pos+1), &number, &type) ||
+      (type != kLogFile && type != kDescriptorFile)) {
+    return false;
+  }
+  return hm_manager->is_log_dbname(fname.substr(0, pos));
+}
+
+class HMLogSequentialFile : public SequentialFile {  //read back a WAL or MANIFEST
+  private:
+    HMManager* hm_manager_;
+    const std::string filename_;
+    uint64_t offset_;
+
+  public:
+    HMLogSequentialFile(const std::string &fname, HMManager* hm_manager)
+      : hm_manager_(hm_manager), filename_(fname), offset_(0) { }
+
+    virtual ~HMLogSequentialFile() { }
+
+    virtual Status Read(size_t n, Slice* result, char* scratch) {
+      ssize_t r = hm_manager_->log_read(filename_, offset_, scratch, n);
+      if (r < 0) {
+        *result = Slice();
+        return PosixError(filename_, errno);
+      }
+      offset_ += r;
+      *result = Slice(scratch, r);
+      return Status::OK();
+    }
+
+    virtual Status Skip(uint64_t n) {
+      offset_ += n;
+      return Status::OK();
+    }
+};
+
+class HMLogWritableFile : public WritableFile {  //append a WAL or MANIFEST with direct I/O
+  private:
+    static const size_t kLogBufferSize = 1048576;
+
+    HMManager* hm_manager_;
+    std::string fname_;
+    char* buf_;            //aligned buffer for direct I/O
+    uint64_t buf_offset_;  //file offset of buf_[0], a multiple of PHYSICAL_BLOCK_SIZE
+    size_t pos_;           //valid bytes in buf_
+    Status st_;
+
+    //Write the buffered whole blocks, plus the partial last block if
+    //include_tail.  The partial block stays buffered and is written again,
+    //in place, by the next call: conventional zones allow overwrites.
+    Status WriteBlocks(bool include_tail) {
+      if (!st_.ok()) {
+        return st_;
+      }
+      size_t full = (pos_ / PHYSICAL_BLOCK_SIZE) * PHYSICAL_BLOCK_SIZE;
+      size_t len = include_tail ?
+          ((pos_ + PHYSICAL_BLOCK_SIZE - 1) / PHYSICAL_BLOCK_SIZE) * PHYSICAL_BLOCK_SIZE : full;
+      if (len == 0) {
+        return Status::OK();
+      }
+      if (len > pos_) {
+        memset(buf_ + pos_, 0, len - pos_);
+      }
+      uint64_t file_size = buf_offset_ + (include_tail ? pos_ : full);
+      if (hm_manager_->log_write(fname_, buf_offset_, buf_, len, file_size) < 0) {
+        st_ = PosixError(fname_, errno);
+        return st_;
+      }
+      if (full > 0) {
+        memmove(buf_, buf_ + full, pos_ - full);
+        buf_offset_ += full;
+        pos_ -= full;
+      }
+      return Status::OK();
+    }
+
+  public:
+    HMLogWritableFile(const std::string &fname, HMManager* hm_manager, uint64_t file_size)
+      : hm_manager_(hm_manager), fname_(fname), buf_(NULL),
+        buf_offset_((file_size / PHYSICAL_BLOCK_SIZE) * PHYSICAL_BLOCK_SIZE),
+        pos_(file_size - buf_offset_) {
+      int ret = posix_memalign((void **)&buf_, MEMALIGN_SIZE, kLogBufferSize);
+      if (ret != 0) {
+        buf_ = NULL;
+        st_ = Status::IOError(fname_, "posix_memalign failed");
+        return;
+      }
+      if (pos_ > 0) {  //reopened for append: reload the partial last block
+        if (hm_manager_->log_read(fname_, buf_offset_, buf_, pos_) < 0) {
+          st_ = PosixError(fname_, errno);
+        }
+      }
+    }
+
+    virtual ~HMLogWritableFile() {
+      if (buf_ != NULL) {
+        WriteBlocks(true);
+        free(buf_);
+      }
+    }
+
+    virtual Status Append(const Slice& data) {
+      if (!st_.ok()) {
+        return st_;
+      }
+      const char* p = data.data();
+      size_t n = data.size();
+      while (n > 0) {
+        size_t copy = std::min(n, kLogBufferSize - pos_);
+        memcpy(buf_ + pos_, p, copy);
+        pos_ += copy;
+        p += copy;
+        n -= copy;
+        if (pos_ == kLogBufferSize) {
+          Status s = WriteBlocks(false);
+          if (!s.ok()) {
+            return s;
+          }
+        }
+      }
+      return Status::OK();
+    }
+
+    virtual Status Close() {
+      return WriteBlocks(true);
+    }
+
+    //Only whole blocks reach the drive on Flush; the partial tail costs
+    //one extra aligned write per Sync, which the DB's writer groups share.
+    virtual Status Flush() {
+      return WriteBlocks(false);
+    }
+
+    virtual Status Sync() {
+      return WriteBlocks(true);
+    }
+
+    virtual Status Setlevel(int level = 0) { return Status::OK(); }
+    virtual const char* Getbuf() { return NULL; }
+};
+
 class HMRamdomAccessFile : public RandomAccessFile {  //hm read file
   private:
     HMManager* hm_manager_;
     const std::string filename_;
     uint64_t filenum;
+    IOClass io_class_;
 
   public:
-    HMRamdomAccessFile(const std::string &fname, HMManager* hm_manager)
-      : filename_(fname), hm_manager_(hm_manager) {
+    HMRamdomAccessFile(const std::string &fname, HMManager* hm_manager, IOClass io_class)
+      : filename_(fname), hm_manager_(hm_manager), io_class_(io_class) {
         
       filenum=Parsefname(fname);
     }
@@ -87,7 +248,7 @@ class HMRamdomAccessFile : public RandomAccessFile {  //hm read file
     virtual Status Read(uint64_t offset, size_t n, Slice *result,char *scratch) const {
       Status s;
       ssize_t r = -1;
-      r = hm_manager_->hm_read(filenum, scratch, n, offset);
+      r = hm_manager_->hm_read(filenum, scratch, n, offset, io_class_);
       if(r<0){
         s = PosixError(filename_, errno);
         return s;
@@ -122,7 +283,7 @@ class HMComRamdomAccessFile : public RandomAccessFile {  //when compaction,we ca
           memcpy(buf_,buf_file,ldb->size);
       }
       else{
-        r = hm_manager_->hm_read(filenum, buf_, ldb->size, 0);
+        r = hm_manager_->hm_read(filenum, buf_, ldb->size, 0, kIOCompaction);
         if(r<0){
           st= PosixError(filename_, errno);
         }
@@ -145,6 +306,8 @@ class HMComRamdomAccessFile : public RandomAccessFile {  //when compaction,we ca
         return st;
       }
     }
+
+    virtual const char* Getbuf() const { return st.ok() ? buf_ : NULL; }
 };
 
 class HMWritableFile : public WritableFile {    //hm write file except L0 level
@@ -195,6 +358,9 @@ class HMWritableFile : public WritableFile {    //hm write file except L0 level
       if(ret > 0){
           return Status::OK();
       }
+      if(errno == ENOSPC){
+          return Status::NoSpace(fname_, "no free zone");
+      }
       return Status::IOError("sync error!");
     }
 
@@ -247,10 +413,13 @@ class HMWritableFileL0 : public WritableFile {    //hm write L0 level file
     }
 
     virtual Status Sync() { 
-      ssize_t ret = hm_manager_->hm_write(level_,Parsefname(fname_), buf_, total_size_);
+      ssize_t ret = hm_manager_->hm_write(level_,Parsefname(fname_), buf_, total_size_, kIOFlush);
       if(ret > 0){
           return Status::OK();
       }
+      if(errno == ENOSPC){
+          return Status::NoSpace(fname_, "no free zone");
+      }
       return Status::IOError("sync error!");
     }
 
@@ -613,6 +782,15 @@ class PosixEnv : public Env {
 
   virtual Status NewSequentialFile(const std::string& fname,
                                    SequentialFile** result) {
+    if (isHMLogName(fname)) {
+      HMManager* hm_manager = Singleton::Gethmmanager();
+      if (!hm_manager->log_exists(fname)) {
+        *result = NULL;
+        return PosixError(fname, ENOENT);
+      }
+      *result = new HMLogSequentialFile(fname, hm_manager);
+      return Status::OK();
+    }
     int fd = open(fname.c_str(), O_RDONLY);
     if (fd < 0) {
       *result = NULL;
@@ -629,7 +807,7 @@ class PosixEnv : public Env {
     Status s;
     if(isSSTableName(fname)){
       if(flag && Find_Table_Old){
-        *result = new HMRamdomAccessFile(fname, Singleton::Gethmmanager());
+        *result = new HMRamdomAccessFile(fname, Singleton::Gethmmanager(), kIOUserRead);
         return Status::OK();
       }
       
@@ -638,7 +816,8 @@ class PosixEnv : public Env {
         return Status::OK();
       }
       else{
-        *result = new HMRamdomAccessFile(fname, Singleton::Gethmmanager());
+        *result = new HMRamdomAccessFile(fname, Singleton::Gethmmanager(),
+                                         flag ? kIOUserRead : kIOCompaction);
         return Status::OK();
       }
     }
@@ -681,6 +860,12 @@ class PosixEnv : public Env {
         }
         
     }
+    if (isHMLogName(fname)) {
+      HMManager* hm_manager = Singleton::Gethmmanager();
+      hm_manager->log_create(fname);
+      *result = new HMLogWritableFile(fname, hm_manager, 0);
+      return Status::OK();
+    }
     int fd = open(fname.c_str(), O_TRUNC | O_WRONLY | O_CREAT, 0644);
     if (fd < 0) {
       *result = NULL;
@@ -694,6 +879,15 @@ class PosixEnv : public Env {
   virtual Status NewAppendableFile(const std::string& fname,
                                    WritableFile** result) {
     Status s;
+    if (isHMLogName(fname)) {
+      HMManager* hm_manager = Singleton::Gethmmanager();
+      uint64_t size = 0;
+      if (hm_manager->log_size(fname, &size) < 0) {
+        hm_manager->log_create(fname);
+      }
+      *result = new HMLogWritableFile(fname, hm_manager, size);
+      return Status::OK();
+    }
     int fd = open(fname.c_str(), O_APPEND | O_WRONLY | O_CREAT, 0644);
     if (fd < 0) {
       *result = NULL;
@@ -705,6 +899,9 @@ class PosixEnv : public Env {
   }
 
   virtual bool FileExists(const std::string& fname) {
+    if (isHMLogName(fname)) {
+      return Singleton::Gethmmanager()->log_exists(fname);
+    }
     return access(fname.c_str(), F_OK) == 0;
   }
 
@@ -720,6 +917,10 @@ class PosixEnv : public Env {
       result->push_back(entry->d_name);
     }
     closedir(d);
+    HMManager* hm_manager = Singleton::Gethmmanager();
+    if (hm_manager->log_zone_enabled()) {
+      hm_manager->log_children(dir, result);
+    }
     return Status::OK();
   }
 
@@ -730,6 +931,12 @@ class PosixEnv : public Env {
       hmmanager->hm_delete(Parsefname(fname));
       return Status::OK();
     }
+    if (isHMLogName(fname)) {
+      if (hmmanager->log_delete(fname) < 0) {
+        result = PosixError(fname, errno);
+      }
+      return result;
+    }
     if (unlink(fname.c_str()) != 0) {
       result = PosixError(fname, errno);
     }
@@ -754,6 +961,19 @@ class PosixEnv : public Env {
 
   virtual Status GetFileSize(const std::string& fname, uint64_t* size) {
     Status s;
+    if (isSSTableName(fname)) {
+      if (!Singleton::Gethmmanager()->get_table_size(Parsefname(fname), size)) {
+        *size = 0;
+        s = PosixError(fname, ENOENT);
+      }
+      return s;
+    }
+    if (isHMLogName(fname)) {
+      if (Singleton::Gethmmanager()->log_size(fname, size) < 0) {
+        s = PosixError(fname, errno);
+      }
+      return s;
+    }
     struct stat sbuf;
     if (stat(fname.c_str(), &sbuf) != 0) {
       *size = 0;
@@ -766,6 +986,17 @@ class PosixEnv : public Env {
 
   virtual Status RenameFile(const std::string& src, const std::string& target) {
     Status result;
+    const bool src_on_hm = isHMLogName(src);
+    const bool target_on_hm = isHMLogName(target);
+    if (src_on_hm && target_on_hm) {
+      if (Singleton::Gethmmanager()->log_rename(src, target) < 0) {
+        result = PosixError(src, errno);
+      }
+      return result;
+    }
+    if (src_on_hm || target_on_hm) {
+      return MoveAcrossBackends(src, target);
+    }
     if (rename(src.c_str(), target.c_str()) != 0) {
       result = PosixError(src, errno);
     }
@@ -860,6 +1091,44 @@ class PosixEnv : public Env {
     }
   }
 
+  // Renames by copying when only one of src and target lives in the
+  // conventional zones.  Not atomic: a crash can leave both copies behind.
+  Status MoveAcrossBackends(const std::string& src, const std::string& target) {
+    SequentialFile* in;
+    Status s = NewSequentialFile(src, &in);
+    if (!s.ok()) {
+      return s;
+    }
+    WritableFile* out;
+    s = NewWritableFile(target, &out);
+    if (s.ok()) {
+      char buf[8192];
+      Slice fragment;
+      while (s.ok()) {
+        s = in->Read(sizeof(buf), &fragment, buf);
+        if (!s.ok() || fragment.empty()) {
+          break;
+        }
+        s = out->Append(fragment);
+      }
+      if (s.ok()) {
+        s = out->Sync();
+      }
+      if (s.ok()) {
+        s = out->Close();
+      }
+      delete out;
+      if (!s.ok()) {
+        DeleteFile(target);
+      }
+    }
+    delete in;
+    if (s.ok()) {
+      s = DeleteFile(src);
+    }
+    return s;
+  }
+
   // BGThread() is the body of the background thread
   void BGThread();
   static void* BGThreadWrapper(void* arg) {
@@ -4,6 +4,7 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <algorithm>
 #include "port/port.h"
 #include "util/histogram.h"
 
@@ -102,6 +103,88 @@ double Histogram::StandardDeviation() const {
   return sqrt(variance);
 }
 
+namespace {
+
+void AtomicAddDouble(std::atomic<double>* v, double delta) {
+  double old = v->load(std::memory_order_relaxed);
+  while (!v->compare_exchange_weak(old, old + delta,
+                                   std::memory_order_relaxed)) {
+  }
+}
+
+void AtomicMin(std::atomic<double>* v, double value) {
+  double old = v->load(std::memory_order_relaxed);
+  while (value < old &&
+         !v->compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+  }
+}
+
+void AtomicMax(std::atomic<double>* v, double value) {
+  double old = v->load(std::memory_order_relaxed);
+  while (value > old &&
+         !v->compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+  }
+}
+
+std::atomic<unsigned int> next_shard(0);
+__thread int thread_shard = -1;
+
+}  // namespace
+
+ConcurrentHistogram::ConcurrentHistogram() {
+  Clear();
+}
+
+void ConcurrentHistogram::Add(double value) {
+  if (thread_shard < 0) {
+    thread_shard = next_shard.fetch_add(1) % kShards;
+  }
+  Shard* s = &shards_[thread_shard];
+  // Same bucket as Histogram::Add(): the first limit above value
+  const double* limit = std::upper_bound(
+      Histogram::kBucketLimit,
+      Histogram::kBucketLimit + Histogram::kNumBuckets - 1, value);
+  s->buckets[limit - Histogram::kBucketLimit].fetch_add(
+      1, std::memory_order_relaxed);
+  AtomicMin(&s->min, value);
+  AtomicMax(&s->max, value);
+  AtomicAddDouble(&s->sum, value);
+  AtomicAddDouble(&s->sum_squares, value * value);
+  s->num.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConcurrentHistogram::Clear() {
+  for (int i = 0; i < kShards; i++) {
+    Shard* s = &shards_[i];
+    s->min.store(Histogram::kBucketLimit[Histogram::kNumBuckets-1],
+                 std::memory_order_relaxed);
+    s->max.store(0, std::memory_order_relaxed);
+    s->sum.store(0, std::memory_order_relaxed);
+    s->sum_squares.store(0, std::memory_order_relaxed);
+    s->num.store(0, std::memory_order_relaxed);
+    for (int b = 0; b < Histogram::kNumBuckets; b++) {
+      s->buckets[b].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void ConcurrentHistogram::Merge(Histogram* result) const {
+  for (int i = 0; i < kShards; i++) {
+    const Shard* s = &shards_[i];
+    Histogram h;
+    h.Clear();
+    h.min_ = s->min.load(std::memory_order_relaxed);
+    h.max_ = s->max.load(std::memory_order_relaxed);
+    h.sum_ = s->sum.load(std::memory_order_relaxed);
+    h.sum_squares_ = s->sum_squares.load(std::memory_order_relaxed);
+    h.num_ = s->num.load(std::memory_order_relaxed);
+    for (int b = 0; b < Histogram::kNumBuckets; b++) {
+      h.buckets_[b] = s->buckets[b].load(std::memory_order_relaxed);
+    }
+    result->Merge(h);
+  }
+}
+
 std::string Histogram::ToString() const {
   std::string r;
   char buf[200];
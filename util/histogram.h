@@ -5,6 +5,8 @@
 #ifndef STORAGE_LEVELDB_UTIL_HISTOGRAM_H_
 #define STORAGE_LEVELDB_UTIL_HISTOGRAM_H_
 
+#include <stdint.h>
+#include <atomic>
 #include <string>
 
 namespace leveldb {
@@ -20,7 +22,15 @@ class Histogram {
 
   std::string ToString() const;
 
+  double Median() const;
+  double Percentile(double p) const;
+  double Average() const;
+  double Count() const { return num_; }
+  double Max() const { return max_; }
+
  private:
+  friend class ConcurrentHistogram;
+
   double min_;
   double max_;
   double num_;
@@ -31,12 +41,39 @@ class Histogram {
   static const double kBucketLimit[kNumBuckets];
   double buckets_[kNumBuckets];
 
-  double Median() const;
-  double Percentile(double p) const;
-  double Average() const;
   double StandardDeviation() const;
 };
 
+// A histogram that many threads add to without a lock.  Samples go to one
+// of kShards shards picked per thread, and every field of a shard is an
+// atomic, so threads that share a shard still count exactly.  A reader
+// merges the shards into a plain Histogram.
+class ConcurrentHistogram {
+ public:
+  ConcurrentHistogram();
+
+  void Add(double value);
+  void Clear();
+  void Merge(Histogram* result) const;   // Adds the current contents
+
+ private:
+  enum { kShards = 16 };
+
+  struct Shard {
+    std::atomic<double> min;
+    std::atomic<double> max;
+    std::atomic<double> sum;
+    std::atomic<double> sum_squares;
+    std::atomic<uint64_t> num;
+    std::atomic<uint64_t> buckets[Histogram::kNumBuckets];
+  };
+  Shard shards_[kShards];
+
+  // No copying allowed
+  ConcurrentHistogram(const ConcurrentHistogram&);
+  void operator=(const ConcurrentHistogram&);
+};
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_UTIL_HISTOGRAM_H_
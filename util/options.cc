@@ -21,10 +21,15 @@ Options::Options()
       block_cache(NULL),
       block_size(4096),
       block_restart_interval(16),
+      data_block_hash_index(false),
       max_file_size(4<<20),
       compression(kSnappyCompression),
+      zstd_max_dict_bytes(0),
+      compression_threads(0),
       reuse_logs(false),
-      filter_policy(NULL) {
+      filter_policy(NULL),
+      prefix_extractor(NULL),
+      value_separation_threshold(0) {
 }
 
 }  // namespace leveldb
@@ -0,0 +1,97 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/perf_context_imp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace leveldb {
+
+namespace perf {
+
+__thread bool enabled = false;
+__thread PerfContext context;
+
+// A lookup reads one table per level at most, so a short list is enough.
+// Zones beyond it are counted as distinct.
+static const int kMaxOperationZones = 16;
+static __thread uint64_t operation_zones[kMaxOperationZones];
+static __thread int num_operation_zones = 0;
+
+void BeginOperation() {
+  num_operation_zones = 0;
+}
+
+void RecordZone(uint64_t zone) {
+  if (!enabled) {
+    return;
+  }
+  for (int i = 0; i < num_operation_zones; i++) {
+    if (operation_zones[i] == zone) {
+      return;
+    }
+  }
+  if (num_operation_zones < kMaxOperationZones) {
+    operation_zones[num_operation_zones++] = zone;
+  }
+  context.zones_touched++;
+}
+
+}  // namespace perf
+
+void PerfContext::Reset() {
+  memset(this, 0, sizeof(*this));
+  perf::BeginOperation();
+}
+
+void PerfContext::Merge(const PerfContext& other) {
+  table_probes += other.table_probes;
+  filter_hits += other.filter_hits;
+  filter_misses += other.filter_misses;
+  prefix_filter_hits += other.prefix_filter_hits;
+  prefix_filter_misses += other.prefix_filter_misses;
+  block_cache_hits += other.block_cache_hits;
+  block_cache_misses += other.block_cache_misses;
+  device_reads += other.device_reads;
+  device_read_bytes += other.device_read_bytes;
+  zones_touched += other.zones_touched;
+  io_wait_micros += other.io_wait_micros;
+}
+
+std::string PerfContext::ToString() const {
+  char buf[640];
+  snprintf(buf, sizeof(buf),
+           "table_probes = %llu, filter_hits = %llu, filter_misses = %llu, "
+           "prefix_filter_hits = %llu, prefix_filter_misses = %llu, "
+           "block_cache_hits = %llu, block_cache_misses = %llu, "
+           "device_reads = %llu, device_read_bytes = %llu, "
+           "zones_touched = %llu, io_wait_micros = %llu",
+           (unsigned long long)table_probes,
+           (unsigned long long)filter_hits,
+           (unsigned long long)filter_misses,
+           (unsigned long long)prefix_filter_hits,
+           (unsigned long long)prefix_filter_misses,
+           (unsigned long long)block_cache_hits,
+           (unsigned long long)block_cache_misses,
+           (unsigned long long)device_reads,
+           (unsigned long long)device_read_bytes,
+           (unsigned long long)zones_touched,
+           (unsigned long long)io_wait_micros);
+  return buf;
+}
+
+void SetPerfContextEnabled(bool enabled) {
+  perf::enabled = enabled;
+}
+
+bool PerfContextEnabled() {
+  return perf::enabled;
+}
+
+PerfContext* GetPerfContext() {
+  return &perf::context;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,34 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_PERF_CONTEXT_IMP_H_
+#define STORAGE_LEVELDB_UTIL_PERF_CONTEXT_IMP_H_
+
+#include <stdint.h>
+#include "leveldb/perf_context.h"
+
+namespace leveldb {
+namespace perf {
+
+extern __thread bool enabled;
+extern __thread PerfContext context;
+
+// Starts a user operation: zones read from now on are counted again
+// even if the previous operation already read them.
+void BeginOperation();
+
+// Counts "zone" in zones_touched if the current operation has not read it.
+void RecordZone(uint64_t zone);
+
+}  // namespace perf
+}  // namespace leveldb
+
+#define PERF_COUNTER_ADD(metric, value)          \
+  do {                                           \
+    if (leveldb::perf::enabled) {                \
+      leveldb::perf::context.metric += (value);  \
+    }                                            \
+  } while (0)
+
+#endif  // STORAGE_LEVELDB_UTIL_PERF_CONTEXT_IMP_H_
@@ -0,0 +1,98 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/slice_transform.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+SliceTransform::~SliceTransform() { }
+
+namespace {
+class FixedPrefixTransform : public SliceTransform {
+ private:
+  size_t prefix_len_;
+  std::string name_;
+
+ public:
+  explicit FixedPrefixTransform(size_t prefix_len)
+      : prefix_len_(prefix_len) {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "leveldb.FixedPrefix.%llu",
+             static_cast<unsigned long long>(prefix_len));
+    name_ = buf;
+  }
+
+  virtual const char* Name() const {
+    return name_.c_str();
+  }
+
+  virtual bool InDomain(const Slice& key) const {
+    return key.size() >= prefix_len_;
+  }
+
+  virtual Slice Transform(const Slice& key) const {
+    return Slice(key.data(), prefix_len_);
+  }
+};
+
+class DelimitedPrefixTransform : public SliceTransform {
+ private:
+  char delimiter_;
+  int fields_;
+  std::string name_;
+
+  // Length of the prefix of "key", or 0 if it has none
+  size_t PrefixLength(const Slice& key) const {
+    const char* p = key.data();
+    const char* limit = p + key.size();
+    for (int i = 0; i < fields_; i++) {
+      p = static_cast<const char*>(memchr(p, delimiter_, limit - p));
+      if (p == NULL) {
+        return 0;
+      }
+      p++;
+    }
+    return p - key.data();
+  }
+
+ public:
+  DelimitedPrefixTransform(char delimiter, int fields)
+      : delimiter_(delimiter),
+        fields_(fields) {
+    char buf[60];
+    snprintf(buf, sizeof(buf), "leveldb.DelimitedPrefix.%d.%d",
+             static_cast<unsigned char>(delimiter), fields);
+    name_ = buf;
+  }
+
+  virtual const char* Name() const {
+    return name_.c_str();
+  }
+
+  virtual bool InDomain(const Slice& key) const {
+    return fields_ > 0 && PrefixLength(key) > 0;
+  }
+
+  virtual Slice Transform(const Slice& key) const {
+    return Slice(key.data(), PrefixLength(key));
+  }
+};
+}  // namespace
+
+const SliceTransform* NewFixedPrefixTransform(size_t prefix_len) {
+  return new FixedPrefixTransform(prefix_len);
+}
+
+const SliceTransform* NewDelimitedPrefixTransform(char delimiter,
+                                                  int fields) {
+  return new DelimitedPrefixTransform(delimiter, fields);
+}
+
+}  // namespace leveldb